@@ -0,0 +1,41 @@
+// Measures how long diffing two large, mostly similar texts takes, and how big the diff is.
+// Usage: diff_bench [lines]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/diff_match_patch.h"
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::string a;
+    for (size_t i = 0; i < lines; ++i) a += "    value_" + std::to_string(i) + " = compute(x);\n";
+    // A handful of edits spread over the whole text, both ends included
+    std::string b = a;
+    for (size_t i = 0; i < 10; ++i) {
+        size_t at = b.find('\n', b.size() / 10 * i) + 1;
+        b.insert(at, i % 2 ? "    inserted();\n" : "");
+        b.replace(b.find("compute", at), 7, "evaluate");
+    }
+    b.insert(0, "// header\n");
+    b += "// footer\n";
+
+    diff_match_patch dmp;
+    dmp.set_diff_timeout(0);
+    for (bool checklines : {true, false}) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Diff> diffs = dmp.diff_main(a, b, checklines);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        size_t changed = 0;
+        for (const Diff& diff : diffs) {
+            if (diff.operation != Diff::Operation::EQUAL) changed += diff.text.size();
+        }
+        std::cout << (checklines ? "line mode" : "character mode") << ": " << elapsed.count() << " ms, "
+                  << diffs.size() << " diffs, " << changed << " bytes changed of " << a.size() << "\n";
+    }
+    return 0;
+}
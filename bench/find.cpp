@@ -0,0 +1,110 @@
+// Measures how fast text is searched, against memchr and std::string_view::find,
+// and how long replacing a million regular expression matches takes.
+// Usage: find_bench [megabytes]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../src/config.h"
+#include "../src/find.h"
+#include "../src/opened_file.h"
+
+template <typename F>
+double time_seconds(F&& f, int repetitions) {
+    double best = 1e30;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(const char* name, size_t bytes, double seconds, size_t matches) {
+    std::cout << name << ": " << (bytes / seconds) / 1e9 << " GB/s (" << matches << " matches, " << seconds * 1000 << " ms)\n";
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+
+    // Code-like lines full of the needle's first byte, with the needle itself near the end
+    std::string text;
+    text.reserve((megabytes << 20) + 64);
+    unsigned seed = 12345;
+    while (text.size() < (megabytes << 20)) {
+        seed = seed * 1103515245u + 12345u;
+        text.append("    value = compute(");
+        text.append(20 + (seed >> 16) % 60, 'x');
+        text.append(");\n");
+    }
+    text.append("return velocity_lmax;\n");
+    const std::string_view needle = "velocity_lmax";
+
+    size_t found = 0;
+    double seconds = time_seconds([&]() {
+        found = find_bytes(text, needle);
+    }, 5);
+    report("find_bytes", text.size(), seconds, found != std::string_view::npos);
+
+    seconds = time_seconds([&]() {
+        found = find_bytes(text, "VELOCITY_LMAX", 0, true);
+    }, 5);
+    report("find_bytes (case folded)", text.size(), seconds, found != std::string_view::npos);
+
+    PieceTable table(text);
+    Finder finder("velocity_lmax", FindOptions{true, true});
+    seconds = time_seconds([&]() {
+        found = finder.find_all(table).size();
+    }, 5);
+    report("Finder::find_all (whole words)", text.size(), seconds, found);
+
+    // Baselines: the first byte alone, and the standard library
+    seconds = time_seconds([&]() {
+        found = 0;
+        for (const char* p = text.data(); (p = static_cast<const char*>(std::memchr(p, 'v', text.data() + text.size() - p))) != nullptr; ++p) {
+            ++found;
+        }
+    }, 5);
+    report("memchr of the first byte", text.size(), seconds, found);
+
+    seconds = time_seconds([&]() {
+        found = std::string_view(text).find(needle);
+    }, 5);
+    report("std::string_view::find", text.size(), seconds, found != std::string_view::npos);
+    text = std::string();
+
+    // A million matches replaced, undone and redone in an open file
+    Config::create();
+    std::string path = (std::filesystem::temp_directory_path() / "find_bench.txt").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        for (int i = 0; i < 1000000; ++i) out << "    value_" << i << " = compute(x);\n";
+    }
+    OpenedFile file(path);
+    std::string error;
+    size_t size = file.get_text().length();
+    seconds = time_seconds([&]() {
+        found = file.replace_all("value_(\\d+)", "v$1", FindOptions{true, false}, error);
+    }, 1);
+    report("OpenedFile::replace_all", size, seconds, found);
+    seconds = time_seconds([&]() {
+        found = file.replace_all("compute", "evaluate", FindOptions{true, false}, error);
+    }, 1);
+    report("OpenedFile::replace_all (plain text)", size, seconds, found);
+    file.undo();
+    seconds = time_seconds([&]() { file.undo(); }, 1);
+    report("undo", size, seconds, found);
+    seconds = time_seconds([&]() { file.redo(); }, 1);
+    report("redo", size, seconds, found);
+    std::filesystem::remove(path);
+    Config::destroy();
+
+    return 0;
+}
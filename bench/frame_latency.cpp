@@ -0,0 +1,193 @@
+// Measures the time from a keystroke to the end of the frame that shows it, drawing headlessly.
+// Usage: frame_latency_bench [lines]
+//
+// Keystrokes are applied to an OpenedFile the way Client handles them, and each frame invalidates
+// and draws only the damaged band of the window like the Win32 frontend does. Every script is also
+// run repainting the whole window, as a baseline.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/opened_file.h"
+#include "../src/recording_renderer.h"
+
+namespace {
+
+constexpr int WINDOW_WIDTH = 1080;
+constexpr int WINDOW_HEIGHT = 720;
+
+using Keystroke = std::function<void(OpenedFile&)>;
+
+struct Script {
+    const char* name;
+    std::vector<Keystroke> keystrokes;
+};
+
+// Same sizing as Client::fit_viewport
+void fit_viewport(OpenedFile& file) {
+    Config* config = Config::get_instance();
+    int max_lines = WINDOW_HEIGHT / static_cast<int>(config->get_font_size() * 1.25f);
+    int max_chars_per_line = (WINDOW_WIDTH - static_cast<int>(config->get_left_margin() + config->get_explorer_width()))
+        / static_cast<int>(config->get_font_size() * 0.6f);
+    file.get_viewport().resize(max_lines, max_chars_per_line);
+    file.get_viewport().follow_cursor(file.get_current_line(), file.get_current_character_index());
+}
+
+// Works out the band Client::invalidate would invalidate, then paints it like WM_PAINT
+void draw_frame(OpenedFile& file, RecordingRenderer& renderer, bool full_repaint) {
+    const Viewport& viewport = file.get_viewport();
+    int old_first_line = viewport.get_first_line();
+    int old_first_column = viewport.get_first_column();
+    fit_viewport(file);
+
+    float line_height = static_cast<float>(static_cast<int>(Config::get_instance()->get_font_size() * 1.25f));
+    float top = 0.0f;
+    float bottom = static_cast<float>(WINDOW_HEIGHT);
+    const Damage& damage = file.get_damage();
+    bool scrolled = viewport.get_first_line() != old_first_line || viewport.get_first_column() != old_first_column;
+    if (!full_repaint && !scrolled) {
+        int first = std::max(damage.get_first_line(), viewport.get_first_line());
+        int last = std::min(damage.get_last_line(), viewport.get_end_line() - 1);
+        if (first > last) {
+            file.clear_damage();
+            return;
+        }
+        top = (first - viewport.get_first_line()) * line_height;
+        bottom = (last - viewport.get_first_line() + 1) * line_height;
+    }
+    file.clear_damage();
+
+    renderer.BeginDraw();
+    renderer.PushClip(0.0f, top, static_cast<float>(WINDOW_WIDTH), bottom);
+    renderer.ClearScreen(Config::get_instance()->get_background_color());
+    file.draw(&renderer, top, bottom);
+    renderer.PopClip();
+    renderer.EndDraw();
+}
+
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())));
+    return samples[index];
+}
+
+void run(const Script& script, const std::string& path, bool full_repaint) {
+    OpenedFile file(path);
+    RecordingRenderer renderer;
+    file.set_current_line(file.get_num_lines() / 2);
+    file.set_current_character(0);
+    fit_viewport(file);
+    // Start with the cursor in the middle of the window rather than on its bottom edge
+    file.get_viewport().scroll_by(file.get_viewport().get_visible_lines() / 2, file.get_num_lines());
+    draw_frame(file, renderer, true);
+    renderer.reset();
+
+    std::vector<double> latencies;
+    latencies.reserve(script.keystrokes.size());
+    for (const Keystroke& keystroke : script.keystrokes) {
+        auto start = std::chrono::steady_clock::now();
+        keystroke(file);
+        draw_frame(file, renderer, full_repaint);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        latencies.push_back(elapsed.count());
+    }
+
+    const RecordingRenderer::Counts& counts = renderer.get_counts();
+    double frames = static_cast<double>(std::max<size_t>(1, counts.frames));
+    std::printf("%-14s %-8s p50 %8.1f us  p99 %8.1f us  per frame: %6.1f draw calls %8.1f glyphs %8.1f shaped\n",
+                script.name, full_repaint ? "full" : "damaged",
+                percentile(latencies, 0.50), percentile(latencies, 0.99),
+                counts.draw_calls / frames, counts.glyphs / frames, counts.shaped_glyphs / frames);
+}
+
+std::vector<Script> make_scripts() {
+    const std::string sentence = "the quick brown fox jumps over the lazy dog ";
+    std::vector<Script> scripts;
+
+    // Lines of 60 characters, moving down to the start of the next line after each
+    Script typing{"typing", {}};
+    for (int i = 0; i < 2000; ++i) {
+        char c = sentence[i % sentence.size()];
+        typing.keystrokes.push_back([c](OpenedFile& file) { file.insert_character(c); });
+        if (i % 60 == 59) {
+            typing.keystrokes.push_back([](OpenedFile& file) {
+                file.set_current_line(file.get_current_line() + 1);
+                file.set_current_character(0);
+            });
+        }
+    }
+    scripts.push_back(std::move(typing));
+
+    Script lines{"enter+back", {}};
+    for (int i = 0; i < 1000; ++i) {
+        lines.keystrokes.push_back([](OpenedFile& file) { file.new_line(); });
+        lines.keystrokes.push_back([](OpenedFile& file) { file.delete_character(); });
+    }
+    scripts.push_back(std::move(lines));
+
+    Script arrows{"arrow keys", {}};
+    for (int i = 0; i < 2000; ++i) {
+        int step = (i / 100) % 2 == 0 ? 1 : -1;
+        arrows.keystrokes.push_back([step](OpenedFile& file) {
+            int line = std::clamp(file.get_current_line() + step, 0, file.get_num_lines() - 1);
+            file.set_current_line(line);
+            file.set_current_character(std::min(file.get_current_character_index(), file.get_num_characters(line)));
+        });
+    }
+    scripts.push_back(std::move(arrows));
+
+    Script selecting{"shift+arrows", {}};
+    selecting.keystrokes.push_back([](OpenedFile& file) { file.start_selection(); });
+    for (int i = 0; i < 2000; ++i) {
+        selecting.keystrokes.push_back([](OpenedFile& file) {
+            int line = file.get_current_line();
+            if (file.get_current_character_index() < file.get_num_characters(line)) {
+                file.set_current_character(file.get_current_character_index() + 1);
+            } else if (line + 1 < file.get_num_lines()) {
+                file.set_current_line(line + 1);
+                file.set_current_character(0);
+            }
+            file.update_selection();
+        });
+    }
+    scripts.push_back(std::move(selecting));
+
+    return scripts;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t line_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    Config::create();
+
+    // Code-like lines of varying length and indentation
+    std::string path = (std::filesystem::temp_directory_path() / "frame_latency_bench.txt").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        unsigned seed = 12345;
+        for (size_t i = 0; i < line_count; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            out << std::string(4 * ((seed >> 8) % 4), ' ') << "value_" << i << " = compute(" << std::string((seed >> 16) % 60, 'x') << ");\n";
+        }
+    }
+
+    for (const Script& script : make_scripts()) {
+        run(script, path, false);
+        run(script, path, true);
+    }
+
+    std::filesystem::remove(path);
+    Config::destroy();
+    return 0;
+}
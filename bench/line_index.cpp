@@ -0,0 +1,65 @@
+// Measures how fast line indexes are built for large inputs.
+// Usage: line_index_bench [megabytes]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/line_index.h"
+
+template <typename F>
+double time_seconds(F&& f, int repetitions) {
+    double best = 1e30;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(const char* name, size_t bytes, double seconds, size_t lines) {
+    std::cout << name << ": " << (bytes / seconds) / 1e9 << " GB/s (" << lines << " lines, " << seconds * 1000 << " ms)\n";
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+
+    // Log-like lines of varying length
+    std::string text;
+    text.reserve(megabytes << 20);
+    unsigned seed = 12345;
+    while (text.size() < (megabytes << 20)) {
+        seed = seed * 1103515245u + 12345u;
+        text.append(20 + (seed >> 16) % 120, 'x');
+        text.push_back('\n');
+    }
+
+    size_t lines = 0;
+    double seconds = time_seconds([&]() {
+        std::vector<size_t> out;
+        scan_line_breaks(text.data(), text.size(), 0, out);
+        lines = out.size();
+    }, 5);
+    report("scan_line_breaks (1 thread)", text.size(), seconds, lines);
+
+    seconds = time_seconds([&]() {
+        lines = build_line_index(text.data(), text.size()).size();
+    }, 5);
+    report("build_line_index (all threads)", text.size(), seconds, lines);
+
+    // Baseline: what splitStringToWStringVector used to do
+    seconds = time_seconds([&]() {
+        std::istringstream ss(text);
+        std::string line;
+        lines = 0;
+        while (std::getline(ss, line, '\n')) ++lines;
+    }, 1);
+    report("std::getline", text.size(), seconds, lines);
+
+    return 0;
+}
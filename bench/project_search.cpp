@@ -0,0 +1,59 @@
+// Measures how soon a project search shows its first result on a large tree, and how long the whole search takes.
+// Usage: project_search_bench [files]
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/project_search.h"
+
+double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void run(const std::string& root, unsigned threads) {
+    auto start = std::chrono::steady_clock::now();
+    ProjectSearch search(root, "velocity_lmax", FindOptions{true, false}, SIZE_MAX, threads);
+    std::vector<SearchResult> results;
+    double first = -1;
+    while (!search.is_done() || first < 0) {
+        search.take_results(results);
+        if (first < 0 && !results.empty()) first = milliseconds_since(start);
+        if (search.is_done() && first < 0) break;
+        std::this_thread::yield();
+    }
+    search.take_results(results);
+    double total = milliseconds_since(start);
+    std::cout << threads << " threads: first result " << first << " ms, " << results.size() << " results in "
+              << search.get_files_searched() << " files, " << total << " ms\n";
+}
+
+int main(int argc, char** argv) {
+    size_t files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    // 100 files per directory, 100 directories per parent, a few kilobytes of code each
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "project_search_bench";
+    std::filesystem::remove_all(root);
+    std::string body;
+    for (int i = 0; i < 60; ++i) body += "    value = compute(velocity, acceleration, time_step);\n";
+    for (size_t i = 0; i < files; ++i) {
+        std::filesystem::path directory = root / std::to_string(i / 10000) / std::to_string(i / 100 % 100);
+        if (i % 100 == 0) std::filesystem::create_directories(directory);
+        std::ofstream out(directory / (std::to_string(i) + ".cpp"), std::ios::binary);
+        out << body;
+        if (i % 1000 == 999) out << "    return velocity_lmax;\n";
+    }
+    std::ofstream(root / ".gitignore") << "*.o\nbuild/\n";
+
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    run(root.string(), 1);
+    run(root.string(), hardware);
+    std::filesystem::remove_all(root);
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "action.h"
+
+#include <array>
+#include <charconv>
+
+namespace {
+
+enum class ArgumentType : uint8_t { INT, BOOL };
+
+struct ActionInfo {
+    ActionCode code;
+    const char* name;
+    uint8_t argument_count;
+    ArgumentType types[Action::MAX_ARGUMENTS];
+};
+
+// In ActionCode order, so a code indexes its own entry
+constexpr std::array<ActionInfo, 38> ACTIONS = {{
+    {ActionCode::CHAR_LEFT, "CHAR_LEFT", 0, {}},
+    {ActionCode::CHAR_RIGHT, "CHAR_RIGHT", 0, {}},
+    {ActionCode::CHAR_UP, "CHAR_UP", 0, {}},
+    {ActionCode::CHAR_DOWN, "CHAR_DOWN", 0, {}},
+    {ActionCode::JUMP_LEFT, "JUMP_LEFT", 0, {}},
+    {ActionCode::JUMP_RIGHT, "JUMP_RIGHT", 0, {}},
+    {ActionCode::SELECT_LEFT, "SELECT_LEFT", 0, {}},
+    {ActionCode::SELECT_RIGHT, "SELECT_RIGHT", 0, {}},
+    {ActionCode::SELECT_UP, "SELECT_UP", 0, {}},
+    {ActionCode::SELECT_DOWN, "SELECT_DOWN", 0, {}},
+    {ActionCode::SELECT_WORD_LEFT, "SELECT_WORD_LEFT", 0, {}},
+    {ActionCode::SELECT_WORD_RIGHT, "SELECT_WORD_RIGHT", 0, {}},
+    {ActionCode::SELECT_ALL, "SELECT_ALL", 0, {}},
+    {ActionCode::SAVE, "SAVE", 1, {ArgumentType::INT}},
+    {ActionCode::CLOSE_FILE, "CLOSE_FILE", 1, {ArgumentType::INT}},
+    {ActionCode::DEL, "DEL", 3, {ArgumentType::INT, ArgumentType::INT, ArgumentType::BOOL}},
+    {ActionCode::DEL_WORD, "DEL_WORD", 0, {}},
+    {ActionCode::DELETE_FORWARD, "DELETE", 0, {}},
+    {ActionCode::UNDO, "UNDO", 0, {}},
+    {ActionCode::REDO, "REDO", 0, {}},
+    {ActionCode::COPY, "COPY", 0, {}},
+    {ActionCode::CUT, "CUT", 0, {}},
+    {ActionCode::PASTE, "PASTE", 0, {}},
+    {ActionCode::FORMAT_BOLD, "FORMAT_BOLD", 0, {}},
+    {ActionCode::FORMAT_ITALIC, "FORMAT_ITALIC", 0, {}},
+    {ActionCode::FORMAT_UNDERLINE, "FORMAT_UNDERLINE", 0, {}},
+    {ActionCode::FORMAT_HIGHLIGHT, "FORMAT_HIGHLIGHT", 0, {}},
+    {ActionCode::TYPE, "TYPE", 1, {ArgumentType::INT}},
+    {ActionCode::TOGGLE_MACRO_RECORDING, "TOGGLE_MACRO_RECORDING", 0, {}},
+    {ActionCode::REPLAY_MACRO, "REPLAY_MACRO", 1, {ArgumentType::INT}},
+    {ActionCode::REPLAY_MACRO_ON_LINES, "REPLAY_MACRO_ON_LINES", 0, {}},
+    {ActionCode::SELECT_ALL_OCCURRENCES, "SELECT_ALL_OCCURRENCES", 0, {}},
+    {ActionCode::CLEAR_CURSORS, "CLEAR_CURSORS", 0, {}},
+    {ActionCode::TOGGLE_BLOCK_SELECTION, "TOGGLE_BLOCK_SELECTION", 0, {}},
+    {ActionCode::FIND_SELECTION, "FIND_SELECTION", 0, {}},
+    {ActionCode::FIND_NEXT, "FIND_NEXT", 0, {}},
+    {ActionCode::FIND_PREVIOUS, "FIND_PREVIOUS", 0, {}},
+    {ActionCode::CLEAR_FIND, "CLEAR_FIND", 0, {}},
+}};
+
+bool parse_argument(std::string_view token, ArgumentType type, int32_t& value) {
+    if (type == ArgumentType::BOOL) {
+        if (token != "TRUE" && token != "FALSE") return false;
+        value = token == "TRUE";
+        return true;
+    }
+    auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return error == std::errc() && end == token.data() + token.size();
+}
+
+// Splits off the next whitespace separated token, leaving source after it
+std::string_view next_token(std::string_view& source) {
+    size_t start = source.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) {
+        source = {};
+        return {};
+    }
+    size_t end = source.find_first_of(" \t\r\n", start);
+    if (end == std::string_view::npos) end = source.size();
+    std::string_view token = source.substr(start, end - start);
+    source.remove_prefix(end);
+    return token;
+}
+
+} // namespace
+
+bool compile_actions(std::string_view source, std::vector<Action>& program, std::vector<std::string>& errors) {
+    size_t error_count = errors.size();
+    program.clear();
+    for (std::string_view token = next_token(source); !token.empty(); token = next_token(source)) {
+        const ActionInfo* info = nullptr;
+        for (const ActionInfo& candidate : ACTIONS) {
+            if (token == candidate.name) {
+                info = &candidate;
+                break;
+            }
+        }
+        if (info == nullptr) {
+            errors.push_back("Unknown action " + std::string(token));
+            continue;
+        }
+
+        Action action{info->code, {}};
+        bool valid = true;
+        for (uint8_t i = 0; i < info->argument_count && valid; ++i) {
+            std::string_view argument = next_token(source);
+            if (argument.empty()) {
+                errors.push_back(std::string(info->name) + " expects " + std::to_string(info->argument_count) + " arguments");
+                valid = false;
+            } else if (!parse_argument(argument, info->types[i], action.arguments[i])) {
+                errors.push_back("Invalid argument " + std::string(argument) + " to " + info->name);
+                valid = false;
+            }
+        }
+        if (valid) program.push_back(action);
+    }
+    return errors.size() == error_count;
+}
+
+const char* action_name(ActionCode code) {
+    return ACTIONS[static_cast<size_t>(code)].name;
+}
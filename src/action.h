@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief The operations a command can perform, one per action name in commands.cfg.
+enum class ActionCode : uint8_t {
+    CHAR_LEFT,
+    CHAR_RIGHT,
+    CHAR_UP,
+    CHAR_DOWN,
+    JUMP_LEFT,
+    JUMP_RIGHT,
+    SELECT_LEFT,
+    SELECT_RIGHT,
+    SELECT_UP,
+    SELECT_DOWN,
+    SELECT_WORD_LEFT,
+    SELECT_WORD_RIGHT,
+    SELECT_ALL,
+    SAVE,       // file id
+    CLOSE_FILE, // file id
+    DEL,        // line, character, whether the cursor moves (0 or 1)
+    DEL_WORD,
+    DELETE_FORWARD, // "DELETE" in action strings, which windows.h defines as a macro
+    UNDO,
+    REDO,
+    COPY,
+    CUT,
+    PASTE,
+    FORMAT_BOLD,
+    FORMAT_ITALIC,
+    FORMAT_UNDERLINE,
+    FORMAT_HIGHLIGHT,
+    TYPE,                 // character code, typed as if its key was pressed
+    TOGGLE_MACRO_RECORDING,
+    REPLAY_MACRO,         // number of times
+    REPLAY_MACRO_ON_LINES, // once at the start of every selected line
+    SELECT_ALL_OCCURRENCES,
+    CLEAR_CURSORS,
+    TOGGLE_BLOCK_SELECTION,
+    FIND_SELECTION,
+    FIND_NEXT,
+    FIND_PREVIOUS,
+    CLEAR_FIND
+};
+
+/// @brief One step of a compiled command, with its arguments stored inline.
+struct Action {
+    static constexpr int MAX_ARGUMENTS = 3;
+
+    ActionCode code;
+    int32_t arguments[MAX_ARGUMENTS];
+};
+
+/// @brief Compiles an action string such as "SELECT_ALL COPY" or "DEL -1 -1 TRUE" into a program.
+/// Every problem is added to errors, and the program only holds the actions that compiled.
+/// Returns true if there were no problems.
+bool compile_actions(std::string_view source, std::vector<Action>& program, std::vector<std::string>& errors);
+
+/// @brief Gets the name an action code has in action strings.
+const char* action_name(ActionCode code);
@@ -0,0 +1,184 @@
+#include "anchor_set.h"
+
+AnchorSet::AnchorSet()
+    : nodes(), free_nodes(), root(NIL), rng_state(0x9E3779B9u), count(0) {}
+
+AnchorId AnchorSet::create(size_t offset, Gravity gravity) {
+    // xorshift32, deterministic so that tree shapes are reproducible between runs
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+
+    Node node{offset, {false, 0, 0}, gravity, rng_state, NIL, NIL, NIL};
+    uint32_t t;
+    if (!free_nodes.empty()) {
+        t = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[t] = node;
+    } else {
+        nodes.push_back(node);
+        t = static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    uint32_t left, right;
+    split(root, offset, false, left, right);
+    set_root(merge(merge(left, t), right));
+    ++count;
+    return t;
+}
+
+void AnchorSet::remove(AnchorId id) {
+    // The children keep the same ancestors, so only this node's own pending shift has to be handed down
+    push(id);
+    uint32_t replacement = merge(nodes[id].left, nodes[id].right);
+    uint32_t parent = nodes[id].parent;
+    if (replacement != NIL) nodes[replacement].parent = parent;
+    if (parent == NIL) {
+        root = replacement;
+    } else if (nodes[parent].left == id) {
+        nodes[parent].left = replacement;
+    } else {
+        nodes[parent].right = replacement;
+    }
+    free_nodes.push_back(id);
+    --count;
+}
+
+size_t AnchorSet::get(AnchorId id) const {
+    // Shifts closer to the node were pending first, so they apply first
+    size_t offset = nodes[id].offset;
+    for (uint32_t t = nodes[id].parent; t != NIL; t = nodes[t].parent) {
+        offset = apply(nodes[t].shift, offset);
+    }
+    return offset;
+}
+
+void AnchorSet::set(AnchorId id, size_t offset) {
+    Gravity gravity = nodes[id].gravity;
+    remove(id);
+    // The freed id is the most recent one, so create hands it straight back
+    create(offset, gravity);
+}
+
+void AnchorSet::on_insert(size_t offset, size_t length) {
+    if (length == 0 || root == NIL) return;
+
+    uint32_t before, at, after;
+    split(root, offset, false, before, after);
+    split(after, offset, true, at, after);
+    if (after != NIL) apply_shift(after, {false, 0, static_cast<int64_t>(length)});
+
+    // Anchors exactly at the insertion point go either way depending on their gravity
+    std::vector<uint32_t> anchors;
+    collect(at, anchors);
+    uint32_t result = before;
+    for (Gravity gravity : {Gravity::LEFT, Gravity::RIGHT}) {
+        for (uint32_t t : anchors) {
+            if (nodes[t].gravity != gravity) continue;
+            if (gravity == Gravity::RIGHT) nodes[t].offset += length;
+            nodes[t].left = nodes[t].right = NIL;
+            result = merge(result, t);
+        }
+    }
+    set_root(merge(result, after));
+}
+
+void AnchorSet::on_erase(size_t offset, size_t length) {
+    if (length == 0 || root == NIL) return;
+
+    uint32_t before, erased, after;
+    split(root, offset, false, before, after);
+    split(after, offset + length, false, erased, after);
+    if (erased != NIL) apply_shift(erased, {true, offset, 0});
+    if (after != NIL) apply_shift(after, {false, 0, -static_cast<int64_t>(length)});
+    set_root(merge(merge(before, erased), after));
+}
+
+void AnchorSet::clear() {
+    nodes.clear();
+    free_nodes.clear();
+    root = NIL;
+    count = 0;
+}
+
+size_t AnchorSet::apply(const Shift& shift, size_t offset) {
+    int64_t result = static_cast<int64_t>(shift.assign ? shift.value : offset) + shift.add;
+    return result < 0 ? 0 : static_cast<size_t>(result);
+}
+
+void AnchorSet::apply_shift(uint32_t t, const Shift& shift) {
+    Node& node = nodes[t];
+    node.offset = apply(shift, node.offset);
+    if (shift.assign) {
+        node.shift = shift;
+    } else {
+        node.shift.add += shift.add;
+    }
+}
+
+void AnchorSet::push(uint32_t t) {
+    Node& node = nodes[t];
+    if (!node.shift.assign && node.shift.add == 0) return;
+    if (node.left != NIL) apply_shift(node.left, node.shift);
+    if (node.right != NIL) apply_shift(node.right, node.shift);
+    node.shift = {false, 0, 0};
+}
+
+void AnchorSet::update(uint32_t t) {
+    if (nodes[t].left != NIL) nodes[nodes[t].left].parent = t;
+    if (nodes[t].right != NIL) nodes[nodes[t].right].parent = t;
+}
+
+void AnchorSet::split(uint32_t t, size_t offset, bool inclusive, uint32_t& left, uint32_t& right) {
+    if (t == NIL) {
+        left = right = NIL;
+        return;
+    }
+
+    push(t);
+    bool goes_left = inclusive ? nodes[t].offset <= offset : nodes[t].offset < offset;
+    if (goes_left) {
+        uint32_t inner_left;
+        split(nodes[t].right, offset, inclusive, inner_left, right);
+        nodes[t].right = inner_left;
+        update(t);
+        left = t;
+    } else {
+        uint32_t inner_right;
+        split(nodes[t].left, offset, inclusive, left, inner_right);
+        nodes[t].left = inner_right;
+        update(t);
+        right = t;
+    }
+}
+
+uint32_t AnchorSet::merge(uint32_t left, uint32_t right) {
+    if (left == NIL) return right;
+    if (right == NIL) return left;
+
+    if (nodes[left].priority > nodes[right].priority) {
+        push(left);
+        uint32_t merged = merge(nodes[left].right, right);
+        nodes[left].right = merged;
+        update(left);
+        return left;
+    }
+    push(right);
+    uint32_t merged = merge(left, nodes[right].left);
+    nodes[right].left = merged;
+    update(right);
+    return right;
+}
+
+void AnchorSet::collect(uint32_t t, std::vector<uint32_t>& out) {
+    if (t == NIL) return;
+    push(t);
+    collect(nodes[t].left, out);
+    out.push_back(t);
+    collect(nodes[t].right, out);
+}
+
+void AnchorSet::set_root(uint32_t t) {
+    root = t;
+    if (t != NIL) nodes[t].parent = NIL;
+}
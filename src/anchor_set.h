@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Identifies an anchor within its AnchorSet.
+using AnchorId = uint32_t;
+
+/// @brief Which way an anchor moves when text is inserted exactly at its position.
+enum class Gravity : uint8_t {
+    /// Stays before the inserted text, e.g. the exclusive end of a range.
+    LEFT,
+    /// Moves after the inserted text, e.g. the start of a range.
+    RIGHT
+};
+
+/// @brief Byte offsets in a document that move along with edits.
+///
+/// Anchors are kept in a treap ordered by offset. An edit only splits the
+/// treap around the edited span and leaves a lazy shift on the part after it,
+/// so the work per edit is O(log n) plus the anchors sitting exactly at an
+/// insertion point, no matter how many anchors there are. Reading an anchor
+/// applies the pending shifts on its path to the root.
+class AnchorSet {
+public:
+    AnchorSet();
+
+    /// @brief Adds an anchor at the given offset.
+    AnchorId create(size_t offset, Gravity gravity);
+
+    /// @brief Removes an anchor. Its id may be handed out again.
+    void remove(AnchorId id);
+
+    /// @brief Current offset of an anchor.
+    size_t get(AnchorId id) const;
+
+    /// @brief Moves an anchor to a new offset.
+    void set(AnchorId id, size_t offset);
+
+    /// @brief Shifts anchors for length bytes inserted at offset.
+    void on_insert(size_t offset, size_t length);
+
+    /// @brief Shifts anchors for length bytes erased at offset. Anchors inside the erased span collapse onto offset.
+    void on_erase(size_t offset, size_t length);
+
+    /// @brief Removes every anchor.
+    void clear();
+
+    inline size_t size() const { return count; }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    /// @brief Pending change for the descendants of a node: x becomes (assign ? value : x) + add.
+    struct Shift {
+        bool assign;
+        size_t value;
+        int64_t add;
+    };
+
+    struct Node {
+        size_t offset;  // Up to date except for the shifts pending on its ancestors
+        Shift shift;    // Pending for this node's children
+        Gravity gravity;
+        uint32_t priority;
+        uint32_t left;
+        uint32_t right;
+        uint32_t parent;
+    };
+
+    static size_t apply(const Shift& shift, size_t offset);
+    void apply_shift(uint32_t t, const Shift& shift);
+    void push(uint32_t t);
+    void update(uint32_t t);
+
+    /// @brief Splits into anchors before offset and the rest, or at or before offset when inclusive.
+    void split(uint32_t t, size_t offset, bool inclusive, uint32_t& left, uint32_t& right);
+    uint32_t merge(uint32_t left, uint32_t right);
+    void collect(uint32_t t, std::vector<uint32_t>& out);
+    void set_root(uint32_t t);
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t root;
+    uint32_t rng_state;
+    size_t count;
+};
@@ -0,0 +1,95 @@
+#include "block_text.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "utf8.h"
+
+namespace {
+
+/// @brief Walks the lines of a block, finding the byte span of the block's columns on each.
+class ColumnWalker {
+public:
+    ColumnWalker(std::string_view lines, size_t first_column, size_t last_column)
+        : lines(lines), first_column(first_column), last_column(last_column), position(0), done(false), columns(0) {}
+
+    /// @brief Moves to the next line. Returns false once every line has been visited.
+    bool next(std::string_view& line, size_t& first, size_t& last) {
+        if (done) return false;
+        const char* start = lines.data() + position;
+        const char* found = static_cast<const char*>(std::memchr(start, '\n', lines.size() - position));
+        size_t length = found == nullptr ? lines.size() - position : static_cast<size_t>(found - start);
+        line = lines.substr(position, length);
+        position += length + 1;
+        done = found == nullptr;
+
+        if (is_ascii(line)) {
+            columns = line.size();
+            first = std::min(first_column, line.size());
+            last = std::min(last_column, line.size());
+        } else {
+            utf8_to_wide(line, wide, &offsets);
+            columns = offsets.size() - 1;
+            first = offsets[std::min(first_column, columns)];
+            last = offsets[std::min(last_column, columns)];
+        }
+        return true;
+    }
+
+    /// @brief Whether the line visited last is long enough to reach the block.
+    inline bool reaches_block() const { return columns >= first_column; }
+
+private:
+    std::string_view lines;
+    size_t first_column;
+    size_t last_column;
+    size_t position;
+    bool done;
+    size_t columns;                 // Of the line visited last
+    std::wstring wide;              // Scratch space for decoding, reused across lines
+    std::vector<uint32_t> offsets;
+};
+
+} // namespace
+
+std::string extract_columns(std::string_view lines, size_t first_column, size_t last_column) {
+    // The columns of every line and the breaks between them never take more than the lines themselves
+    std::string result;
+    result.reserve(lines.size());
+
+    ColumnWalker walker(lines, first_column, last_column);
+    std::string_view line;
+    size_t first, last;
+    bool first_line = true;
+    while (walker.next(line, first, last)) {
+        if (!first_line) result.push_back('\n');
+        first_line = false;
+        result.append(line.data() + first, last - first);
+    }
+    return result;
+}
+
+std::string replace_columns(std::string_view lines, size_t first_column, size_t last_column, std::string_view replacement) {
+    size_t line_count = static_cast<size_t>(std::count(lines.begin(), lines.end(), '\n')) + 1;
+    std::string result;
+    result.reserve(lines.size() + line_count * replacement.size());
+
+    ColumnWalker walker(lines, first_column, last_column);
+    std::string_view line;
+    size_t first, last;
+    bool first_line = true;
+    while (walker.next(line, first, last)) {
+        if (!first_line) result.push_back('\n');
+        first_line = false;
+        if (!walker.reaches_block()) {
+            result.append(line);
+            continue;
+        }
+        result.append(line.data(), first);
+        result.append(replacement);
+        result.append(line.data() + last, line.size() - last);
+    }
+    return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Column operations over a run of whole lines of UTF-8 text, as used by block selections.
+// Columns count wide characters like the rest of the editor, and lines that end before a
+// column are treated as if the column were at their end. Every function makes a single
+// pass over the text, with lines found by memchr and only non-ASCII lines decoded.
+
+/// @brief Copies the columns from first_column up to last_column of every line, joined by '\n'.
+/// The output is reserved once up front.
+std::string extract_columns(std::string_view lines, size_t first_column, size_t last_column);
+
+/// @brief Replaces the columns from first_column up to last_column of every line with replacement.
+/// Lines that end before first_column are left as they are.
+std::string replace_columns(std::string_view lines, size_t first_column, size_t last_column, std::string_view replacement);
@@ -1,32 +1,14 @@
 #include "client.h"
 #include "selection.h"
-#include <cwctype>  // For iswalnum
+#include <algorithm>
 
 // Declare globals from speedy.cpp
 extern int client_width;
 extern int client_height;
 
-#include <codecvt>
-#include <locale>
-#include <sstream>
-
 std::unordered_set<char> Client::insertable_characters;
 
 
-std::vector<std::wstring> splitStringToWStringVector(const std::string& input) {
-    std::vector<std::wstring> result;
-    std::istringstream ss(input);
-    std::string line;
-
-    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-
-    while (std::getline(ss, line, '\n')) {
-        result.push_back(converter.from_bytes(line));
-    }
-
-    return result;
-}
-
 void Client::init() {
     // Initialize the insertable_characters set
 
@@ -73,7 +55,7 @@ Client* Client::instance = nullptr;
     
 
 Client::Client()
-    : opened_files{}, current_file(-1), autosave_timer(NULL), diff(), syncer("3.95.174.32", 8080, ""), mut() {}
+    : opened_files{}, current_file(-1), autosave_timer(NULL), macro(), recording_macro(false), diff(), syncer("3.95.174.32", 8080, ""), mut() {}
 
 Client::~Client() {}
 
@@ -81,18 +63,33 @@ bool Client::open_file(const std::string& file_path) {
     opened_files.push_back(OpenedFile(file_path));
     current_file = static_cast<int>(opened_files.size()) - 1;
     
-    // Add to the syncer
-    std::string file_data = syncer.set_file(file_path);
-    std::vector<std::wstring> lines = splitStringToWStringVector(file_data);
-    opened_files[current_file].set_lines(std::move(lines));
+    // Add to the syncer. The remote text is UTF-8, which is the storage format, so it is used as-is.
+    // When it is what the file already holds, the file stays mapped rather than being copied into memory.
+    std::string remote = syncer.set_file(file_path);
+    if (!opened_files[current_file].has_contents(remote)) {
+        opened_files[current_file].set_contents(std::move(remote));
+    }
     return opened_files[current_file].is_open();
 }
 
 void Client::process_character(const char character) {
     // Do not insert a character if it isn't allowed
     if (!insertable_characters.contains(character)) return;
+    if (recording_macro) {
+        macro.push_back({ActionCode::TYPE, {static_cast<unsigned char>(character)}});
+    }
     
     OpenedFile& working_file = opened_files[current_file];
+
+    // With several cursors or a block selection the keystroke goes to every line as one edit
+    if (working_file.has_extra_cursors() || working_file.has_block_selection()) {
+        if (character == VK_BACK) {
+            working_file.backspace_at_cursors();
+        } else {
+            working_file.insert_text(std::wstring(1, character == '\r' ? L'\n' : static_cast<wchar_t>(static_cast<unsigned char>(character))));
+        }
+        return;
+    }
     
     // If there's a selection and user types, delete the selection first
     if (working_file.get_selection().has_selection() && character != VK_BACK) {
@@ -121,11 +118,12 @@ void Client::process_character(const char character) {
 
 void Client::move_left(bool extend_selection) {
     OpenedFile& working_file = opened_files[current_file];
+    working_file.clear_cursors();
     
     // If not extending and there's a selection, move to start of selection and clear
     if (!extend_selection && working_file.get_selection().has_selection()) {
         int start_line, start_char, end_line, end_char;
-        working_file.get_selection().get_normalized_range(start_line, start_char, end_line, end_char);
+        working_file.get_selection_range(start_line, start_char, end_line, end_char);
         working_file.set_current_line(start_line);
         working_file.set_current_character(start_char);
         working_file.clear_selection();
@@ -156,10 +154,11 @@ void Client::move_left(bool extend_selection) {
 
 void Client::move_right(bool extend_selection) {
     OpenedFile& working_file = opened_files[current_file];
+    working_file.clear_cursors();
     
     if (!extend_selection && working_file.get_selection().has_selection()) {
         int start_line, start_char, end_line, end_char;
-        working_file.get_selection().get_normalized_range(start_line, start_char, end_line, end_char);
+        working_file.get_selection_range(start_line, start_char, end_line, end_char);
         working_file.set_current_line(end_line);
         working_file.set_current_character(end_char);
         working_file.clear_selection();
@@ -171,7 +170,7 @@ void Client::move_right(bool extend_selection) {
     }
     
     if (working_file.get_current_character_index() == working_file.get_num_characters(working_file.get_current_line()) && 
-        working_file.get_current_line() < working_file.get_num_lines() - 1) {
+        working_file.has_line(working_file.get_current_line() + 1)) {
         working_file.set_current_line(working_file.get_current_line() + 1);
         working_file.set_current_character(0);
     } else if (working_file.get_current_character_index() < working_file.get_num_characters(working_file.get_current_line())) {
@@ -187,10 +186,11 @@ void Client::move_right(bool extend_selection) {
 
 void Client::move_up(bool extend_selection) {
     OpenedFile& working_file = opened_files[current_file];
+    working_file.clear_cursors();
     
     if (!extend_selection && working_file.get_selection().has_selection()) {
         int start_line, start_char, end_line, end_char;
-        working_file.get_selection().get_normalized_range(start_line, start_char, end_line, end_char);
+        working_file.get_selection_range(start_line, start_char, end_line, end_char);
         working_file.set_current_line(start_line);
         working_file.set_current_character(start_char);
         working_file.clear_selection();
@@ -217,10 +217,11 @@ void Client::move_up(bool extend_selection) {
 
 void Client::move_down(bool extend_selection) {
     OpenedFile& working_file = opened_files[current_file];
+    working_file.clear_cursors();
     
     if (!extend_selection && working_file.get_selection().has_selection()) {
         int start_line, start_char, end_line, end_char;
-        working_file.get_selection().get_normalized_range(start_line, start_char, end_line, end_char);
+        working_file.get_selection_range(start_line, start_char, end_line, end_char);
         working_file.set_current_line(end_line);
         working_file.set_current_character(end_char);
         working_file.clear_selection();
@@ -231,7 +232,7 @@ void Client::move_down(bool extend_selection) {
         working_file.start_selection();
     }
     
-    if (working_file.get_current_line() < working_file.get_num_lines() - 1) {
+    if (working_file.has_line(working_file.get_current_line() + 1)) {
         int target_col = working_file.get_current_character_index();
         working_file.set_current_line(working_file.get_current_line() + 1);
         int max_col = working_file.get_num_characters(working_file.get_current_line());
@@ -247,10 +248,11 @@ void Client::move_down(bool extend_selection) {
 
 void Client::jump_left(bool extend_selection) {
     OpenedFile& working_file = opened_files[current_file];
+    working_file.clear_cursors();
     
     if (!extend_selection && working_file.get_selection().has_selection()) {
         int start_line, start_char, end_line, end_char;
-        working_file.get_selection().get_normalized_range(start_line, start_char, end_line, end_char);
+        working_file.get_selection_range(start_line, start_char, end_line, end_char);
         working_file.set_current_line(start_line);
         working_file.set_current_character(start_char);
         working_file.clear_selection();
@@ -292,10 +294,11 @@ void Client::jump_left(bool extend_selection) {
 
 void Client::jump_right(bool extend_selection) {
     OpenedFile& working_file = opened_files[current_file];
+    working_file.clear_cursors();
     
     if (!extend_selection && working_file.get_selection().has_selection()) {
         int start_line, start_char, end_line, end_char;
-        working_file.get_selection().get_normalized_range(start_line, start_char, end_line, end_char);
+        working_file.get_selection_range(start_line, start_char, end_line, end_char);
         working_file.set_current_line(end_line);
         working_file.set_current_character(end_char);
         working_file.clear_selection();
@@ -310,7 +313,7 @@ void Client::jump_right(bool extend_selection) {
     int pos = working_file.get_current_character_index();
     int line_len = working_file.get_num_characters(line);
     
-    if (pos == line_len && line < working_file.get_num_lines() - 1) {
+    if (pos == line_len && working_file.has_line(line + 1)) {
         // Jump to start of next line
         line++;
         pos = 0;
@@ -337,7 +340,7 @@ void Client::jump_right(bool extend_selection) {
 }
 
 bool Client::is_word_char(wchar_t ch) {
-    return iswalnum(ch) || ch == L'_';
+    return is_word_character(ch);
 }
 
 void Client::delete_group() {
@@ -402,6 +405,119 @@ void Client::delete_group() {
     );
 }
 
+void Client::delete_forward() {
+    OpenedFile& file = opened_files[current_file];
+    if (file.has_extra_cursors() || file.has_block_selection()) {
+        file.delete_at_cursors();
+        return;
+    }
+    if (file.get_selection().has_selection()) {
+        file.delete_selection();
+        return;
+    }
+    int line = file.get_current_line();
+    int pos = file.get_current_character_index();
+    if (pos < file.get_num_characters(line)) {
+        file.delete_character(line, pos + 1, false);
+    } else if (file.has_line(line + 1)) {
+        // Delete newline - merge with next line
+        file.delete_character(line + 1, 0, false);
+    }
+}
+
+void Client::execute(const std::vector<Action>& program) {
+    for (const Action& action : program) {
+        const int32_t* args = action.arguments;
+        // Typed characters are recorded by process_character, and macros never replay other macros
+        // or change which file they are running in
+        if (recording_macro) {
+            switch (action.code) {
+                case ActionCode::TYPE:
+                case ActionCode::TOGGLE_MACRO_RECORDING:
+                case ActionCode::REPLAY_MACRO:
+                case ActionCode::REPLAY_MACRO_ON_LINES:
+                case ActionCode::CLOSE_FILE:
+                    break;
+                default:
+                    macro.push_back(action);
+                    break;
+            }
+        }
+        switch (action.code) {
+            case ActionCode::CHAR_LEFT: move_left(); break;
+            case ActionCode::CHAR_RIGHT: move_right(); break;
+            case ActionCode::CHAR_UP: move_up(); break;
+            case ActionCode::CHAR_DOWN: move_down(); break;
+            case ActionCode::JUMP_LEFT: jump_left(); break;
+            case ActionCode::JUMP_RIGHT: jump_right(); break;
+            case ActionCode::SELECT_LEFT: move_left(true); break;
+            case ActionCode::SELECT_RIGHT: move_right(true); break;
+            case ActionCode::SELECT_UP: move_up(true); break;
+            case ActionCode::SELECT_DOWN: move_down(true); break;
+            case ActionCode::SELECT_WORD_LEFT: jump_left(true); break;
+            case ActionCode::SELECT_WORD_RIGHT: jump_right(true); break;
+            case ActionCode::SELECT_ALL: select_all(); break;
+            case ActionCode::SAVE: save_file(args[0]); break;
+            case ActionCode::CLOSE_FILE: close_file(args[0]); break;
+            case ActionCode::DEL: get_working_file().delete_character(args[0], args[1], args[2] != 0); break;
+            case ActionCode::DEL_WORD: delete_group(); break;
+            case ActionCode::DELETE_FORWARD: delete_forward(); break;
+            case ActionCode::UNDO: get_working_file().undo(); break;
+            case ActionCode::REDO: get_working_file().redo(); break;
+            case ActionCode::COPY: copy(GetActiveWindow()); break;
+            case ActionCode::CUT: cut(GetActiveWindow()); break;
+            case ActionCode::PASTE: paste(GetActiveWindow()); break;
+            case ActionCode::FORMAT_BOLD: format_bold(); break;
+            case ActionCode::FORMAT_ITALIC: format_italic(); break;
+            case ActionCode::FORMAT_UNDERLINE: format_underline(); break;
+            case ActionCode::FORMAT_HIGHLIGHT: format_highlight(); break;
+            case ActionCode::TYPE: process_character(static_cast<char>(args[0])); break;
+            case ActionCode::TOGGLE_MACRO_RECORDING: toggle_macro_recording(); break;
+            case ActionCode::REPLAY_MACRO: replay_macro(args[0]); break;
+            case ActionCode::REPLAY_MACRO_ON_LINES: replay_macro_on_lines(); break;
+            case ActionCode::SELECT_ALL_OCCURRENCES: get_working_file().select_all_occurrences(); break;
+            case ActionCode::CLEAR_CURSORS: get_working_file().clear_cursors(); break;
+            case ActionCode::TOGGLE_BLOCK_SELECTION: {
+                OpenedFile& file = get_working_file();
+                file.set_block_selection(!file.has_block_selection());
+                break;
+            }
+            case ActionCode::FIND_SELECTION: {
+                Config* config = Config::get_instance();
+                get_working_file().find_selection(FindOptions{config->get_find_match_case(), config->get_find_whole_word()});
+                break;
+            }
+            case ActionCode::FIND_NEXT: get_working_file().find_next(); break;
+            case ActionCode::FIND_PREVIOUS: get_working_file().find_previous(); break;
+            case ActionCode::CLEAR_FIND: get_working_file().clear_find(); break;
+        }
+    }
+}
+
+void Client::toggle_macro_recording() {
+    if (!recording_macro) {
+        macro.clear();
+    }
+    recording_macro = !recording_macro;
+}
+
+void Client::replay_macro(int times) {
+    if (recording_macro || macro.empty() || current_file < 0) return;
+
+    OpenedFile& file = opened_files[current_file];
+    file.begin_batch();
+    for (int i = 0; i < times; ++i) {
+        execute(macro);
+    }
+    file.end_batch();
+}
+
+void Client::replay_macro_on_lines() {
+    if (recording_macro || macro.empty() || current_file < 0) return;
+
+    opened_files[current_file].for_each_selected_line([this] { execute(macro); });
+}
+
 void Client::copy(HWND hwnd) {
     OpenedFile& working_file = opened_files[current_file];
     if (!working_file.get_selection().has_selection()) return;
@@ -436,11 +552,6 @@ void Client::cut(HWND hwnd) {
 void Client::paste(HWND hwnd) {
     OpenedFile& working_file = opened_files[current_file];
     
-    // If there's a selection, delete it first
-    if (working_file.get_selection().has_selection()) {
-        working_file.delete_selection();
-    }
-    
     if (OpenClipboard(hwnd)) {
         HANDLE hData = GetClipboardData(CF_UNICODETEXT);
         if (hData) {
@@ -449,21 +560,8 @@ void Client::paste(HWND hwnd) {
                 std::wstring text(pText);
                 GlobalUnlock(hData);
                 
-                // Insert the text character by character
-                for (wchar_t wc : text) {
-                    if (wc == L'\n' || wc == L'\r') {
-                        if (wc == L'\r') {
-                            working_file.new_line();
-                        }
-                        // Skip \n if it follows \r (Windows line endings)
-                        continue;
-                    } else {
-                        char c = static_cast<char>(wc);
-                        if (insertable_characters.contains(c)) {
-                            working_file.insert_character(c);
-                        }
-                    }
-                }
+                // Replaces any selection and splices the whole clipboard in as one edit
+                working_file.insert_text(text);
             }
         }
         CloseClipboard();
@@ -489,8 +587,6 @@ void Client::format_bold() {
     OpenedFile& working_file = opened_files[current_file];
     if (working_file.get_selection().has_selection()) {
         working_file.apply_formatting(FormatType::BOLD);
-        // Force a redraw
-        InvalidateRect(GetActiveWindow(), NULL, TRUE);
     }
 }
 
@@ -498,8 +594,6 @@ void Client::format_italic() {
     OpenedFile& working_file = opened_files[current_file];
     if (working_file.get_selection().has_selection()) {
         working_file.apply_formatting(FormatType::ITALIC);
-        // Force a redraw
-        InvalidateRect(GetActiveWindow(), NULL, TRUE);
     }
 }
 
@@ -507,8 +601,6 @@ void Client::format_underline() {
     OpenedFile& working_file = opened_files[current_file];
     if (working_file.get_selection().has_selection()) {
         working_file.apply_formatting(FormatType::UNDERLINE);
-        // Force a redraw
-        InvalidateRect(GetActiveWindow(), NULL, TRUE);
     }
 }
 
@@ -516,22 +608,62 @@ void Client::format_highlight() {
     OpenedFile& working_file = opened_files[current_file];
     if (working_file.get_selection().has_selection()) {
         working_file.apply_formatting(FormatType::HIGHLIGHT);
-        // Force a redraw
-        InvalidateRect(GetActiveWindow(), NULL, TRUE);
     }
 }
 
-void Client::draw(Graphics* g) {
+void Client::draw(Renderer* g, float top, float bottom) {
     if (current_file == -1) {
         return;
     }
-    const OpenedFile& file = opened_files[current_file];
+    OpenedFile& file = opened_files[current_file];
+    fit_viewport(file);
+    file.draw(g, top, bottom);
+}
 
+void Client::invalidate(HWND hwnd) {
+    if (current_file == -1) {
+        return;
+    }
+    OpenedFile& file = opened_files[current_file];
+    const Viewport& viewport = file.get_viewport();
+    int old_first_line = viewport.get_first_line();
+    int old_first_column = viewport.get_first_column();
+    fit_viewport(file);
+
+    const Damage& damage = file.get_damage();
+    if (viewport.get_first_line() != old_first_line || viewport.get_first_column() != old_first_column) {
+        // Everything on screen moved
+        InvalidateRect(hwnd, NULL, FALSE);
+    } else if (!damage.is_empty()) {
+        // Whole rows, including the line numbers, from the first to the last damaged line on screen
+        int first = std::max(damage.get_first_line(), viewport.get_first_line());
+        int last = std::min(damage.get_last_line(), viewport.get_end_line() - 1);
+        if (first <= last) {
+            int line_height = static_cast<int>(Config::get_instance()->get_font_size() * 1.25f);
+            RECT rect = {0, (first - viewport.get_first_line()) * line_height,
+                         client_width, (last - viewport.get_first_line() + 1) * line_height};
+            InvalidateRect(hwnd, &rect, FALSE);
+        }
+    }
+    file.clear_damage();
+}
+
+void Client::fit_viewport(OpenedFile& file) {
     // Use dynamic values based on window size and config
     int max_lines = client_height / static_cast<int>(Config::get_instance()->get_font_size() * 1.25f);
     int max_chars_per_line = (client_width - static_cast<int>(Config::get_instance()->get_left_margin() + Config::get_instance()->get_explorer_width())) / static_cast<int>(Config::get_instance()->get_font_size() * 0.6f);
 
-    file.draw(g, 0, 0, max_chars_per_line, max_lines);
+    Viewport& viewport = file.get_viewport();
+    viewport.resize(max_lines, max_chars_per_line);
+    viewport.follow_cursor(file.get_current_line(), file.get_current_character_index());
+}
+
+void Client::scroll(int lines) {
+    if (current_file == -1) {
+        return;
+    }
+    OpenedFile& file = opened_files[current_file];
+    file.get_viewport().scroll_by(lines, file.get_num_lines());
 }
 
 void Client::save_file(int file_id) const {
@@ -573,23 +705,13 @@ void Client::autosave() {
     // std::cout << "STARTING AUTOSAVE\n";
     // // Get the differences between the two files
     // // Iterate through each line and add to a std::string
-    std::string working;
-
-    // std::cout << "Part 1\n";
-    // // Convert the current working files lines into a std::string
+    // The buffer already stores UTF-8, so this is a copy rather than a conversion
     OpenedFile& of = opened_files[current_file];
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-    for (int line_number = 0; line_number < of.get_num_lines(); ++line_number) {
-        of.set_current_line(line_number);
-        working.append(converter.to_bytes(of.get_current_line_contents()));
-        if (line_number != of.get_num_lines() - 1) {
-            working.push_back('\n');
-        }
-    }
+    std::string working = of.get_contents();
     syncer.write_to_remote(working);
     std::string remote;
     if (syncer.update_from_remote(remote)) {
-        of.set_lines(splitStringToWStringVector(remote));
+        of.set_contents(std::move(remote));
     }
     // std::string remote;
     // if (syncer.update_from_remote(remote)) {
@@ -608,7 +730,7 @@ void Client::autosave() {
     //     OpenedFile new_file(of);
     
     //     std::cout << "Part 2\n";
-    //     of.set_lines(splitStringToWStringVector(remote));
+    //     of.set_contents(remote);
     //     of.set_current_line(selected_line);
         
     //     // Update the remote with remote
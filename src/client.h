@@ -7,12 +7,13 @@
 #include <windows.h>
 #include "sync_client.h"
 
-#include <cwctype>  // For iswalnum in is_word_char
 #include <vector> 
 #include <string>
+#include <limits>
 #include <mutex>
 #include <unordered_set>
 
+#include "action.h"
 #include "config.h" // For Config
 #include "graphics.h"     // For Graphics*
 #include "opened_file.h"  // Assuming this includes Selection, Edit, etc.
@@ -26,6 +27,12 @@ private:
 
     static std::unordered_set<char> insertable_characters;
 
+    std::vector<Action> macro;
+    bool recording_macro;
+
+    /// @brief Sizes the working file's viewport to the window and keeps the cursor in view.
+    void fit_viewport(OpenedFile& file);
+
 public:
     static void init();
     static void cleanup();
@@ -46,6 +53,8 @@ public:
     bool is_word_char(wchar_t ch);  // Declaration for word character check
 
     void delete_group();
+    /// @brief Deletes the selection, or the character after the cursor.
+    void delete_forward();
     void copy(HWND hwnd);
     void cut(HWND hwnd);
     void paste(HWND hwnd);
@@ -57,7 +66,25 @@ public:
     void format_underline();
     void format_highlight();
 
-    void draw(Graphics* g);
+    /// @brief Runs a compiled command, one action after another.
+    void execute(const std::vector<Action>& program);
+
+    /// @brief Starts recording typed characters and commands into the macro, or stops if it is recording.
+    void toggle_macro_recording();
+    inline bool is_recording_macro() const { return recording_macro; }
+    inline const std::vector<Action>& get_macro() const { return macro; }
+    /// @brief Replays the macro the given number of times as one batch of the working file.
+    /// However long the macro is, undo reverts the whole replay and the window is repainted once.
+    void replay_macro(int times = 1);
+    /// @brief Replays the macro from the start of every line the selection touches, as one batch.
+    void replay_macro_on_lines();
+
+    /// @brief Draws the working file, only touching the band of the window from top to bottom.
+    void draw(Renderer* g, float top = 0.0f, float bottom = std::numeric_limits<float>::max());
+    /// @brief Invalidates the parts of the window covering what changed in the working file since the last call.
+    void invalidate(HWND hwnd);
+    /// @brief Scrolls the working file's viewport without moving the cursor.
+    void scroll(int lines);
     void save_file(int file_id = -1) const;
     void close_file(int file_id = -1);
 
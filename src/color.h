@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief An RGBA color with channels from 0 to 1. Independent of any graphics API.
+struct Color {
+    // 0xRRGGBB values of the named colors in use
+    static constexpr uint32_t WHITE = 0xFFFFFF;
+    static constexpr uint32_t RED = 0xFF0000;
+    static constexpr uint32_t YELLOW = 0xFFFF00;
+    static constexpr uint32_t LIGHT_BLUE = 0xADD8E6;
+
+    float r;
+    float g;
+    float b;
+    float a;
+
+    constexpr Color(float r, float g, float b, float a = 1.0f) : r(r), g(g), b(b), a(a) {}
+
+    /// @brief Constructs a color from a 0xRRGGBB value.
+    constexpr Color(uint32_t rgb, float a = 1.0f)
+        : r(static_cast<float>((rgb >> 16) & 0xFF) / 255.0f),
+          g(static_cast<float>((rgb >> 8) & 0xFF) / 255.0f),
+          b(static_cast<float>(rgb & 0xFF) / 255.0f),
+          a(a) {}
+};
@@ -1,11 +1,11 @@
 #include "command.h"
 
-Command::Command(const std::string& name, const std::string& description, const std::string& action_string, const std::vector<char>& key_reqs, const std::function<void()>& action)
-    : name(name), description(description), action_string(action_string), action(action), key_requirements{} {
+Command::Command(const std::string& name, const std::string& description, const std::string& action_string, const std::vector<char>& key_reqs, const std::vector<Action>& program)
+    : name(name), description(description), action_string(action_string), program(program), key_sequence(1) {
     for (char key : key_reqs) {
-        key_requirements[static_cast<size_t>(key)] = true;
+        key_sequence[0].set(static_cast<unsigned char>(key));
     }
 }
 
-Command::Command(const std::string& name, const std::string& description, const std::string& action_string, const std::array<bool, 256>& key_reqs, const std::function<void()>& action)
-    : name(name), description(description), action_string(action_string), action(action), key_requirements(key_reqs) {}
\ No newline at end of file
+Command::Command(const std::string& name, const std::string& description, const std::string& action_string, const std::vector<KeyState>& key_sequence, const std::vector<Action>& program)
+    : name(name), description(description), action_string(action_string), program(program), key_sequence(key_sequence) {}
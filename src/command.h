@@ -1,31 +1,35 @@
 #pragma once
 
-#include <array>
-#include <functional>
 #include <string>
 #include <vector>
 
+#include "action.h"
+#include "keys.h"
+
 class Command {
 
 public:
-    Command(const std::string& name, const std::string& description, const std::string& action_string, const std::vector<char>& key_reqs, const std::function<void()>& action);
-    Command(const std::string& name, const std::string& description, const std::string& action_string, const std::array<bool, 256>& key_reqs, const std::function<void()>& action);
+    /// @brief Constructs a command bound to a single chord of the given keys.
+    Command(const std::string& name, const std::string& description, const std::string& action_string, const std::vector<char>& key_reqs, const std::vector<Action>& program);
+    /// @brief Constructs a command bound to a sequence of chords pressed one after another.
+    Command(const std::string& name, const std::string& description, const std::string& action_string, const std::vector<KeyState>& key_sequence, const std::vector<Action>& program);
 
     inline const std::string& get_name() const { return name; }
     inline const std::string& get_description() const { return description; }
     inline const std::string& get_action_string() const { return action_string; }
 
-    inline void execute() const { action(); }
+    /// @brief Gets the compiled form of the action string, run by Client::execute.
+    inline const std::vector<Action>& get_program() const { return program; }
 
-    inline const std::array<bool, 256> get_key_requirements() const { return key_requirements; }
+    inline const std::vector<KeyState>& get_key_sequence() const { return key_sequence; }
 
 
 private:
     std::string name;
     std::string description;
     std::string action_string;
-    std::function<void()> action;
-    std::array<bool, 256> key_requirements; // Bitfield representing all keys that need to be pressed
+    std::vector<Action> program;
+    std::vector<KeyState> key_sequence; // Chords that need to be pressed in order, each a bitfield of keys
 
 
-};
\ No newline at end of file
+};
@@ -1,12 +1,15 @@
 #include "command_controller.h"
 
-#include <array>
+#include <chrono>
 #include <fstream>
-#include <sstream>
+#include <iostream>
+#include <unordered_set>
 
 #include <windows.h>
 
 #include "client.h"
+#include "config.h"
+#include "keys.h"
 
 CommandController* CommandController::instance = nullptr;
 void CommandController::init(Client* c) {
@@ -17,56 +20,47 @@ CommandController::CommandController(Client* c)
     if (!load_commands()) {
         commands.clear();
         get_default_commands();
+    } else {
+        add_missing_default_commands();
     }
+    dispatcher.set_timeout(std::chrono::milliseconds(Config::get_instance()->get_key_sequence_timeout()));
+    dispatcher.build(commands);
 }
 
-bool CommandController::run_commands() const {
+bool CommandController::run_commands() {
     BYTE key_state[256];
     if (!GetKeyboardState(key_state)) return false;;
 
-    std::array<bool, 256> down;
+    KeyState down;
 
     for (int i = 0; i < 256; ++i) {
         down[i] = key_state[i] & 0x80;
     }
-    
-    // Map VK_LSHIFT and VK_RSHIFT to VK_SHIFT for easier matching
-    if (down[VK_LSHIFT] || down[VK_RSHIFT]) {
-        down[VK_SHIFT] = true;
-        down[VK_LSHIFT] = false;  // Clear the left/right shift keys so they don't interfere
-        down[VK_RSHIFT] = false;
-    }
-    // Map VK_LCONTROL and VK_RCONTROL to VK_CONTROL for easier matching
-    if (down[VK_LCONTROL] || down[VK_RCONTROL]) {
-        down[VK_CONTROL] = true;
-        down[VK_LCONTROL] = false;  // Clear the left/right control keys
-        down[VK_RCONTROL] = false;
-    }
-    // Map VK_LMENU and VK_RMENU to VK_MENU for easier matching
-    if (down[VK_LMENU] || down[VK_RMENU]) {
-        down[VK_MENU] = true;
-        down[VK_LMENU] = false;  // Clear the left/right alt 
-        // keys
-        down[VK_RMENU] = false;
-    }
-    
-    for (const Command& c : commands) {
-        if (c.get_key_requirements() == down) {
-            c.execute();
-            return true; // Only allow one command per call
-        }
-    }
-    return false;
-}
+    normalize_modifiers(down);
 
-std::array<bool, 256> get_bools_from_string(const std::string& str) {
-    std::array<bool, 256> ret_val;
+    // Only allow one command per call
+    size_t command = dispatcher.press(down, std::chrono::steady_clock::now());
+    if (command == KeyDispatcher::NONE) return dispatcher.is_pending();
+    client->execute(commands[command].get_program());
+    return true;
+}
 
-    for (int i = 0; i < 256; ++i) {
-        ret_val[i] = str[i] - '0';
+void CommandController::add_default_command(const std::string& name, const std::string& description, const std::string& actions, const std::vector<char>& key_reqs) {
+    std::vector<Action> program;
+    std::vector<std::string> errors;
+    compile_actions(actions, program, errors);
+    for (const std::string& error : errors) {
+        std::cerr << "Default command \"" << name << "\": " << error << '\n';
     }
+    commands.emplace_back(name, description, actions, key_reqs, program);
+}
 
-    return ret_val;
+KeyState CommandController::get_leader() const {
+    KeyState leader;
+    if (!parse_chord(Config::get_instance()->get_leader_key(), leader)) {
+        std::cerr << "Unknown leader key: " << Config::get_instance()->get_leader_key() << '\n';
+    }
+    return leader;
 }
 
 bool CommandController::load_commands() {
@@ -78,6 +72,7 @@ bool CommandController::load_commands() {
         return false;
     }
 
+    KeyState leader = get_leader();
     std::string command_name;
     while (std::getline(commands_file, command_name)) {
         std::string description;
@@ -87,334 +82,287 @@ bool CommandController::load_commands() {
             !std::getline(commands_file, key_reqs) ||
             !std::getline(commands_file, actions)) return false;
 
-        // Get the function from the action string and then create the command object and add it to the vector
-        std::istringstream iss(actions);
-        std::string action_name;
-        std::string next_token;
-        std::vector<std::function<void()>> action_functions;
-        while (iss >> action_name) {
-            if (action_name == "CHAR_LEFT") {
-                action_functions.push_back([this](){this->client->move_left();});
-            } else if (action_name == "CHAR_RIGHT") {
-                action_functions.push_back([this](){this->client->move_right();});
-            } else if (action_name == "CHAR_UP") {
-                action_functions.push_back([this](){this->client->move_up();});
-            } else if (action_name == "CHAR_DOWN") {
-                action_functions.push_back([this](){this->client->move_down();});
-            } else if (action_name == "JUMP_LEFT") {
-                action_functions.push_back([this](){this->client->jump_left();});
-            } else if (action_name == "JUMP_RIGHT") {
-                action_functions.push_back([this](){this->client->jump_right();});
-            } else if (action_name == "SAVE") {
-                iss >> next_token;
-                int file_id = std::stoi(next_token);
-                action_functions.push_back([this, file_id](){this->client->save_file(file_id); });
-            } else if (action_name == "DEL") {
-                iss >> next_token;
-                int line_number = std::stoi(next_token);
-                iss >> next_token;
-                int char_number = std::stoi(next_token);
-                iss >> next_token;
-                bool should_jump = next_token == "TRUE";
-                action_functions.push_back([this, line_number, char_number, should_jump](){this->client->get_working_file().delete_character(line_number, char_number, should_jump);});
-            } else if (action_name == "DEL_WORD") {
-                action_functions.push_back([this](){this->client->delete_group();});
-            } else if (action_name == "UNDO") {
-                action_functions.push_back([this](){this->client->get_working_file().undo();});
-            } else if (action_name == "REDO") {
-                action_functions.push_back([this](){this->client->get_working_file().redo();});
-            } else if (action_name == "CLOSE_FILE") {
-                iss >> next_token;
-                int file_id = std::stoi(next_token);
-                action_functions.push_back([this, file_id](){this->client->close_file(file_id);});
-            } else if (action_name == "SELECT_LEFT") {
-                action_functions.push_back([this](){this->client->move_left(true);});
-            } else if (action_name == "SELECT_RIGHT") {
-                action_functions.push_back([this](){this->client->move_right(true);});
-            } else if (action_name == "SELECT_UP") {
-                action_functions.push_back([this](){this->client->move_up(true);});
-            } else if (action_name == "SELECT_DOWN") {
-                action_functions.push_back([this](){this->client->move_down(true);});
-            } else if (action_name == "SELECT_WORD_LEFT") {
-                action_functions.push_back([this](){this->client->jump_left(true);});
-            } else if (action_name == "SELECT_WORD_RIGHT") {
-                action_functions.push_back([this](){this->client->jump_right(true);});
-            } else if (action_name == "COPY") {
-                action_functions.push_back([this](){
-                    HWND hwnd = GetActiveWindow();
-                    this->client->copy(hwnd);
-                });
-            } else if (action_name == "CUT") {
-                action_functions.push_back([this](){
-                    HWND hwnd = GetActiveWindow();
-                    this->client->cut(hwnd);
-                });
-            } else if (action_name == "PASTE") {
-                action_functions.push_back([this](){
-                    HWND hwnd = GetActiveWindow();
-                    this->client->paste(hwnd);
-                });
-            } else if (action_name == "SELECT_ALL") {
-                action_functions.push_back([this](){this->client->select_all();});
-            } else if (action_name == "FORMAT_BOLD") {
-                action_functions.push_back([this](){this->client->format_bold();});
-            } else if (action_name == "FORMAT_ITALIC") {
-                action_functions.push_back([this](){this->client->format_italic();});
-            } else if (action_name == "FORMAT_UNDERLINE") {
-                action_functions.push_back([this](){this->client->format_underline();});
-            } else if (action_name == "FORMAT_HIGHLIGHT") {
-                action_functions.push_back([this](){this->client->format_highlight();});
+        // Unknown actions and bad arguments are reported here rather than when the keys are pressed
+        std::vector<Action> program;
+        std::vector<std::string> errors;
+        if (!compile_actions(actions, program, errors)) {
+            for (const std::string& error : errors) {
+                std::cerr << "Command \"" << command_name << "\": " << error << '\n';
             }
+            std::cerr << "Skipping command \"" << command_name << "\" with invalid actions: " << actions << '\n';
+            continue;
         }
 
-        // Combine actions into single lambda
-        std::function<void()> command_action = [action_functions = std::move(action_functions)]() {
-            for (const auto& f : action_functions) {
-                f();
-            }
-        };
-
-        std::array<bool, 256> key_req = get_bools_from_string(key_reqs);
-        commands.emplace_back(command_name, description, actions, key_req, command_action);
+        // Files saved before key sequences existed have a single chord as 256 '0'/'1' characters
+        std::vector<KeyState> key_sequence;
+        if (is_key_string(key_reqs)) {
+            key_sequence.push_back(parse_key_string(key_reqs));
+        } else if (!parse_key_sequence(key_reqs, leader, key_sequence)) {
+            std::cerr << "Skipping command \"" << command_name << "\" with unknown keys: " << key_reqs << '\n';
+            continue;
+        }
+        commands.emplace_back(command_name, description, actions, key_sequence, program);
     }
 
     commands_file.close();
     return true;
 }
 
+void CommandController::add_missing_default_commands() {
+    std::vector<Command> loaded = std::move(commands);
+    commands.clear();
+    get_default_commands();
+    std::vector<Command> defaults = std::move(commands);
+    commands = std::move(loaded);
+
+    std::unordered_set<std::string> names;
+    for (const Command& c : commands) {
+        names.insert(c.get_name());
+    }
+    size_t loaded_count = commands.size();
+    for (Command& c : defaults) {
+        if (names.count(c.get_name()) == 0) {
+            commands.push_back(std::move(c));
+        }
+    }
+    if (commands.size() > loaded_count) {
+        save_commands();
+    }
+}
+
 void CommandController::get_default_commands() {
     // Movement commands
-    commands.emplace_back(
+    add_default_command(
         "Move Left",
         "Moves the cursor left one character",
         "CHAR_LEFT",
-        std::vector<char>({VK_LEFT}),
-        [this] () {this->client->move_left();}
+        std::vector<char>({VK_LEFT})
     );
-    commands.emplace_back(
+    add_default_command(
         "Move Right",
         "Moves the cursor right one character",
         "CHAR_RIGHT",
-        std::vector<char>({VK_RIGHT}),
-        [this] () {this->client->move_right();}
+        std::vector<char>({VK_RIGHT})
     );
-    commands.emplace_back(
+    add_default_command(
         "Move Up",
         "Moves the cursor up one line",
         "CHAR_UP",
-        std::vector<char>({VK_UP}),
-        [this] () {this->client->move_up();}
+        std::vector<char>({VK_UP})
     );
-    commands.emplace_back(
+    add_default_command(
         "Move Down",
         "Moves the cursor down one line",
         "CHAR_DOWN",
-        std::vector<char>({VK_DOWN}),
-        [this] () {this->client->move_down();}
+        std::vector<char>({VK_DOWN})
     );
-    commands.emplace_back(
+    add_default_command(
         "Jump Left",
         "Jumps left to the beginning of the previous word",
         "JUMP_LEFT",
-        std::vector<char>({VK_LEFT, VK_CONTROL}),
-        [this] () {this->client->jump_left();}
+        std::vector<char>({VK_LEFT, VK_CONTROL})
     );
-    commands.emplace_back(
+    add_default_command(
         "Jump Right",
         "Jumps right to the end of the next word",
         "JUMP_RIGHT",
-        std::vector<char>({VK_RIGHT, VK_CONTROL}),
-        [this] () {this->client->jump_right();}
+        std::vector<char>({VK_RIGHT, VK_CONTROL})
     );
     // Save command
-    commands.emplace_back(
+    add_default_command(
         "Save File",
         "Saves the working file",
         "SAVE -1",
-        std::vector<char>{'S', 17},
-        [this] () {this->client->save_file(-1);}
+        std::vector<char>{'S', 17}
     );
     // Delete Word
-    commands.emplace_back(
+    add_default_command(
         "Delete Word",
         "Delete the current word",
         "DEL_WORD",
-        std::vector<char>{VK_BACK, VK_CONTROL},
-        [this] () {this->client->delete_group();}
+        std::vector<char>{VK_BACK, VK_CONTROL}
     );
 
     // Undo and Redo
-    commands.emplace_back(
+    add_default_command(
         "Undo",
         "Undos the last action in the working file",
         "UNDO",
-        std::vector<char>{VK_CONTROL, 'Z'},
-        [this] () {this->client->get_working_file().undo();}
+        std::vector<char>{VK_CONTROL, 'Z'}
     );
-    commands.emplace_back(
+    add_default_command(
         "Redo",
         "Redoes the past undo in the working file if no edits have been made",
         "REDO",
-        std::vector<char>{VK_CONTROL, 'Y'},
-        [this] () {this->client->get_working_file().redo();}
+        std::vector<char>{VK_CONTROL, 'Y'}
     );
-    commands.emplace_back(
+    add_default_command(
         "Close File",
         "Closes the current working file",
         "CLOSE_FILE -1",
-        std::vector<char>{VK_CONTROL, 'W'},
-        [this] () {this->client->close_file();}
+        std::vector<char>{VK_CONTROL, 'W'}
     );
     // Arrow Keys with Shift for selection
-    commands.emplace_back(
+    add_default_command(
         "Select Left",
         "Extends selection to the left",
         "SELECT_LEFT",
-        std::vector<char>({VK_LEFT, VK_SHIFT}),
-        [this] () {this->client->move_left(true);}
+        std::vector<char>({VK_LEFT, VK_SHIFT})
     );
-    commands.emplace_back(
+    add_default_command(
         "Select Right",
         "Extends selection to the right",
         "SELECT_RIGHT",
-        std::vector<char>({VK_RIGHT, VK_SHIFT}),
-        [this] () {this->client->move_right(true);}
+        std::vector<char>({VK_RIGHT, VK_SHIFT})
     );
-    commands.emplace_back(
+    add_default_command(
         "Select Up",
         "Extends selection upward",
         "SELECT_UP",
-        std::vector<char>({VK_UP, VK_SHIFT}),
-        [this] () {this->client->move_up(true);}
+        std::vector<char>({VK_UP, VK_SHIFT})
     );
-    commands.emplace_back(
+    add_default_command(
         "Select Down",
         "Extends selection downward",
         "SELECT_DOWN",
-        std::vector<char>({VK_DOWN, VK_SHIFT}),
-        [this] () {this->client->move_down(true);}
+        std::vector<char>({VK_DOWN, VK_SHIFT})
     );
     
     // Ctrl+Shift+Arrow for word selection
-    commands.emplace_back(
+    add_default_command(
         "Select Word Left",
         "Extends selection to the previous word",
         "SELECT_WORD_LEFT",
-        std::vector<char>({VK_LEFT, VK_CONTROL, VK_SHIFT}),
-        [this] () {this->client->jump_left(true);}
+        std::vector<char>({VK_LEFT, VK_CONTROL, VK_SHIFT})
     );
-    commands.emplace_back(
+    add_default_command(
         "Select Word Right",
         "Extends selection to the next word",
         "SELECT_WORD_RIGHT",
-        std::vector<char>({VK_RIGHT, VK_CONTROL, VK_SHIFT}),
-        [this] () {this->client->jump_right(true);}
+        std::vector<char>({VK_RIGHT, VK_CONTROL, VK_SHIFT})
     );
     
     // Copy, Cut, Paste
-    commands.emplace_back(
+    add_default_command(
         "Copy",
         "Copies selected text to clipboard",
         "COPY",
-        std::vector<char>({VK_CONTROL, 'C'}),
-        [this] () {
-            HWND hwnd = GetActiveWindow();
-            this->client->copy(hwnd);
-        }
+        std::vector<char>({VK_CONTROL, 'C'})
     );
-    commands.emplace_back(
+    add_default_command(
         "Cut",
         "Cuts selected text to clipboard",
         "CUT",
-        std::vector<char>({VK_CONTROL, 'X'}),
-        [this] () {
-            HWND hwnd = GetActiveWindow();
-            this->client->cut(hwnd);
-        }
+        std::vector<char>({VK_CONTROL, 'X'})
     );
-    commands.emplace_back(
+    add_default_command(
         "Paste",
         "Pastes text from clipboard",
         "PASTE",
-        std::vector<char>({VK_CONTROL, 'V'}),
-        [this] () {
-            HWND hwnd = GetActiveWindow();
-            this->client->paste(hwnd);
-        }
+        std::vector<char>({VK_CONTROL, 'V'})
     );
     
     // Select All
-    commands.emplace_back(
+    add_default_command(
         "Select All",
         "Selects all text in the document",
         "SELECT_ALL",
-        std::vector<char>({VK_CONTROL, 'A'}),
-        [this] () {this->client->select_all();}
+        std::vector<char>({VK_CONTROL, 'A'})
     );
     
     // Delete key
-    commands.emplace_back(
+    add_default_command(
         "Delete",
         "Deletes the character at cursor or selected text",
         "DELETE",
-        std::vector<char>({VK_DELETE}),
-        [this] () {
-            OpenedFile& file = this->client->get_working_file();
-            if (file.get_selection().has_selection()) {
-                file.delete_selection();
-            } else {
-                int line = file.get_current_line();
-                int pos = file.get_current_character_index();
-                if (pos < file.get_num_characters(line)) {
-                    file.delete_character(line, pos + 1, false);
-                } else if (line < file.get_num_lines() - 1) {
-                    // Delete newline - merge with next line
-                    file.delete_character(line + 1, 0, false);
-                }
-            }
-        }
+        std::vector<char>({VK_DELETE})
     );
     
     // Text formatting commands
-    commands.emplace_back(
+    add_default_command(
         "Format Bold",
         "Makes selected text bold",
         "FORMAT_BOLD",
-        std::vector<char>({VK_CONTROL, 'B'}),
-        [this] () {this->client->format_bold();}
+        std::vector<char>({VK_CONTROL, 'B'})
     );
-    commands.emplace_back(
+    add_default_command(
         "Format Italic",
         "Makes selected text italic",
         "FORMAT_ITALIC",
-        std::vector<char>({VK_CONTROL, 'I'}),
-        [this] () {this->client->format_italic();}
+        std::vector<char>({VK_CONTROL, 'I'})
     );
-    commands.emplace_back(
+    add_default_command(
         "Format Underline",
         "Makes selected text underlined",
         "FORMAT_UNDERLINE",
-        std::vector<char>({VK_CONTROL, 'U'}),
-        [this] () {this->client->format_underline();}
+        std::vector<char>({VK_CONTROL, 'U'})
     );
-    commands.emplace_back(
+    add_default_command(
         "Format Highlight",
         "Highlights selected text with yellow background",
         "FORMAT_HIGHLIGHT",
-        std::vector<char>({VK_CONTROL, VK_SHIFT, 'H'}),
-        [this] () {this->client->format_highlight();}
+        std::vector<char>({VK_CONTROL, VK_SHIFT, 'H'})
     );
-}
 
-std::string key_string(const std::array<bool, 256>& keys) {
-    std::string ret_val(256, '0');
-    for (int i = 0; i < 256; ++i) {
-        if (keys[i]) {
-            ret_val[i] = '1';
-        }
-    }
+    // Keyboard macros
+    add_default_command(
+        "Record Macro",
+        "Starts recording typed text and commands into the macro, or stops recording",
+        "TOGGLE_MACRO_RECORDING",
+        std::vector<char>({VK_CONTROL, VK_SHIFT, 'R'})
+    );
+    add_default_command(
+        "Replay Macro",
+        "Replays the recorded macro as a single undo step",
+        "REPLAY_MACRO 1",
+        std::vector<char>({VK_CONTROL, VK_SHIFT, 'P'})
+    );
+    add_default_command(
+        "Replay Macro On Lines",
+        "Replays the recorded macro from the start of every selected line",
+        "REPLAY_MACRO_ON_LINES",
+        std::vector<char>({VK_CONTROL, VK_SHIFT, 'L'})
+    );
 
-    return ret_val;
+    // Multiple cursors
+    add_default_command(
+        "Select All Occurrences",
+        "Adds a cursor selecting every occurrence of the selection or the word at the cursor",
+        "SELECT_ALL_OCCURRENCES",
+        std::vector<char>({VK_CONTROL, VK_F2})
+    );
+    add_default_command(
+        "Clear Cursors",
+        "Removes every cursor but the main one and the highlighted matches of the last search",
+        "CLEAR_CURSORS CLEAR_FIND",
+        std::vector<char>({VK_ESCAPE})
+    );
+    add_default_command(
+        "Toggle Block Selection",
+        "Switches the selection between a rectangle of columns and a run of text",
+        "TOGGLE_BLOCK_SELECTION",
+        std::vector<char>({VK_CONTROL, VK_SHIFT, 'B'})
+    );
+
+    // Find
+    add_default_command(
+        "Find Selection",
+        "Highlights every match of the selection or the word at the cursor",
+        "FIND_SELECTION",
+        std::vector<char>({VK_CONTROL, 'F'})
+    );
+    add_default_command(
+        "Find Next",
+        "Selects the next match after the cursor",
+        "FIND_NEXT",
+        std::vector<char>({VK_F3})
+    );
+    add_default_command(
+        "Find Previous",
+        "Selects the previous match before the cursor",
+        "FIND_PREVIOUS",
+        std::vector<char>({VK_SHIFT, VK_F3})
+    );
 }
 
 void CommandController::save_commands() const {
@@ -422,10 +370,11 @@ void CommandController::save_commands() const {
     // Each command takes four lines
     // 1: Name
     // 2: Description
-    // 3: Keybind
+    // 3: Keybind, as chords pressed one after another, e.g. "Ctrl+K Ctrl+C" or "Leader F"
     // 4: Action
 
+    KeyState leader = get_leader();
     for (const Command& c : commands) {
-        commands_file << c.get_name() << '\n' << c.get_description() << '\n' << key_string(c.get_key_requirements()) << '\n' << c.get_action_string() << '\n';
+        commands_file << c.get_name() << '\n' << c.get_description() << '\n' << key_sequence_string(c.get_key_sequence(), leader) << '\n' << c.get_action_string() << '\n';
     }
 }
\ No newline at end of file
@@ -1,11 +1,12 @@
 #pragma once
 
-#include <functional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "client.h"
 #include "command.h"
+#include "key_dispatch.h"
 
 
 class CommandController {
@@ -18,7 +19,9 @@ public:
 
     static void init(Client* c);
 
-    bool run_commands() const;
+    /// @brief Feeds the keys that are down to the key sequence matcher, running the command they complete.
+    /// Returns true if the keys were used, either by a command or by a sequence that is still in progress.
+    bool run_commands();
 
     void save_commands() const;
 
@@ -26,14 +29,26 @@ private:
 
     void get_default_commands();
 
+    /// @brief Adds a built-in command, compiling its action string.
+    void add_default_command(const std::string& name, const std::string& description, const std::string& actions, const std::vector<char>& key_reqs);
+
     CommandController(Client* c);
 
     static CommandController* instance;
 
     bool load_commands();
 
+    /// @brief Adds the built-in commands whose names the loaded file lacks, such as ones added since it was saved,
+    /// and saves the file again if there were any. Loaded commands come first, so their key bindings win.
+    void add_missing_default_commands();
+
+    /// @brief Gets the chord "Leader" stands for in key bindings.
+    KeyState get_leader() const;
+
     std::vector<Command> commands;
 
+    KeyDispatcher dispatcher;
+
     Client* client;
 
 
@@ -5,23 +5,28 @@ Config* Config::instance = nullptr;
 
 // Default constructor initializing default values (order matches header decls)
 Config::Config() : 
-    background_color(D2D1::ColorF(0.2f, 0.2f, 0.2f, 1.0f)),
+    background_color(Color(0.2f, 0.2f, 0.2f, 1.0f)),
     line_spacing(1.0f),
     character_spacing(1.0f),
     tab_size(4),
     show_line_numbers(true),
-    line_number_color(D2D1::ColorF(D2D1::ColorF::White)),
-    indicator_color(D2D1::ColorF(D2D1::ColorF::Red)),
+    line_number_color(Color(Color::WHITE)),
+    indicator_color(Color(Color::RED)),
     left_margin(10),
     explorer_width(0),
     font_size(16.0f),
     font_family("Courier New"),
-    text_color(D2D1::ColorF(0.9f, 0.9f, 0.9f, 1.0f)),
+    text_color(Color(0.9f, 0.9f, 0.9f, 1.0f)),
     recent_files(),
     last_opened_file(""),
     working_directory(""),
-    undo_history_size(50),
-    selection_color(D2D1::ColorF(0.2f, 0.5f, 1.0f, 0.3f))  // Semi-transparent blue for selections
+    undo_memory_limit(16384),
+    undo_group_timeout(1000),
+    leader_key("Ctrl+Space"),
+    key_sequence_timeout(1000),
+    find_match_case(false),
+    find_whole_word(false),
+    selection_color(Color(0.2f, 0.5f, 1.0f, 0.3f))  // Semi-transparent blue for selections
 {}
 
 void Config::create() {
@@ -64,7 +69,12 @@ void Config::save() {
         config_file << "\n";
         config_file << "last_opened_file " << last_opened_file << "\n";
         config_file << "working_directory " << working_directory << "\n";
-        config_file << "undo_history_size " << undo_history_size << "\n";
+        config_file << "undo_memory_limit " << undo_memory_limit << "\n";
+        config_file << "undo_group_timeout " << undo_group_timeout << "\n";
+        config_file << "leader_key " << leader_key << "\n";
+        config_file << "key_sequence_timeout " << key_sequence_timeout << "\n";
+        config_file << "find_match_case " << find_match_case << "\n";
+        config_file << "find_whole_word " << find_whole_word << "\n";
         config_file << "selection_color " << selection_color.r << " " << selection_color.g << " " << selection_color.b << " " << selection_color.a << "\n";
         config_file.close();
     }
@@ -81,7 +91,7 @@ bool Config::load(const std::string& file_name) {
         if (key == "background_color") {
             float r, g, b, a;
             config_file >> r >> g >> b >> a;
-            background_color = D2D1::ColorF(r, g, b, a);
+            background_color = Color(r, g, b, a);
         } else if (key == "line_spacing") {
             config_file >> line_spacing;
         } else if (key == "character_spacing") {
@@ -93,11 +103,11 @@ bool Config::load(const std::string& file_name) {
         } else if (key == "line_number_color") {
             float r, g, b, a;
             config_file >> r >> g >> b >> a;
-            line_number_color = D2D1::ColorF(r, g, b, a);
+            line_number_color = Color(r, g, b, a);
         } else if (key == "indicator_color") {
             float r, g, b, a;
             config_file >> r >> g >> b >> a;
-            indicator_color = D2D1::ColorF(r, g, b, a);
+            indicator_color = Color(r, g, b, a);
         } else if (key == "left_margin") {
             config_file >> left_margin;
         } else if (key == "explorer_width") {
@@ -111,7 +121,7 @@ bool Config::load(const std::string& file_name) {
         } else if (key == "text_color") {
             float r, g, b, a;
             config_file >> r >> g >> b >> a;
-            text_color = D2D1::ColorF(r, g, b, a);
+            text_color = Color(r, g, b, a);
         } else if (key == "recent_files") {
             recent_files.clear();
             std::string file;
@@ -122,12 +132,22 @@ bool Config::load(const std::string& file_name) {
             config_file >> last_opened_file;
         } else if (key == "working_directory") {
             config_file >> working_directory;
-        } else if (key == "undo_history_size") {
-            config_file >> undo_history_size;
+        } else if (key == "undo_memory_limit") {
+            config_file >> undo_memory_limit;
+        } else if (key == "undo_group_timeout") {
+            config_file >> undo_group_timeout;
+        } else if (key == "leader_key") {
+            config_file >> leader_key;
+        } else if (key == "key_sequence_timeout") {
+            config_file >> key_sequence_timeout;
+        } else if (key == "find_match_case") {
+            config_file >> find_match_case;
+        } else if (key == "find_whole_word") {
+            config_file >> find_whole_word;
         } else if (key == "selection_color") {
             float r, g, b, a;
             config_file >> r >> g >> b >> a;
-            selection_color = D2D1::ColorF(r, g, b, a);
+            selection_color = Color(r, g, b, a);
         } else {
             // Unknown key, skip the rest of the line
             std::string rest_of_line;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <d2d1.h>
+#include "color.h"
 
 #include <string>
 #include <vector>
@@ -27,8 +27,8 @@ public:
     static Config* get_instance();
 
     // Getters and setters for configuration properties
-    inline D2D1::ColorF get_background_color() const { return background_color; }
-    inline void set_background_color(const D2D1::ColorF& color) { background_color = color; }
+    inline Color get_background_color() const { return background_color; }
+    inline void set_background_color(const Color& color) { background_color = color; }
     inline float get_line_spacing() const { return line_spacing; }
     inline void set_line_spacing(const float spacing) { line_spacing = spacing; }
     inline float get_character_spacing() const { return character_spacing; }
@@ -37,10 +37,10 @@ public:
     inline void set_tab_size(const int size) { tab_size = size; }
     inline bool get_show_line_numbers() const { return show_line_numbers; }
     inline void set_show_line_numbers(const bool show) { show_line_numbers = show; }
-    inline D2D1::ColorF get_line_number_color() const { return line_number_color; }
-    inline void set_line_number_color(const D2D1::ColorF& color) { line_number_color = color; }
-    inline D2D1::ColorF get_indicator_color() const { return indicator_color; }
-    inline void set_indicator_color(const D2D1::ColorF& color) { indicator_color = color; }
+    inline Color get_line_number_color() const { return line_number_color; }
+    inline void set_line_number_color(const Color& color) { line_number_color = color; }
+    inline Color get_indicator_color() const { return indicator_color; }
+    inline void set_indicator_color(const Color& color) { indicator_color = color; }
     inline int get_left_margin() const { return left_margin; }
     inline void set_left_margin(const int margin) { left_margin = margin; }
     inline int get_explorer_width() const { return explorer_width; }
@@ -49,20 +49,37 @@ public:
     inline void set_font_size(const float size) { font_size = size; }
     inline std::string get_font_family() const { return font_family; }
     inline void set_font_family(const std::string& family) { font_family = family; }
-    inline D2D1::ColorF get_text_color() const { return text_color; }
-    inline void set_text_color(const D2D1::ColorF& color) { text_color = color; }
+    inline Color get_text_color() const { return text_color; }
+    inline void set_text_color(const Color& color) { text_color = color; }
     inline std::vector<std::string> get_recent_files() const { return recent_files; }
     inline void set_recent_files(const std::vector<std::string>& files) { recent_files = files; }
     inline std::string get_last_opened_file() const { return last_opened_file; }
     inline void set_last_opened_file(const std::string& file) { last_opened_file = file; }
     inline std::string get_working_directory() const { return working_directory; }
     inline void set_working_directory(const std::string& directory) { working_directory = directory; }
-    inline int get_undo_history_size() const { return undo_history_size; }
-    inline void set_undo_history_size(const int size) { undo_history_size = size; }
+    /// @brief Kilobytes of undo history kept in memory per file before older entries are moved to disk.
+    inline int get_undo_memory_limit() const { return undo_memory_limit; }
+    inline void set_undo_memory_limit(const int limit) { undo_memory_limit = limit; }
+    /// @brief Longest pause, in milliseconds, between keystrokes that are still undone together.
+    inline int get_undo_group_timeout() const { return undo_group_timeout; }
+    inline void set_undo_group_timeout(const int timeout) { undo_group_timeout = timeout; }
+    /// @brief Chord that "Leader" stands for in key bindings, e.g. "Ctrl+Space".
+    inline std::string get_leader_key() const { return leader_key; }
+    inline void set_leader_key(const std::string& key) { leader_key = key; }
+    /// @brief Longest pause, in milliseconds, between the chords of a key sequence before it is cancelled.
+    inline int get_key_sequence_timeout() const { return key_sequence_timeout; }
+    inline void set_key_sequence_timeout(const int timeout) { key_sequence_timeout = timeout; }
+
+    /// @brief Whether find tells upper and lower case letters apart.
+    inline bool get_find_match_case() const { return find_match_case; }
+    inline void set_find_match_case(const bool match_case) { find_match_case = match_case; }
+    /// @brief Whether find only matches whole words.
+    inline bool get_find_whole_word() const { return find_whole_word; }
+    inline void set_find_whole_word(const bool whole_word) { find_whole_word = whole_word; }
 
     // Selection highlight color
-    inline D2D1::ColorF get_selection_color() const { return selection_color; }
-    inline void set_selection_color(const D2D1::ColorF& color) { selection_color = color; }
+    inline Color get_selection_color() const { return selection_color; }
+    inline void set_selection_color(const Color& color) { selection_color = color; }
 
 private:
     Config(); // Private constructor to prevent instantiation.
@@ -70,24 +87,29 @@ private:
     static Config* instance; // Static instance pointer.
 
     // Properties (declaration order for init matching)
-    D2D1::ColorF background_color;
+    Color background_color;
     float line_spacing;
     float character_spacing;
     int tab_size;
     bool show_line_numbers;
-    D2D1::ColorF line_number_color;
-    D2D1::ColorF indicator_color;
+    Color line_number_color;
+    Color indicator_color;
     int left_margin;
     int explorer_width;
 
     float font_size;
     std::string font_family;
-    D2D1::ColorF text_color;
+    Color text_color;
 
     std::vector<std::string> recent_files;
     std::string last_opened_file;
     std::string working_directory;
 
-    int undo_history_size;
-    D2D1::ColorF selection_color;  // For text selection highlights
+    int undo_memory_limit;
+    int undo_group_timeout;
+    std::string leader_key;
+    int key_sequence_timeout;
+    bool find_match_case;
+    bool find_whole_word;
+    Color selection_color;  // For text selection highlights
 };
\ No newline at end of file
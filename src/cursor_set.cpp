@@ -0,0 +1,31 @@
+#include "cursor_set.h"
+
+#include <algorithm>
+
+CursorSet::CursorSet()
+    : anchors(), cursors() {}
+
+void CursorSet::add(size_t anchor, size_t head) {
+    cursors.emplace_back(anchors.create(anchor, Gravity::RIGHT), anchors.create(head, Gravity::RIGHT));
+}
+
+void CursorSet::clear() {
+    anchors.clear();
+    cursors.clear();
+}
+
+CursorSet::Cursor CursorSet::get(size_t index) const {
+    return {anchors.get(cursors[index].first), anchors.get(cursors[index].second)};
+}
+
+std::vector<CursorSet::Cursor> CursorSet::get_sorted() const {
+    std::vector<Cursor> result;
+    result.reserve(cursors.size());
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        result.push_back(get(i));
+    }
+    std::sort(result.begin(), result.end(), [](const Cursor& a, const Cursor& b) {
+        return a.start() < b.start() || (a.start() == b.start() && a.end() < b.end());
+    });
+    return result;
+}
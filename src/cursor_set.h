@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "anchor_set.h"
+
+/// @brief The cursors added on top of a file's main cursor, each with its own selection.
+///
+/// Both ends of every cursor are anchors, so cursors keep their place in the
+/// text when edits happen anywhere in the document, including undo and redo.
+class CursorSet {
+public:
+    /// @brief A cursor's selection runs from anchor to head, and is empty when they are equal.
+    struct Cursor {
+        size_t anchor;
+        size_t head;
+
+        inline size_t start() const { return anchor < head ? anchor : head; }
+        inline size_t end() const { return anchor < head ? head : anchor; }
+    };
+
+    CursorSet();
+
+    /// @brief Adds a cursor with its head at head, selecting back to anchor.
+    void add(size_t anchor, size_t head);
+
+    /// @brief Removes every cursor.
+    void clear();
+
+    inline size_t size() const { return cursors.size(); }
+    inline bool empty() const { return cursors.empty(); }
+
+    /// @brief Gets a cursor by the order it was added in.
+    Cursor get(size_t index) const;
+
+    /// @brief Gets every cursor, ordered by where its selection starts.
+    std::vector<Cursor> get_sorted() const;
+
+    /// @brief Moves the cursors for length bytes inserted at offset.
+    inline void on_insert(size_t offset, size_t length) { anchors.on_insert(offset, length); }
+
+    /// @brief Moves the cursors for length bytes erased at offset.
+    inline void on_erase(size_t offset, size_t length) { anchors.on_erase(offset, length); }
+
+private:
+    AnchorSet anchors;
+    std::vector<std::pair<AnchorId, AnchorId>> cursors; // Anchor and head of each cursor
+};
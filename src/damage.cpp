@@ -0,0 +1,15 @@
+#include "damage.h"
+
+#include <algorithm>
+
+Damage::Damage() : first_line(TO_END), last_line(-1) {}
+
+void Damage::add(int first, int last) {
+    first_line = std::min(first_line, std::max(0, first));
+    last_line = std::max(last_line, last);
+}
+
+void Damage::clear() {
+    first_line = TO_END;
+    last_line = -1;
+}
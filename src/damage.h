@@ -0,0 +1,35 @@
+#pragma once
+
+#include <climits>
+
+/// @brief The lines of a file that have to be drawn again since it was last drawn.
+///
+/// Edits, cursor moves and selection changes add the lines they touched, and
+/// the window invalidates only the part of the screen covering those lines
+/// instead of repainting everything after every keystroke. The lines are
+/// kept as a single range, since a keystroke rarely touches lines far apart.
+class Damage {
+public:
+    /// @brief Last line of a range that runs to the end of the file.
+    static constexpr int TO_END = INT_MAX;
+
+    Damage();
+
+    /// @brief Adds the lines from first to last, inclusive.
+    void add(int first, int last);
+    inline void add(int line) { add(line, line); }
+
+    /// @brief Adds a line and every line after it, for edits that move the lines below them.
+    inline void add_from(int line) { add(line, TO_END); }
+
+    inline void add_all() { add(0, TO_END); }
+    void clear();
+
+    inline bool is_empty() const { return first_line > last_line; }
+    inline int get_first_line() const { return first_line; }
+    inline int get_last_line() const { return last_line; }
+
+private:
+    int first_line;
+    int last_line;
+};
@@ -1,41 +1,676 @@
 #include "diff_match_patch.h"
 #include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <functional>
 
-diff_match_patch::diff_match_patch() {}
+namespace {
 
-std::vector<Diff> diff_match_patch::diff_main(const std::string& text1, const std::string& text2) {
+using Operation = Diff::Operation;
+using Clock = std::chrono::steady_clock;
+
+// An operation over a run of elements, before the elements are copied out
+struct Op {
+    Operation operation;
+    size_t length;
+};
+
+void push_op(std::vector<Op>& ops, Operation operation, size_t length) {
+    if (length == 0) return;
+    if (!ops.empty() && ops.back().operation == operation) {
+        ops.back().length += length;
+    } else {
+        ops.push_back(Op{operation, length});
+    }
+}
+
+template <typename Char>
+size_t common_prefix(std::basic_string_view<Char> text1, std::basic_string_view<Char> text2) {
+    auto mismatch = std::mismatch(text1.begin(), text1.begin() + std::min(text1.size(), text2.size()), text2.begin());
+    return static_cast<size_t>(mismatch.first - text1.begin());
+}
+
+template <typename Char>
+size_t common_suffix(std::basic_string_view<Char> text1, std::basic_string_view<Char> text2) {
+    auto mismatch = std::mismatch(text1.rbegin(), text1.rbegin() + std::min(text1.size(), text2.size()), text2.rbegin());
+    return static_cast<size_t>(mismatch.first - text1.rbegin());
+}
+
+// Diagonals the edit graph is first walked on before more are allocated
+constexpr ptrdiff_t BISECT_DIAGONALS = 1024;
+
+// Myers' O(ND) diff over any kind of symbol: bytes, or whole lines hashed to numbers
+template <typename Char>
+class MyersDiff {
+public:
+    using Text = std::basic_string_view<Char>;
+
+    explicit MyersDiff(Clock::time_point deadline)
+        : deadline(deadline) {}
+
+    void diff(Text a, Text b, std::vector<Op>& ops) {
+        size_t prefix = common_prefix(a, b);
+        push_op(ops, Operation::EQUAL, prefix);
+        a.remove_prefix(prefix);
+        b.remove_prefix(prefix);
+        size_t suffix = common_suffix(a, b);
+        compute(a.substr(0, a.size() - suffix), b.substr(0, b.size() - suffix), ops);
+        push_op(ops, Operation::EQUAL, suffix);
+    }
+
+private:
+    // Expects a and b to have no common prefix or suffix
+    void compute(Text a, Text b, std::vector<Op>& ops) {
+        if (a.empty() || b.empty()) {
+            push_op(ops, Operation::DEL, a.size());
+            push_op(ops, Operation::INSERT, b.size());
+            return;
+        }
+
+        // The shorter text inside the longer one is a single insertion or deletion on each side
+        bool a_longer = a.size() > b.size();
+        Text longer = a_longer ? a : b;
+        Text shorter = a_longer ? b : a;
+        size_t found = longer.find(shorter);
+        if (found != Text::npos) {
+            Operation operation = a_longer ? Operation::DEL : Operation::INSERT;
+            push_op(ops, operation, found);
+            push_op(ops, Operation::EQUAL, shorter.size());
+            push_op(ops, operation, longer.size() - found - shorter.size());
+            return;
+        }
+        if (shorter.size() == 1) {
+            push_op(ops, Operation::DEL, a.size());
+            push_op(ops, Operation::INSERT, b.size());
+            return;
+        }
+        bisect(a, b, ops);
+    }
+
+    // Walks the edit graph from both ends at once until the paths meet in the middle snake,
+    // then diffs the two halves on either side of it
+    void bisect(Text a, Text b, std::vector<Op>& ops) {
+        const ptrdiff_t n = static_cast<ptrdiff_t>(a.size());
+        const ptrdiff_t m = static_cast<ptrdiff_t>(b.size());
+        const ptrdiff_t max_d = (n + m + 1) / 2;
+        // Furthest x reached on each diagonal, forwards in v1 and backwards in v2. Only the diagonals
+        // reached so far are kept, so texts that differ little cost little memory however long they are.
+        ptrdiff_t offset = std::min<ptrdiff_t>(max_d, BISECT_DIAGONALS);
+        ptrdiff_t length = 2 * offset;
+        std::vector<ptrdiff_t> v1(static_cast<size_t>(length), -1);
+        std::vector<ptrdiff_t> v2(static_cast<size_t>(length), -1);
+        v1[offset + 1] = 0;
+        v2[offset + 1] = 0;
+        const ptrdiff_t delta = n - m;
+        // With an odd delta the forward path is the one that runs into the reverse one
+        const bool front = delta % 2 != 0;
+        // Diagonals that ran off the edge of the graph are not walked again
+        ptrdiff_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+
+        for (ptrdiff_t d = 0; d < max_d; ++d) {
+            if (Clock::now() > deadline) break;
+            if (d >= offset) {
+                ptrdiff_t grown = std::min(max_d, offset * 2);
+                widen(v1, offset, grown);
+                widen(v2, offset, grown);
+                offset = grown;
+                length = 2 * grown;
+            }
+
+            for (ptrdiff_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+                ptrdiff_t k1_offset = offset + k1;
+                ptrdiff_t x1 = (k1 == -d || (k1 != d && v1[k1_offset - 1] < v1[k1_offset + 1]))
+                    ? v1[k1_offset + 1] : v1[k1_offset - 1] + 1;
+                ptrdiff_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && a[x1] == b[y1]) {
+                    ++x1;
+                    ++y1;
+                }
+                v1[k1_offset] = x1;
+                if (x1 > n) {
+                    k1_end += 2;
+                } else if (y1 > m) {
+                    k1_start += 2;
+                } else if (front) {
+                    ptrdiff_t k2_offset = offset + delta - k1;
+                    if (k2_offset >= 0 && k2_offset < length && v2[k2_offset] != -1 && x1 >= n - v2[k2_offset]) {
+                        split(a, b, x1, y1, ops);
+                        return;
+                    }
+                }
+            }
+
+            for (ptrdiff_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+                ptrdiff_t k2_offset = offset + k2;
+                ptrdiff_t x2 = (k2 == -d || (k2 != d && v2[k2_offset - 1] < v2[k2_offset + 1]))
+                    ? v2[k2_offset + 1] : v2[k2_offset - 1] + 1;
+                ptrdiff_t y2 = x2 - k2;
+                while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) {
+                    ++x2;
+                    ++y2;
+                }
+                v2[k2_offset] = x2;
+                if (x2 > n) {
+                    k2_end += 2;
+                } else if (y2 > m) {
+                    k2_start += 2;
+                } else if (!front) {
+                    ptrdiff_t k1_offset = offset + delta - k2;
+                    if (k1_offset >= 0 && k1_offset < length && v1[k1_offset] != -1) {
+                        ptrdiff_t x1 = v1[k1_offset];
+                        ptrdiff_t y1 = offset + x1 - k1_offset;
+                        if (x1 >= n - x2) {
+                            split(a, b, x1, y1, ops);
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+        // Out of time, or the texts have nothing in common
+        push_op(ops, Operation::DEL, a.size());
+        push_op(ops, Operation::INSERT, b.size());
+    }
+
+    // Recentres diagonals kept around offset on a larger one
+    static void widen(std::vector<ptrdiff_t>& v, ptrdiff_t offset, ptrdiff_t grown) {
+        std::vector<ptrdiff_t> wider(static_cast<size_t>(2 * grown), -1);
+        std::copy(v.begin(), v.end(), wider.begin() + (grown - offset));
+        v = std::move(wider);
+    }
+
+    void split(Text a, Text b, ptrdiff_t x, ptrdiff_t y, std::vector<Op>& ops) {
+        diff(a.substr(0, static_cast<size_t>(x)), b.substr(0, static_cast<size_t>(y)), ops);
+        diff(a.substr(static_cast<size_t>(x)), b.substr(static_cast<size_t>(y)), ops);
+    }
+
+    Clock::time_point deadline;
+};
+
+// Numbers every distinct line, in an open addressing table so that a million lines cost no allocations each
+class LineCodes {
+public:
+    explicit LineCodes(size_t expected)
+        : lines(), slots(std::bit_ceil(std::max<size_t>(16, expected * 2)), 0) {
+        lines.reserve(expected);
+    }
+
+    char32_t code(std::string_view line) {
+        size_t mask = slots.size() - 1;
+        for (size_t slot = std::hash<std::string_view>()(line) & mask;; slot = (slot + 1) & mask) {
+            if (slots[slot] == 0) {
+                // Half full at most, so probes stay short
+                if (lines.size() * 2 >= slots.size()) {
+                    grow();
+                    return code(line);
+                }
+                lines.push_back(line);
+                slots[slot] = static_cast<uint32_t>(lines.size());
+                return static_cast<char32_t>(lines.size() - 1);
+            }
+            if (lines[slots[slot] - 1] == line) return static_cast<char32_t>(slots[slot] - 1);
+        }
+    }
+
+    inline std::string_view line(char32_t code) const { return lines[code]; }
+
+private:
+    void grow() {
+        std::vector<uint32_t> old = std::move(slots);
+        slots.assign(old.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+        for (uint32_t entry : old) {
+            if (entry == 0) continue;
+            size_t slot = std::hash<std::string_view>()(lines[entry - 1]) & mask;
+            while (slots[slot] != 0) slot = (slot + 1) & mask;
+            slots[slot] = entry;
+        }
+    }
+
+    std::vector<std::string_view> lines; // By code
+    std::vector<uint32_t> slots;         // Code + 1, or 0 when empty
+};
+
+// The longest suffix of text1 that is also a prefix of text2
+size_t common_overlap(std::string_view text1, std::string_view text2) {
+    if (text1.empty() || text2.empty()) return 0;
+    if (text1.size() > text2.size()) {
+        text1 = text1.substr(text1.size() - text2.size());
+    } else {
+        text2 = text2.substr(0, text1.size());
+    }
+    size_t n = text1.size();
+    if (text1 == text2) return n;
+
+    // Grows the overlap by searching for ever longer suffixes of text1 in text2
+    size_t best = 0;
+    size_t length = 1;
+    while (true) {
+        size_t found = text2.find(text1.substr(n - length));
+        if (found == std::string_view::npos) return best;
+        length += found;
+        if (found == 0 || text1.substr(n - length) == text2.substr(0, length)) {
+            best = length;
+            ++length;
+        }
+    }
+}
+
+// Bytes of multi-byte UTF-8 characters count as letters, so that no boundary is found inside one
+bool is_alphanumeric(char c) {
+    return static_cast<unsigned char>(c) >= 0x80 || std::isalnum(static_cast<unsigned char>(c));
+}
+
+bool is_whitespace(char c) {
+    return std::isspace(static_cast<unsigned char>(c));
+}
+
+// How good a boundary at position in text is, from 6 at either end down to 0 inside a word
+int boundary_score(std::string_view text, size_t position) {
+    if (position == 0 || position == text.size()) return 6;
+
+    char c1 = text[position - 1];
+    char c2 = text[position];
+    bool non_alphanumeric1 = !is_alphanumeric(c1);
+    bool non_alphanumeric2 = !is_alphanumeric(c2);
+    bool whitespace1 = non_alphanumeric1 && is_whitespace(c1);
+    bool whitespace2 = non_alphanumeric2 && is_whitespace(c2);
+    bool line_break1 = whitespace1 && (c1 == '\r' || c1 == '\n');
+    bool line_break2 = whitespace2 && (c2 == '\r' || c2 == '\n');
+    // A blank line ends in "\n\n" or "\n\r\n" before the boundary, or starts with two line breaks after it
+    std::string_view before = text.substr(0, position);
+    std::string_view after = text.substr(position);
+    bool blank_line1 = line_break1 && (before.ends_with("\n\n") || before.ends_with("\n\r\n"));
+    bool blank_line2 = line_break2 && (after.starts_with("\n\n") || after.starts_with("\n\r\n")
+                                       || after.starts_with("\r\n\n") || after.starts_with("\r\n\r\n"));
+
+    if (blank_line1 || blank_line2) return 5;
+    if (line_break1 || line_break2) return 4;
+    // The end of a sentence
+    if (non_alphanumeric1 && !whitespace1 && whitespace2) return 3;
+    if (whitespace1 || whitespace2) return 2;
+    if (non_alphanumeric1 || non_alphanumeric2) return 1;
+    return 0;
+}
+
+} // namespace
+
+diff_match_patch::diff_match_patch()
+    : diff_timeout(1.0f), diff_edit_cost(4) {}
+
+std::vector<Diff> diff_match_patch::diff_main(const std::string& text1, const std::string& text2, bool checklines) {
+    Deadline deadline = Deadline::max();
+    if (diff_timeout > 0) {
+        deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(diff_timeout));
+    }
+    return diff_main(std::string_view(text1), std::string_view(text2), checklines, deadline);
+}
+
+std::vector<Diff> diff_match_patch::diff_main(std::string_view text1, std::string_view text2, bool checklines, Deadline deadline) {
     std::vector<Diff> diffs;
+    size_t prefix = common_prefix(text1, text2);
+    size_t suffix = common_suffix(text1.substr(prefix), text2.substr(prefix));
+    std::string_view middle1 = text1.substr(prefix, text1.size() - prefix - suffix);
+    std::string_view middle2 = text2.substr(prefix, text2.size() - prefix - suffix);
+
+    if (prefix > 0) diffs.push_back(Diff(Operation::EQUAL, std::string(text1.substr(0, prefix))));
+    if (checklines && middle1.size() > 100 && middle2.size() > 100) {
+        std::vector<Diff> lines = diff_line_mode(middle1, middle2, deadline);
+        std::move(lines.begin(), lines.end(), std::back_inserter(diffs));
+    } else {
+        std::vector<Op> ops;
+        MyersDiff<char>(deadline).diff(middle1, middle2, ops);
+        size_t i = 0;
+        size_t j = 0;
+        for (const Op& op : ops) {
+            if (op.operation == Operation::INSERT) {
+                diffs.push_back(Diff(op.operation, std::string(middle2.substr(j, op.length))));
+                j += op.length;
+            } else {
+                diffs.push_back(Diff(op.operation, std::string(middle1.substr(i, op.length))));
+                i += op.length;
+                if (op.operation == Operation::EQUAL) j += op.length;
+            }
+        }
+    }
+    if (suffix > 0) diffs.push_back(Diff(Operation::EQUAL, std::string(text1.substr(text1.size() - suffix))));
+
+    diff_cleanup_merge(diffs);
+    return diffs;
+}
 
+std::vector<Diff> diff_match_patch::diff_line_mode(std::string_view text1, std::string_view text2, Deadline deadline) {
+    // Every distinct line, with its line break, becomes one symbol
+    LineCodes codes(static_cast<size_t>(std::count(text1.begin(), text1.end(), '\n')) + 1);
+    auto encode = [&](std::string_view text) {
+        std::u32string encoded;
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            std::string_view line = text.substr(0, end == std::string_view::npos ? text.size() : end + 1);
+            text.remove_prefix(line.size());
+            encoded.push_back(codes.code(line));
+        }
+        return encoded;
+    };
+    std::u32string encoded1 = encode(text1);
+    std::u32string encoded2 = encode(text2);
+
+    std::vector<Op> ops;
+    MyersDiff<char32_t>(deadline).diff(encoded1, encoded2, ops);
+    std::vector<Diff> diffs;
     size_t i = 0;
-    size_t min_len = std::min(text1.size(), text2.size());
+    size_t j = 0;
+    for (const Op& op : ops) {
+        const std::u32string& encoded = op.operation == Operation::INSERT ? encoded2 : encoded1;
+        size_t& at = op.operation == Operation::INSERT ? j : i;
+        std::string text;
+        for (size_t line = at; line < at + op.length; ++line) text.append(codes.line(encoded[line]));
+        diffs.push_back(Diff(op.operation, text));
+        at += op.length;
+        if (op.operation == Operation::EQUAL) j += op.length;
+    }
+
+    // Joins up runs of changed lines split by a line that happens to be the same, such as a blank one
+    diff_cleanup_semantic(diffs);
 
-    // Find common prefix
-    while (i < min_len && text1[i] == text2[i]) {
-        ++i;
+    // Each run of deleted and inserted lines is diffed again, character by character
+    std::vector<Diff> result;
+    std::string deleted;
+    std::string inserted;
+    diffs.push_back(Diff(Operation::EQUAL, ""));
+    for (Diff& diff : diffs) {
+        if (diff.operation == Operation::DEL) {
+            deleted += diff.text;
+            continue;
+        }
+        if (diff.operation == Operation::INSERT) {
+            inserted += diff.text;
+            continue;
+        }
+        if (!deleted.empty() && !inserted.empty()) {
+            std::vector<Diff> characters = diff_main(deleted, inserted, false, deadline);
+            std::move(characters.begin(), characters.end(), std::back_inserter(result));
+        } else {
+            if (!deleted.empty()) result.push_back(Diff(Operation::DEL, deleted));
+            if (!inserted.empty()) result.push_back(Diff(Operation::INSERT, inserted));
+        }
+        deleted.clear();
+        inserted.clear();
+        if (!diff.text.empty()) result.push_back(std::move(diff));
     }
-    if (i > 0) {
-        diffs.push_back(Diff(Diff::Operation::EQUAL, text1.substr(0, i)));
+    return result;
+}
+
+void diff_match_patch::diff_cleanup_semantic(std::vector<Diff>& diffs) {
+    bool changes = false;
+    std::vector<size_t> equalities; // Indices of equalities that are candidates for removal
+    std::string last_equality;
+    // Characters changed before and after the last equality
+    size_t insertions_before = 0, deletions_before = 0;
+    size_t insertions_after = 0, deletions_after = 0;
+    for (ptrdiff_t pointer = 0; pointer < static_cast<ptrdiff_t>(diffs.size()); ++pointer) {
+        Diff& diff = diffs[pointer];
+        if (diff.operation == Operation::EQUAL) {
+            equalities.push_back(static_cast<size_t>(pointer));
+            insertions_before = insertions_after;
+            deletions_before = deletions_after;
+            insertions_after = 0;
+            deletions_after = 0;
+            last_equality = diff.text;
+            continue;
+        }
+        (diff.operation == Operation::INSERT ? insertions_after : deletions_after) += diff.text.size();
+
+        // An equality no longer than the edits on both sides of it is turned into a deletion and an insertion
+        if (!last_equality.empty() && last_equality.size() <= std::max(insertions_before, deletions_before)
+            && last_equality.size() <= std::max(insertions_after, deletions_after)) {
+            size_t at = equalities.back();
+            diffs.insert(diffs.begin() + static_cast<ptrdiff_t>(at), Diff(Operation::DEL, last_equality));
+            diffs[at + 1].operation = Operation::INSERT;
+            // The previous equality has to be looked at again, now that its neighbours grew
+            equalities.pop_back();
+            if (!equalities.empty()) equalities.pop_back();
+            pointer = equalities.empty() ? -1 : static_cast<ptrdiff_t>(equalities.back());
+            insertions_before = deletions_before = 0;
+            insertions_after = deletions_after = 0;
+            last_equality.clear();
+            changes = true;
+        }
     }
 
-    // Find common suffix
-    size_t j = 0;
-    while (j < min_len - i && text1[text1.size() - 1 - j] == text2[text2.size() - 1 - j]) {
-        ++j;
+    if (changes) diff_cleanup_merge(diffs);
+    diff_cleanup_semantic_lossless(diffs);
+
+    // A deletion and an insertion that overlap by at least half of either share the overlap as an equality,
+    // e.g. <del>abcxxx</del><ins>xxxdef</ins> becomes <del>abc</del>xxx<ins>def</ins>
+    for (size_t pointer = 1; pointer < diffs.size(); ++pointer) {
+        if (diffs[pointer - 1].operation != Operation::DEL || diffs[pointer].operation != Operation::INSERT) continue;
+        std::string deletion = diffs[pointer - 1].text;
+        std::string insertion = diffs[pointer].text;
+        size_t overlap1 = common_overlap(deletion, insertion);
+        size_t overlap2 = common_overlap(insertion, deletion);
+        if (overlap1 >= overlap2) {
+            if (overlap1 * 2 >= deletion.size() || overlap1 * 2 >= insertion.size()) {
+                diffs.insert(diffs.begin() + static_cast<ptrdiff_t>(pointer), Diff(Operation::EQUAL, insertion.substr(0, overlap1)));
+                diffs[pointer - 1].text = deletion.substr(0, deletion.size() - overlap1);
+                diffs[pointer + 1].text = insertion.substr(overlap1);
+                ++pointer;
+            }
+        } else if (overlap2 * 2 >= deletion.size() || overlap2 * 2 >= insertion.size()) {
+            // The insertion ends with what the deletion starts with, so they swap places around the overlap
+            diffs.insert(diffs.begin() + static_cast<ptrdiff_t>(pointer), Diff(Operation::EQUAL, deletion.substr(0, overlap2)));
+            diffs[pointer - 1] = Diff(Operation::INSERT, insertion.substr(0, insertion.size() - overlap2));
+            diffs[pointer + 1] = Diff(Operation::DEL, deletion.substr(overlap2));
+            ++pointer;
+        }
+        ++pointer;
     }
+}
 
-    // Middle parts are different
-    std::string mid1 = text1.substr(i, text1.size() - i - j);
-    std::string mid2 = text2.substr(i, text2.size() - i - j);
+void diff_match_patch::diff_cleanup_semantic_lossless(std::vector<Diff>& diffs) {
+    // The first and last diffs are never between two equalities
+    for (size_t pointer = 1; pointer + 1 < diffs.size(); ++pointer) {
+        if (diffs[pointer - 1].operation != Operation::EQUAL || diffs[pointer + 1].operation != Operation::EQUAL) continue;
 
-    if (!mid1.empty()) diffs.push_back(Diff(Diff::Operation::DEL, mid1));
-    if (!mid2.empty()) diffs.push_back(Diff(Diff::Operation::INSERT, mid2));
+        // Sliding the edit keeps the three texts joined together the same, only the two boundaries move
+        std::string joined = diffs[pointer - 1].text + diffs[pointer].text + diffs[pointer + 1].text;
+        size_t original = diffs[pointer - 1].text.size();
+        size_t start = original;
+        size_t end = start + diffs[pointer].text.size();
+        if (start == end) continue;
 
-    // Add common suffix
-    if (j > 0) {
-        diffs.push_back(Diff(Diff::Operation::EQUAL, text1.substr(text1.size() - j)));
+        // As far left as it goes first, then one character at a time to the right
+        while (start > 0 && joined[start - 1] == joined[end - 1]) {
+            --start;
+            --end;
+        }
+        size_t best = start;
+        int best_score = boundary_score(joined, start) + boundary_score(joined, end);
+        while (end < joined.size() && joined[start] == joined[end]) {
+            ++start;
+            ++end;
+            int score = boundary_score(joined, start) + boundary_score(joined, end);
+            // Ties go to the rightmost position, as in diff-match-patch
+            if (score >= best_score) {
+                best_score = score;
+                best = start;
+            }
+        }
+        if (best == original) continue;
+
+        size_t length = diffs[pointer].text.size();
+        diffs[pointer].text = joined.substr(best, length);
+        if (best + length < joined.size()) {
+            diffs[pointer + 1].text = joined.substr(best + length);
+        } else {
+            diffs.erase(diffs.begin() + static_cast<ptrdiff_t>(pointer) + 1);
+        }
+        if (best > 0) {
+            diffs[pointer - 1].text = joined.substr(0, best);
+        } else {
+            diffs.erase(diffs.begin() + static_cast<ptrdiff_t>(pointer) - 1);
+            --pointer;
+        }
     }
+}
 
-    return diffs;
+void diff_match_patch::diff_cleanup_efficiency(std::vector<Diff>& diffs) {
+    bool changes = false;
+    std::vector<size_t> equalities; // Indices of equalities that are candidates for removal
+    std::string last_equality;
+    // Whether there is an insertion or deletion before and after the last equality
+    bool insertion_before = false, deletion_before = false;
+    bool insertion_after = false, deletion_after = false;
+    for (ptrdiff_t pointer = 0; pointer < static_cast<ptrdiff_t>(diffs.size()); ++pointer) {
+        Diff& diff = diffs[pointer];
+        if (diff.operation == Operation::EQUAL) {
+            if (diff.text.size() < static_cast<size_t>(diff_edit_cost) && (insertion_after || deletion_after)) {
+                equalities.push_back(static_cast<size_t>(pointer));
+                insertion_before = insertion_after;
+                deletion_before = deletion_after;
+                last_equality = diff.text;
+            } else {
+                // Not a candidate, and can never become one
+                equalities.clear();
+                last_equality.clear();
+            }
+            insertion_after = false;
+            deletion_after = false;
+            continue;
+        }
+        (diff.operation == Operation::DEL ? deletion_after : insertion_after) = true;
+
+        // A short equality between edits on all four sides, or half as short between edits on three,
+        // such as <ins>A</ins><del>B</del>XY<ins>C</ins><del>D</del> or <ins>A</ins>X<ins>C</ins><del>D</del>
+        int sides = insertion_before + deletion_before + insertion_after + deletion_after;
+        if (!last_equality.empty()
+            && (sides == 4 || (last_equality.size() < static_cast<size_t>(diff_edit_cost / 2) && sides == 3))) {
+            size_t at = equalities.back();
+            diffs.insert(diffs.begin() + static_cast<ptrdiff_t>(at), Diff(Operation::DEL, last_equality));
+            diffs[at + 1].operation = Operation::INSERT;
+            equalities.pop_back();
+            last_equality.clear();
+            if (insertion_before && deletion_before) {
+                // Nothing before this equality can change any more
+                insertion_after = deletion_after = true;
+                equalities.clear();
+            } else {
+                if (!equalities.empty()) equalities.pop_back();
+                pointer = equalities.empty() ? -1 : static_cast<ptrdiff_t>(equalities.back());
+                insertion_after = deletion_after = false;
+            }
+            changes = true;
+        }
+    }
+
+    if (changes) diff_cleanup_merge(diffs);
+}
+
+void diff_match_patch::diff_cleanup_merge(std::vector<Diff>& diffs) {
+    // An empty equality at the end closes the last run of edits
+    diffs.push_back(Diff(Operation::EQUAL, ""));
+    size_t pointer = 0;
+    size_t count_delete = 0;
+    size_t count_insert = 0;
+    std::string text_delete;
+    std::string text_insert;
+    while (pointer < diffs.size()) {
+        if (diffs[pointer].operation == Operation::INSERT) {
+            ++count_insert;
+            text_insert += diffs[pointer].text;
+            ++pointer;
+            continue;
+        }
+        if (diffs[pointer].operation == Operation::DEL) {
+            ++count_delete;
+            text_delete += diffs[pointer].text;
+            ++pointer;
+            continue;
+        }
+
+        if (count_delete + count_insert > 1) {
+            if (count_delete != 0 && count_insert != 0) {
+                // Text at the start of both sides goes to the equality before them
+                size_t common = common_prefix(std::string_view(text_insert), std::string_view(text_delete));
+                if (common != 0) {
+                    size_t before = pointer - count_delete - count_insert;
+                    if (before > 0 && diffs[before - 1].operation == Operation::EQUAL) {
+                        diffs[before - 1].text += text_insert.substr(0, common);
+                    } else {
+                        diffs.insert(diffs.begin(), Diff(Operation::EQUAL, text_insert.substr(0, common)));
+                        ++pointer;
+                    }
+                    text_insert.erase(0, common);
+                    text_delete.erase(0, common);
+                }
+                // And text at the end of both to the equality after them
+                common = common_suffix(std::string_view(text_insert), std::string_view(text_delete));
+                if (common != 0) {
+                    diffs[pointer].text = text_insert.substr(text_insert.size() - common) + diffs[pointer].text;
+                    text_insert.resize(text_insert.size() - common);
+                    text_delete.resize(text_delete.size() - common);
+                }
+            }
+            // The whole run becomes at most one deletion followed by one insertion
+            pointer -= count_delete + count_insert;
+            diffs.erase(diffs.begin() + static_cast<ptrdiff_t>(pointer),
+                        diffs.begin() + static_cast<ptrdiff_t>(pointer + count_delete + count_insert));
+            if (!text_delete.empty()) {
+                diffs.insert(diffs.begin() + static_cast<ptrdiff_t>(pointer), Diff(Operation::DEL, text_delete));
+                ++pointer;
+            }
+            if (!text_insert.empty()) {
+                diffs.insert(diffs.begin() + static_cast<ptrdiff_t>(pointer), Diff(Operation::INSERT, text_insert));
+                ++pointer;
+            }
+            ++pointer;
+        } else if (pointer != 0 && diffs[pointer - 1].operation == Operation::EQUAL) {
+            diffs[pointer - 1].text += diffs[pointer].text;
+            diffs.erase(diffs.begin() + static_cast<ptrdiff_t>(pointer));
+        } else {
+            ++pointer;
+        }
+        count_delete = 0;
+        count_insert = 0;
+        text_delete.clear();
+        text_insert.clear();
+    }
+    if (!diffs.empty() && diffs.back().text.empty()) diffs.pop_back();
+
+    // A single edit between two equalities that can slide over one of them entirely removes that equality,
+    // e.g. A<ins>BA</ins>C becomes <ins>AB</ins>AC
+    bool changes = false;
+    for (size_t pointer = 1; pointer + 1 < diffs.size(); ++pointer) {
+        if (diffs[pointer - 1].operation != Operation::EQUAL || diffs[pointer + 1].operation != Operation::EQUAL) continue;
+        const std::string& previous = diffs[pointer - 1].text;
+        const std::string& next = diffs[pointer + 1].text;
+        std::string& current = diffs[pointer].text;
+        if (current.ends_with(previous)) {
+            current = previous + current.substr(0, current.size() - previous.size());
+            diffs[pointer + 1].text = previous + next;
+            diffs.erase(diffs.begin() + static_cast<ptrdiff_t>(pointer) - 1);
+            changes = true;
+        } else if (current.starts_with(next)) {
+            diffs[pointer - 1].text += next;
+            current = current.substr(next.size()) + next;
+            diffs.erase(diffs.begin() + static_cast<ptrdiff_t>(pointer) + 1);
+            changes = true;
+        }
+    }
+    if (changes) diff_cleanup_merge(diffs);
+}
+
+std::string diff_match_patch::diff_text1(const std::vector<Diff>& diffs) {
+    std::string result;
+    for (const auto& d : diffs) {
+        if (d.operation != Diff::Operation::INSERT) {
+            result += d.text;
+        }
+    }
+    return result;
 }
 
 std::string diff_match_patch::diff_text2(const std::vector<Diff>& diffs) {
@@ -1,5 +1,7 @@
 #pragma once
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 
@@ -8,15 +10,63 @@ struct Diff {
     std::string text;
 
     Diff(Operation op, const std::string& t) : operation(op), text(t) {}
+
+    bool operator==(const Diff& other) const = default;
 };
 
+/// @brief Finds the differences between two texts, as in Neil Fraser's diff-match-patch.
+///
+/// Texts are compared byte by byte, so a change inside a multi-byte UTF-8 character
+/// may be reported as a change of only some of its bytes.
 class diff_match_patch {
 public:
     diff_match_patch();
 
-    // Returns a vector of Diff objects between two strings
-    std::vector<Diff> diff_main(const std::string& text1, const std::string& text2);
+    /// @brief Seconds a diff may take before it settles for a coarser result, or 0 for no limit.
+    inline float get_diff_timeout() const { return diff_timeout; }
+    inline void set_diff_timeout(float seconds) { diff_timeout = seconds; }
+
+    /// @brief What an edit costs in characters of equality, for diff_cleanup_efficiency.
+    inline int get_diff_edit_cost() const { return diff_edit_cost; }
+    inline void set_diff_edit_cost(int cost) { diff_edit_cost = cost; }
+
+    /// @brief Returns the edits that turn text1 into text2.
+    ///
+    /// The common prefix and suffix are split off first, and what is left is diffed with
+    /// Myers' O(ND) algorithm, which recurses on the middle snake of the edit graph and so
+    /// needs only linear memory. The result is proportional to the change rather than to
+    /// the texts. With checklines, long texts are first diffed line by line, with each
+    /// distinct line hashed to a single symbol, and only the changed lines are diffed again
+    /// character by character; that is much faster at the price of a slightly less minimal
+    /// diff. Past the timeout the remaining parts are reported as a deletion and an insertion.
+    std::vector<Diff> diff_main(const std::string& text1, const std::string& text2, bool checklines = true);
+
+    /// @brief Removes equalities that are too short to be meaningful, so that a diff reads well to people.
+    void diff_cleanup_semantic(std::vector<Diff>& diffs);
+
+    /// @brief Slides single edits between equalities so that they line up with word and line boundaries.
+    void diff_cleanup_semantic_lossless(std::vector<Diff>& diffs);
+
+    /// @brief Removes equalities that cost more to keep than to fold into the edits around them, so that a diff is cheap to apply.
+    void diff_cleanup_efficiency(std::vector<Diff>& diffs);
+
+    /// @brief Merges neighbouring edits of the same kind and factors text they share out into equalities.
+    void diff_cleanup_merge(std::vector<Diff>& diffs);
+
+    /// @brief Returns the text the diffs were computed from.
+    std::string diff_text1(const std::vector<Diff>& diffs);
 
     // Convert a vector of Diff objects back into a single string
     std::string diff_text2(const std::vector<Diff>& diffs);
+
+private:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    std::vector<Diff> diff_main(std::string_view text1, std::string_view text2, bool checklines, Deadline deadline);
+
+    /// @brief Diffs line by line, then character by character within each run of changed lines.
+    std::vector<Diff> diff_line_mode(std::string_view text1, std::string_view text2, Deadline deadline);
+
+    float diff_timeout;
+    int diff_edit_cost;
 };
@@ -1,41 +1,269 @@
 #include "edit.h"
 
-Edit::Edit(const std::function<bool()>& edit_function, const std::function<bool()>& undo_function, const std::function<void()>& cleanup)
-    : edit_function(edit_function), undo_function(undo_function), cleanup(cleanup) {}
+#include <cstring>
 
-Edit::Edit(std::function<bool()>&& edit_function, std::function<bool()>&& undo_function, std::function<void()>&& cleanup)
-    : edit_function(std::move(edit_function)), undo_function(std::move(undo_function)), cleanup(std::move(cleanup)) {
-
-    cleanup = [] () { return; };
+std::string pack_replacements(const std::vector<Replacement>& spans, std::string_view removed, std::string_view inserted) {
+    uint64_t count = spans.size();
+    std::string packed;
+    packed.reserve(sizeof(count) + spans.size() * sizeof(Replacement) + removed.size() + inserted.size());
+    packed.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    packed.append(reinterpret_cast<const char*>(spans.data()), spans.size() * sizeof(Replacement));
+    packed.append(removed);
+    packed.append(inserted);
+    return packed;
 }
 
-Edit::~Edit() {
-    this->cleanup();
+void unpack_replacements(std::string_view packed, std::vector<Replacement>& spans, std::string_view& removed, std::string_view& inserted) {
+    uint64_t count = 0;
+    std::memcpy(&count, packed.data(), sizeof(count));
+    spans.resize(count);
+    std::memcpy(spans.data(), packed.data() + sizeof(count), count * sizeof(Replacement));
+
+    size_t removed_length = 0;
+    for (const Replacement& span : spans) {
+        removed_length += span.removed_length;
+    }
+    size_t text_start = sizeof(count) + count * sizeof(Replacement);
+    removed = packed.substr(text_start, removed_length);
+    inserted = packed.substr(text_start + removed_length);
 }
 
-Edit::Edit(Edit&& other) noexcept
-    : edit_function(std::move(other.edit_function)), undo_function(std::move(other.undo_function)), cleanup(std::move(other.cleanup)) {
-    other.cleanup = [] () { return; };
+EditLog::EditLog(const EditLog& other)
+    : entries(other.entries),
+      arena(other.arena),
+      applied(other.applied),
+      memory_limit(other.memory_limit),
+      journal(),
+      spilled(other.spilled),
+      spilled_entries(other.spilled_entries),
+      redo_journal(),
+      redo_spilled(other.redo_spilled) {
+    // Journals are never shared, so the copy gets a journal of its own with the same blocks
+    if (other.journal) {
+        journal = std::make_unique<EditJournal>();
+        if (!journal->is_open() || !journal->copy_from(*other.journal, other.journal->size())) {
+            journal.reset();
+            spilled.clear();
+            spilled_entries = 0;
+        }
+    }
+    if (other.redo_journal) {
+        redo_journal = std::make_unique<EditJournal>();
+        if (!redo_journal->is_open() || !redo_journal->copy_from(*other.redo_journal, other.redo_journal->size())) {
+            redo_journal.reset();
+            redo_spilled.clear();
+        }
+    }
 }
 
-Edit&& Edit::operator=(Edit&& other) noexcept {
+EditLog& EditLog::operator=(const EditLog& other) {
     if (this != &other) {
-        this->edit_function = std::move(other.edit_function);
-        this->undo_function = std::move(other.undo_function);
-        this->cleanup = std::move(other.cleanup);
-        other.cleanup = [] () { return; };
+        EditLog copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+void EditLog::push(const Edit& edit, std::string_view text) {
+    // A new edit makes everything after it unreachable, and the arena is laid out in entry order
+    if (applied < entries.size()) {
+        arena.resize(entries[applied].text_offset);
+        entries.resize(applied);
     }
-    return std::move(*this);
+    if (redo_journal) {
+        redo_journal->truncate(0);
+    }
+    redo_spilled.clear();
+
+    Edit& entry = entries.emplace_back(edit);
+    entry.length = text.size();
+    entry.text_offset = arena.size();
+    arena.append(text);
+    ++applied;
+    enforce_limit();
 }
 
-Edit::Edit(const Edit& other)
-    : edit_function(other.edit_function), undo_function(other.undo_function), cleanup(other.cleanup) {}
+bool EditLog::extend(const Edit& edit, std::string_view text) {
+    // Only the newest entry can grow, and its bytes are then always at the end of the arena
+    if (applied == 0 || can_redo()) return false;
+    Edit& last = entries.back();
+    if (last.type != edit.type || last.move_cursor != edit.move_cursor || edit.type == EditType::REPLACE) return false;
+    if (last.line_after != edit.line_before || last.character_after != edit.character_before) return false;
 
-Edit& Edit::operator=(const Edit& other) {
-    if (this != &other) {
-        this->edit_function = other.edit_function;
-        this->undo_function = other.undo_function;
-        this->cleanup = other.cleanup;
+    if (edit.type == EditType::INSERT) {
+        if (edit.position != last.position + last.length) return false;
+        arena.append(text);
+    } else if (edit.position + text.size() == last.position) {
+        arena.insert(last.text_offset, text);
+        last.position = edit.position;
+    } else if (edit.position == last.position) {
+        arena.append(text);
+    } else {
+        return false;
     }
-    return *this;
-}
\ No newline at end of file
+    last.length += text.size();
+    last.line_after = edit.line_after;
+    last.character_after = edit.character_after;
+    enforce_limit();
+    return true;
+}
+
+const Edit* EditLog::undo() {
+    if (applied == 0 && !page_in()) return nullptr;
+    --applied;
+    // Spilling only moves the entries after this one, so it is looked up afterwards
+    enforce_limit(true);
+    return &entries[applied];
+}
+
+const Edit* EditLog::redo() {
+    if (applied == entries.size() && !page_in_redo()) return nullptr;
+    ++applied;
+    enforce_limit();
+    return &entries[applied - 1];
+}
+
+bool EditLog::redo_joins_previous() {
+    if (applied == entries.size() && !page_in_redo()) return false;
+    return entries[applied].joins_previous;
+}
+
+void EditLog::set_memory_limit(size_t bytes) {
+    memory_limit = bytes;
+    enforce_limit();
+}
+
+void EditLog::enforce_limit(bool undoing) {
+    size_t usage = memory_usage();
+    if (usage <= memory_limit) return;
+
+    size_t target = usage - memory_limit / 2;
+    size_t freed = undoing ? 0 : spill_front(target);
+    if (freed < target) {
+        spill_back(target - freed);
+    }
+}
+
+size_t EditLog::spill_front(size_t target) {
+    // The newest applied entry always stays in memory so typing can keep extending it, and
+    // undone entries are left to spill_back because spilled blocks have to be older than memory
+    size_t freed = 0;
+    size_t count = 0;
+    while (count + 1 < applied && freed < target) {
+        freed += sizeof(Edit) + entries[count].length;
+        ++count;
+    }
+    if (count == 0) return 0;
+
+    if (!journal) {
+        journal = std::make_unique<EditJournal>();
+    }
+    size_t text_bytes = entries[count].text_offset;
+    size_t offset = journal->size();
+    if (journal->is_open()
+        && journal->append(entries.data(), count * sizeof(Edit))
+        && journal->append(arena.data(), text_bytes)) {
+        spilled.push_back({offset, count, text_bytes});
+        spilled_entries += count;
+    } else {
+        // Without a journal the oldest history is lost, and anything spilled earlier is no longer contiguous with it
+        journal->truncate(0);
+        spilled.clear();
+        spilled_entries = 0;
+    }
+    drop_front(count);
+    return freed;
+}
+
+size_t EditLog::spill_back(size_t target) {
+    // The entry redo returns next stays, so redo_joins_previous can look at it without reading the journal
+    size_t first = entries.size();
+    size_t freed = 0;
+    while (first > applied + 1 && freed < target) {
+        --first;
+        freed += sizeof(Edit) + entries[first].length;
+    }
+    if (first == entries.size()) return 0;
+
+    if (!redo_journal) {
+        redo_journal = std::make_unique<EditJournal>();
+    }
+    size_t count = entries.size() - first;
+    size_t text_start = entries[first].text_offset;
+    size_t offset = redo_journal->size();
+    if (redo_journal->is_open()
+        && redo_journal->append(entries.data() + first, count * sizeof(Edit))
+        && redo_journal->append(arena.data() + text_start, arena.size() - text_start)) {
+        redo_spilled.push_back({offset, count, arena.size() - text_start});
+    } else {
+        // Without a journal these entries can no longer be redone, and neither can anything spilled after them
+        redo_journal->truncate(0);
+        redo_spilled.clear();
+    }
+    entries.resize(first);
+    arena.resize(text_start);
+    return freed;
+}
+
+bool EditLog::page_in() {
+    if (spilled.empty()) return false;
+    SpilledBlock block = spilled.back();
+    spilled.pop_back();
+    spilled_entries -= block.count;
+
+    std::vector<Edit> block_entries(block.count);
+    std::string block_text(block.text_bytes, '\0');
+    if (!journal->read(block.offset, block_entries.data(), block.count * sizeof(Edit))
+        || !journal->read(block.offset + block.count * sizeof(Edit), block_text.data(), block.text_bytes)) {
+        // Everything older than this block is unreachable now
+        journal->truncate(0);
+        spilled.clear();
+        spilled_entries = 0;
+        return false;
+    }
+    journal->truncate(block.offset);
+
+    for (Edit& entry : entries) {
+        entry.text_offset += block.text_bytes;
+    }
+    arena.insert(0, block_text);
+    entries.insert(entries.begin(), block_entries.begin(), block_entries.end());
+    applied += block.count;
+    return true;
+}
+
+bool EditLog::page_in_redo() {
+    if (redo_spilled.empty()) return false;
+    SpilledBlock block = redo_spilled.back();
+    redo_spilled.pop_back();
+
+    std::vector<Edit> block_entries(block.count);
+    std::string block_text(block.text_bytes, '\0');
+    if (!redo_journal->read(block.offset, block_entries.data(), block.count * sizeof(Edit))
+        || !redo_journal->read(block.offset + block.count * sizeof(Edit), block_text.data(), block.text_bytes)) {
+        // Everything newer than this block is unreachable now
+        redo_journal->truncate(0);
+        redo_spilled.clear();
+        return false;
+    }
+    redo_journal->truncate(block.offset);
+
+    // The entries still point into the arena as it was when they were spilled
+    size_t spilled_start = block_entries.front().text_offset;
+    for (Edit& entry : block_entries) {
+        entry.text_offset = entry.text_offset - spilled_start + arena.size();
+    }
+    arena.append(block_text);
+    entries.insert(entries.end(), block_entries.begin(), block_entries.end());
+    return true;
+}
+
+void EditLog::drop_front(size_t count) {
+    size_t text_bytes = count < entries.size() ? entries[count].text_offset : arena.size();
+    arena.erase(0, text_bytes);
+    entries.erase(entries.begin(), entries.begin() + count);
+    for (Edit& entry : entries) {
+        entry.text_offset -= text_bytes;
+    }
+    applied -= count;
+}
@@ -1,26 +1,154 @@
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
-class Edit {
-    
+#include "edit_journal.h"
+
+/// @brief The kind of change an Edit records.
+enum class EditType : uint8_t {
+    INSERT,
+    ERASE,
+    /// Many spans replaced at once. The entry's bytes are laid out by pack_replacements.
+    REPLACE
+};
+
+/// @brief A span changed by a REPLACE edit, at a position in the document as it was before the edit.
+struct Replacement {
+    uint64_t position;
+    uint64_t removed_length;
+    uint64_t inserted_length;
+};
+
+/// @brief Lays out the bytes a REPLACE entry stores: the number of spans, the spans, then the text
+/// every span removed and the text every span inserted, each in order. Only the changed spans are
+/// kept, so replacing throughout a large document costs no more history than the matches themselves.
+std::string pack_replacements(const std::vector<Replacement>& spans, std::string_view removed, std::string_view inserted);
+
+/// @brief Reads back bytes laid out by pack_replacements. removed and inserted point into packed.
+void unpack_replacements(std::string_view packed, std::vector<Replacement>& spans, std::string_view& removed, std::string_view& inserted);
+
+/// @brief A single entry in the undo history.
+///
+/// Entries are plain data. The bytes that were inserted or erased live in the
+/// owning EditLog's text arena and are referenced by offset.
+struct Edit {
+    EditType type;
+    bool move_cursor;       // Whether undoing or redoing this edit moves the cursor
+    bool joins_previous;    // Whether this edit is undone and redone together with the one before it
+    uint64_t position;      // Byte offset in the document
+    uint64_t length;        // Number of bytes inserted or erased
+    uint64_t text_offset;   // Offset of those bytes in the arena
+    int32_t line_before;
+    int32_t character_before;
+    int32_t line_after;
+    int32_t character_after;
+};
+
+/// @brief Undo/redo history stored as an operation log over a shared text arena.
+///
+/// Entries before `applied` have been applied and can be undone; the rest have
+/// been undone and can be redone. Both the entries and the arena only grow at
+/// the end, so recording a keystroke is an amortized append with no allocation
+/// of its own.
+///
+/// The log is capped by the bytes it holds rather than by entry count. Once it
+/// goes over its memory limit, the oldest entries are written to an
+/// EditJournal as one block and read back when undo reaches them. Undoing far
+/// back does the same at the other end: the newest undone entries go to a
+/// journal of their own and are read back when redo reaches them. If no
+/// journal can be created they are dropped instead.
+class EditLog {
 public:
-    Edit(const std::function<bool()>& edit_function, const std::function<bool()>& undo_function, const std::function<void()>& cleanup = [](){});
-    Edit(std::function<bool()>&& edit_function, std::function<bool()>&& undo_function, std::function<void()>&& cleanup = [](){});
+    EditLog() = default;
+
+    EditLog(const EditLog& other);
+    EditLog& operator=(const EditLog& other);
+
+    EditLog(EditLog&& other) noexcept = default;
+    EditLog& operator=(EditLog&& other) noexcept = default;
+
+    /// @brief Records an edit that has already been applied to the document.
+    /// Anything that could have been redone is dropped. Only the type, move_cursor, joins_previous,
+    /// position and cursor fields of edit are used; the rest are filled in from text.
+    void push(const Edit& edit, std::string_view text);
+
+    /// @brief Merges an edit that continues the newest entry into it instead of adding an entry.
+    /// Inserts must start where the entry's text ends, erases must end where it starts (backspace) or
+    /// start at the same position (forward delete), and the cursor must not have moved in between.
+    /// Returns false, leaving the log untouched, if the edit cannot be merged.
+    bool extend(const Edit& edit, std::string_view text);
+
+    inline bool can_undo() const { return applied > 0 || !spilled.empty(); }
+    inline bool can_redo() const { return applied < entries.size() || !redo_spilled.empty(); }
+
+    /// @brief Steps back one entry and returns it so it can be reverted, paging it in from the journal if needed.
+    /// Returns nullptr if there is nothing to undo. The entry is valid until the log is next modified.
+    const Edit* undo();
 
-    Edit(const Edit&);
-    Edit(Edit&& other) noexcept;
-    Edit& operator=(const Edit&);
-    Edit&& operator=(Edit&& other) noexcept;
+    /// @brief Steps forward one entry and returns it so it can be re-applied, paging it in from the journal if needed.
+    /// Returns nullptr if there is nothing to redo. The entry is valid until the log is next modified.
+    const Edit* redo();
 
-    inline bool edit() { return this->edit_function(); }
-    inline bool undo() { return this->undo_function(); }
+    /// @brief Whether the entry redo would return next belongs with the one it returned last.
+    bool redo_joins_previous();
 
-    ~Edit();
+    /// @brief Gets the bytes an entry inserted or erased, or the packed spans of a REPLACE entry.
+    inline std::string_view text_of(const Edit& edit) const {
+        return std::string_view(arena).substr(edit.text_offset, edit.length);
+    }
+
+    /// @brief Sets how many bytes of entries and text may be kept in memory.
+    void set_memory_limit(size_t bytes);
+
+    /// @brief Bytes of entries and text currently held in memory.
+    inline size_t memory_usage() const { return entries.size() * sizeof(Edit) + arena.size(); }
+
+    /// @brief Number of entries that can be undone, including those in the journal.
+    inline size_t size() const { return applied + spilled_entries; }
 
 private:
-    std::function<bool()> edit_function;
-    std::function<bool()> undo_function;
-    std::function<void()> cleanup;
-    
-};
\ No newline at end of file
+    /// @brief A run of entries and their text, written to a journal together.
+    struct SpilledBlock {
+        size_t offset;      // Where the block starts in the journal
+        size_t count;       // Number of entries, stored first
+        size_t text_bytes;  // Size of their text, stored after the entries
+    };
+
+    /// @brief Moves entries out of memory until usage is back down to half the limit.
+    /// Halving keeps spills rare so that shifting the remaining entries stays amortized O(1).
+    /// The oldest entries go first, then the newest undone ones. While undoing only undone
+    /// entries go, so that the block undo just paged in is not written straight back out.
+    void enforce_limit(bool undoing = false);
+
+    /// @brief Writes the oldest entries, except the newest applied one, to the journal. Returns the bytes freed.
+    size_t spill_front(size_t target);
+
+    /// @brief Writes the newest undone entries, except the next one to redo, to the redo journal. Returns the bytes freed.
+    size_t spill_back(size_t target);
+
+    /// @brief Reads the newest spilled block back in front of the in-memory entries.
+    bool page_in();
+
+    /// @brief Reads the undone block nearest to memory back in after the in-memory entries.
+    bool page_in_redo();
+
+    /// @brief Removes the first count entries and their text from memory.
+    void drop_front(size_t count);
+
+    std::vector<Edit> entries;
+    std::string arena;
+    size_t applied = 0;
+    size_t memory_limit = SIZE_MAX;
+
+    std::unique_ptr<EditJournal> journal; // Created on the first spill
+    std::vector<SpilledBlock> spilled;    // Oldest first, so the newest is at the end of the journal
+    size_t spilled_entries = 0;
+
+    std::unique_ptr<EditJournal> redo_journal; // Created on the first spill of undone entries
+    std::vector<SpilledBlock> redo_spilled;    // Newest first, so the next to redo is at the end of the journal
+};
@@ -0,0 +1,56 @@
+#include "edit_journal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+EditJournal::EditJournal()
+    : path(), file(), end(0) {
+    static std::atomic<unsigned> counter = 0;
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+    if (error) return;
+
+    // Unique across processes through the clock and across journals in this process through the counter
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    path = (directory / ("speedy-undo-" + std::to_string(stamp) + "-" + std::to_string(counter++) + ".journal")).string();
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+}
+
+EditJournal::~EditJournal() {
+    if (file.is_open()) {
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+}
+
+bool EditJournal::append(const void* data, size_t count) {
+    file.clear();
+    file.seekp(static_cast<std::streamoff>(end));
+    file.write(static_cast<const char*>(data), static_cast<std::streamsize>(count));
+    if (!file) return false;
+    end += count;
+    return true;
+}
+
+bool EditJournal::read(size_t offset, void* data, size_t count) const {
+    if (offset + count > end) return false;
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(static_cast<char*>(data), static_cast<std::streamsize>(count));
+    return static_cast<bool>(file);
+}
+
+bool EditJournal::copy_from(const EditJournal& other, size_t count) {
+    constexpr size_t CHUNK = 1 << 16;
+    char buffer[CHUNK];
+    for (size_t offset = 0; offset < count; offset += CHUNK) {
+        size_t n = std::min(CHUNK, count - offset);
+        if (!other.read(offset, buffer, n) || !append(buffer, n)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+/// @brief Scratch file that holds undo history spilled out of memory.
+///
+/// Data is only ever written at the end. Since history is paged back in
+/// newest-first, the most recent writes can be released again by truncating,
+/// which makes the journal behave like a stack on disk. The file is deleted
+/// when the journal is destroyed.
+class EditJournal {
+public:
+    /// @brief Attempts to create a new journal in the system's temporary directory.
+    EditJournal();
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    ~EditJournal();
+
+    /// @brief Checks if the journal file was created.
+    inline bool is_open() const { return file.is_open(); }
+
+    /// @brief Number of bytes currently in the journal.
+    inline size_t size() const { return end; }
+
+    /// @brief Writes bytes at the end of the journal. Returns false if the write failed.
+    bool append(const void* data, size_t count);
+
+    /// @brief Reads count bytes starting at offset. Returns false if the read failed.
+    bool read(size_t offset, void* data, size_t count) const;
+
+    /// @brief Releases everything from offset onwards so it can be written over.
+    inline void truncate(size_t offset) { if (offset < end) end = offset; }
+
+    /// @brief Appends the first count bytes of another journal.
+    bool copy_from(const EditJournal& other, size_t count);
+
+private:
+    std::string path;
+    mutable std::fstream file; // Reading only moves the get position
+    size_t end;
+};
@@ -0,0 +1,249 @@
+#include "find.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+
+#include "utf8.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FIND_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Bytes read from the table per step when it has to be copied
+constexpr size_t FIND_WINDOW = 1 << 20;
+
+inline char ascii_lower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c; }
+inline char ascii_upper(char c) { return c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c; }
+
+bool equal_at(const char* data, std::string_view needle, bool fold_case) {
+    if (!fold_case) return std::memcmp(data, needle.data(), needle.size()) == 0;
+    for (size_t i = 0; i < needle.size(); ++i) {
+        if (ascii_lower(data[i]) != ascii_lower(needle[i])) return false;
+    }
+    return true;
+}
+
+// Expects from + needle.size() <= text.size()
+size_t find_scalar(std::string_view text, std::string_view needle, size_t from, bool fold_case) {
+    const char* data = text.data();
+    size_t last_start = text.size() - needle.size();
+    char first = needle.front();
+    if (fold_case && ascii_lower(first) != ascii_upper(first)) {
+        for (size_t i = from; i <= last_start; ++i) {
+            if (equal_at(data + i, needle, true)) return i;
+        }
+        return std::string_view::npos;
+    }
+
+    // The first byte only matches itself, so memchr can skip to it
+    const char* end = data + last_start + 1;
+    const char* p = data + from;
+    while ((p = static_cast<const char*>(std::memchr(p, first, static_cast<size_t>(end - p)))) != nullptr) {
+        if (equal_at(p, needle, fold_case)) return static_cast<size_t>(p - data);
+        ++p;
+    }
+    return std::string_view::npos;
+}
+
+#ifdef FIND_X86
+
+// A candidate is an offset where both the first and the last byte of the needle line up.
+// Each is compared against both of its cases, which are the same byte unless folding a letter.
+
+__attribute__((target("sse2")))
+size_t find_sse2(std::string_view text, std::string_view needle, size_t from, bool fold_case) {
+    const char* data = text.data();
+    size_t tail = needle.size() - 1;
+    char first = needle.front();
+    char last = needle.back();
+    const __m128i first_lower = _mm_set1_epi8(fold_case ? ascii_lower(first) : first);
+    const __m128i first_upper = _mm_set1_epi8(fold_case ? ascii_upper(first) : first);
+    const __m128i last_lower = _mm_set1_epi8(fold_case ? ascii_lower(last) : last);
+    const __m128i last_upper = _mm_set1_epi8(fold_case ? ascii_upper(last) : last);
+
+    size_t i = from;
+    for (; i + tail + 16 <= text.size(); i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + tail));
+        __m128i match_first = _mm_or_si128(_mm_cmpeq_epi8(block_first, first_lower), _mm_cmpeq_epi8(block_first, first_upper));
+        __m128i match_last = _mm_or_si128(_mm_cmpeq_epi8(block_last, last_lower), _mm_cmpeq_epi8(block_last, last_upper));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(match_first, match_last)));
+        while (mask) {
+            size_t candidate = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (equal_at(data + candidate, needle, fold_case)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return i + needle.size() <= text.size() ? find_scalar(text, needle, i, fold_case) : std::string_view::npos;
+}
+
+__attribute__((target("avx2")))
+size_t find_avx2(std::string_view text, std::string_view needle, size_t from, bool fold_case) {
+    const char* data = text.data();
+    size_t tail = needle.size() - 1;
+    char first = needle.front();
+    char last = needle.back();
+    const __m256i first_lower = _mm256_set1_epi8(fold_case ? ascii_lower(first) : first);
+    const __m256i first_upper = _mm256_set1_epi8(fold_case ? ascii_upper(first) : first);
+    const __m256i last_lower = _mm256_set1_epi8(fold_case ? ascii_lower(last) : last);
+    const __m256i last_upper = _mm256_set1_epi8(fold_case ? ascii_upper(last) : last);
+
+    size_t i = from;
+    for (; i + tail + 32 <= text.size(); i += 32) {
+        __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + tail));
+        __m256i match_first = _mm256_or_si256(_mm256_cmpeq_epi8(block_first, first_lower), _mm256_cmpeq_epi8(block_first, first_upper));
+        __m256i match_last = _mm256_or_si256(_mm256_cmpeq_epi8(block_last, last_lower), _mm256_cmpeq_epi8(block_last, last_upper));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(match_first, match_last)));
+        while (mask) {
+            size_t candidate = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (equal_at(data + candidate, needle, fold_case)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return i + needle.size() <= text.size() ? find_sse2(text, needle, i, fold_case) : std::string_view::npos;
+}
+
+#endif
+
+// The character that ends at offset, or 0 at the start of the text
+wchar_t character_before(const PieceTable& text, size_t offset) {
+    if (offset == 0) return 0;
+    char byte = text.char_at(offset - 1);
+    if (static_cast<unsigned char>(byte) < 0x80) return static_cast<wchar_t>(byte);
+
+    // Step back over continuation bytes to where the character starts
+    size_t start = offset - 1;
+    while (start > 0 && offset - start < 4 && (static_cast<unsigned char>(text.char_at(start)) & 0xC0) == 0x80) --start;
+    std::wstring decoded = utf8_to_wide(text.get_text(start, offset - start));
+    return decoded.empty() ? 0 : decoded.back();
+}
+
+// The character that starts at offset, or 0 at the end of the text
+wchar_t character_after(const PieceTable& text, size_t offset) {
+    if (offset >= text.length()) return 0;
+    char byte = text.char_at(offset);
+    if (static_cast<unsigned char>(byte) < 0x80) return static_cast<wchar_t>(byte);
+
+    std::wstring decoded = utf8_to_wide(text.get_text(offset, 4));
+    return decoded.empty() ? 0 : decoded.front();
+}
+
+} // namespace
+
+bool is_word_character(wchar_t ch) {
+    return std::iswalnum(static_cast<wint_t>(ch)) || ch == L'_';
+}
+
+size_t find_bytes(std::string_view text, std::string_view needle, size_t from, bool fold_case) {
+    if (needle.empty() || needle.size() > text.size() || from > text.size() - needle.size()) {
+        return std::string_view::npos;
+    }
+#ifdef FIND_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_sse2 = __builtin_cpu_supports("sse2");
+    if (has_avx2) return find_avx2(text, needle, from, fold_case);
+    if (has_sse2) return find_sse2(text, needle, from, fold_case);
+#endif
+    return find_scalar(text, needle, from, fold_case);
+}
+
+Finder::Finder(std::string_view needle, FindOptions options)
+    : needle(needle), options(options) {
+    if (!options.match_case) {
+        std::transform(this->needle.begin(), this->needle.end(), this->needle.begin(), ascii_lower);
+    }
+}
+
+bool Finder::accepts(const PieceTable& text, size_t start) const {
+    if (!options.whole_word) return true;
+    return !is_word_character(character_before(text, start))
+        && !is_word_character(character_after(text, start + needle.size()));
+}
+
+template <typename Visit>
+void Finder::scan(const PieceTable& text, size_t from, size_t end, Visit&& visit) const {
+    if (needle.empty()) return;
+    std::string scratch;
+    size_t length = text.length();
+    for (size_t window = from; window < end; window += FIND_WINDOW) {
+        // Windows overlap by all but one byte of the needle so that no match is split between two
+        size_t window_end = std::min(end, window + FIND_WINDOW);
+        size_t count = std::min(length, window_end + needle.size() - 1) - std::min(length, window);
+        std::string_view view = text.view(window, count, scratch);
+        for (size_t found = find_bytes(view, needle, 0, !options.match_case);
+             found != std::string_view::npos && window + found < window_end;
+             found = find_bytes(view, needle, found + 1, !options.match_case)) {
+            if (accepts(text, window + found) && !visit(window + found)) return;
+        }
+    }
+}
+
+size_t Finder::find_next(const PieceTable& text, size_t from) const {
+    size_t result = NONE;
+    scan(text, from, text.length(), [&](size_t start) {
+        result = start;
+        return false;
+    });
+    return result;
+}
+
+size_t Finder::find_previous(const PieceTable& text, size_t before) const {
+    // Windows are searched forwards, newest first, so only the window holding the match is read
+    size_t window_end = std::min(before, text.length());
+    while (window_end > 0) {
+        size_t window_start = window_end > FIND_WINDOW ? window_end - FIND_WINDOW : 0;
+        size_t result = NONE;
+        scan(text, window_start, window_end, [&](size_t start) {
+            result = start;
+            return true;
+        });
+        if (result != NONE) return result;
+        window_end = window_start;
+    }
+    return NONE;
+}
+
+std::vector<size_t> Finder::find_all(const PieceTable& text) const {
+    std::vector<size_t> result;
+    size_t next = 0;
+    scan(text, 0, text.length(), [&](size_t start) {
+        if (start >= next) {
+            result.push_back(start);
+            next = start + needle.size();
+        }
+        return true;
+    });
+    return result;
+}
+
+MatchSet::MatchSet()
+    : anchors(), matches() {}
+
+void MatchSet::add(size_t start, size_t end) {
+    matches.emplace_back(anchors.create(start, Gravity::RIGHT), anchors.create(end, Gravity::LEFT));
+}
+
+void MatchSet::clear() {
+    anchors.clear();
+    matches.clear();
+}
+
+std::vector<std::pair<size_t, size_t>> MatchSet::get_in(size_t first, size_t last) const {
+    // Ends stay in order through edits, so the first match ending after first is found by bisection
+    auto it = std::partition_point(matches.begin(), matches.end(), [&](const std::pair<AnchorId, AnchorId>& match) {
+        return anchors.get(match.second) <= first;
+    });
+    std::vector<std::pair<size_t, size_t>> result;
+    for (; it != matches.end(); ++it) {
+        size_t start = anchors.get(it->first);
+        if (start >= last) break;
+        size_t end = anchors.get(it->second);
+        if (start < end) result.emplace_back(start, end);
+    }
+    return result;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "anchor_set.h"
+#include "piece_table.h"
+
+/// @brief How a search compares text.
+struct FindOptions {
+    /// ASCII letters only match letters of the same case. Other characters always match exactly.
+    bool match_case = false;
+    /// Matches must not be preceded or followed by a word character.
+    bool whole_word = false;
+};
+
+/// @brief Checks if a character is part of a word: a letter, digit or underscore.
+bool is_word_character(wchar_t ch);
+
+/// @brief Finds the first occurrence of needle in text that starts at or after from.
+///
+/// Candidates are found by comparing the first and last byte of the needle
+/// against whole blocks of text at once, using AVX2 or SSE2 when the processor
+/// has them, and only those are compared in full. With fold_case set, ASCII
+/// letters match either case. Returns std::string_view::npos if there is none.
+size_t find_bytes(std::string_view text, std::string_view needle, size_t from = 0, bool fold_case = false);
+
+/// @brief Searches a PieceTable for a needle, forwards or backwards from any offset.
+///
+/// The table is read in windows that are viewed in place when they lie within a
+/// single piece, so a file that was opened and not edited is searched without
+/// copying it. A search stops at the first match, which is what lets find
+/// next and find previous resume from the cursor without scanning the document.
+class Finder {
+public:
+    static constexpr size_t NONE = SIZE_MAX;
+
+    Finder(std::string_view needle, FindOptions options);
+
+    /// @brief Gets the first match starting at or after from, or NONE.
+    size_t find_next(const PieceTable& text, size_t from) const;
+
+    /// @brief Gets the last match starting before before, or NONE.
+    size_t find_previous(const PieceTable& text, size_t before) const;
+
+    /// @brief Gets the start of every match in order. Matches do not overlap.
+    std::vector<size_t> find_all(const PieceTable& text) const;
+
+    inline size_t length() const { return needle.size(); }
+    inline bool empty() const { return needle.empty(); }
+
+private:
+    /// @brief Checks the whole-word condition for a match starting at start, reading its neighbours from the table.
+    bool accepts(const PieceTable& text, size_t start) const;
+
+    /// @brief Calls visit with every accepted match starting from from up to end, in order, until it returns false.
+    template <typename Visit>
+    void scan(const PieceTable& text, size_t from, size_t end, Visit&& visit) const;
+
+    std::string needle; // Lowercased when the case is folded
+    FindOptions options;
+};
+
+/// @brief The matches of a search, kept as anchors so they follow edits.
+///
+/// Matches are added in document order and do not overlap, which edits
+/// preserve, so the matches around a span are found by binary search.
+class MatchSet {
+public:
+    MatchSet();
+
+    /// @brief Adds a match after every match added so far.
+    void add(size_t start, size_t end);
+
+    /// @brief Removes every match.
+    void clear();
+
+    inline size_t size() const { return matches.size(); }
+    inline bool empty() const { return matches.empty(); }
+
+    /// @brief Gets the matches that overlap the bytes from first to last, in order.
+    /// Matches that edits have erased entirely are left out.
+    std::vector<std::pair<size_t, size_t>> get_in(size_t first, size_t last) const;
+
+    /// @brief Moves the matches for length bytes inserted at offset. Text typed at either edge is not part of a match.
+    inline void on_insert(size_t offset, size_t length) { anchors.on_insert(offset, length); }
+
+    /// @brief Moves the matches for length bytes erased at offset.
+    inline void on_erase(size_t offset, size_t length) { anchors.on_erase(offset, length); }
+
+private:
+    AnchorSet anchors;
+    std::vector<std::pair<AnchorId, AnchorId>> matches; // Start and end of each match
+};
@@ -1,59 +1,215 @@
 #include "formatting.h"
 #include <algorithm>
 
-void FormattingManager::add_formatting(int start_line, int start_char, int end_line, int end_char, FormatType type) {
+FormattingManager::FormattingManager()
+    : anchors(), nodes(), free_nodes(), root(NIL), rng_state(0x9E3779B9u), count(0) {}
+
+void FormattingManager::add_formatting(size_t start, size_t end, FormatType type) {
     // Remove any existing formatting of the same type in this range
-    remove_formatting(start_line, start_char, end_line, end_char, type);
-    
+    remove_formatting(start, end, type);
+    if (start >= end) return;
+
     // Add the new formatting
-    format_ranges.emplace_back(start_line, start_char, end_line, end_char, type);
-}
-
-void FormattingManager::remove_formatting(int start_line, int start_char, int end_line, int end_char, FormatType type) {
-    format_ranges.erase(
-        std::remove_if(format_ranges.begin(), format_ranges.end(),
-            [start_line, start_char, end_line, end_char, type](const FormatRange& range) {
-                return range.type == type &&
-                       range.start_line == start_line &&
-                       range.start_char == start_char &&
-                       range.end_line == end_line &&
-                       range.end_char == end_char;
-            }),
-        format_ranges.end()
-    );
-}
-
-std::vector<FormatRange> FormattingManager::get_formatting_at(int line, int char_pos) const {
-    std::vector<FormatRange> result;
-    
-    for (const auto& range : format_ranges) {
-        // Check if the position is within this range
-        bool in_range = false;
-        
-        if (range.start_line == range.end_line) {
-            // Single line range
-            if (line == range.start_line && char_pos >= range.start_char && char_pos < range.end_char) {
-                in_range = true;
-            }
-        } else {
-            // Multi-line range
-            if (line == range.start_line && char_pos >= range.start_char) {
-                in_range = true;
-            } else if (line == range.end_line && char_pos < range.end_char) {
-                in_range = true;
-            } else if (line > range.start_line && line < range.end_line) {
-                in_range = true;
-            }
-        }
-        
-        if (in_range) {
-            result.push_back(range);
-        }
+    uint32_t left, right;
+    split(root, start, left, right);
+    root = merge(merge(left, new_node(start, end, type)), right);
+    ++count;
+}
+
+void FormattingManager::on_erase(size_t offset, size_t length) {
+    anchors.on_erase(offset, length);
+    // A range whose text was all erased now starts and ends at offset. Left in place,
+    // text inserted there would push its start past its end.
+    if (length > 0) {
+        count -= erase_collapsed(root, offset);
     }
-    
+}
+
+void FormattingManager::remove_formatting(size_t start, size_t end, FormatType type) {
+    if (erase(root, start, end, type)) {
+        --count;
+    }
+}
+
+std::vector<FormatSpan> FormattingManager::get_formatting_at(size_t offset) const {
+    std::vector<FormatSpan> result;
+    collect_at(root, offset, result);
+    return result;
+}
+
+std::vector<FormatSpan> FormattingManager::get_formatting_in(size_t first, size_t last) const {
+    std::vector<FormatSpan> result;
+    collect_in(root, first, last, result);
+    return result;
+}
+
+std::vector<FormatSpan> FormattingManager::get_all_ranges() const {
+    std::vector<FormatSpan> result;
+    result.reserve(count);
+    collect_all(root, result);
     return result;
 }
 
 void FormattingManager::clear_formatting() {
-    format_ranges.clear();
+    anchors.clear();
+    nodes.clear();
+    free_nodes.clear();
+    root = NIL;
+    count = 0;
+}
+
+uint32_t FormattingManager::new_node(size_t start, size_t end, FormatType type) {
+    // xorshift32, deterministic so that tree shapes are reproducible between runs
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+
+    AnchorId end_anchor = anchors.create(end, Gravity::LEFT);
+    Node node{anchors.create(start, Gravity::RIGHT), end_anchor, type, rng_state, NIL, NIL, end_anchor};
+    if (!free_nodes.empty()) {
+        uint32_t index = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[index] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void FormattingManager::update(uint32_t t) {
+    Node& node = nodes[t];
+    node.max_end = node.end;
+    size_t max_end = anchors.get(node.end);
+    for (uint32_t child : {node.left, node.right}) {
+        if (child == NIL) continue;
+        size_t child_end = anchors.get(nodes[child].max_end);
+        if (child_end > max_end) {
+            max_end = child_end;
+            node.max_end = nodes[child].max_end;
+        }
+    }
+}
+
+void FormattingManager::split(uint32_t t, size_t start, uint32_t& left, uint32_t& right) {
+    if (t == NIL) {
+        left = right = NIL;
+        return;
+    }
+
+    if (start_of(t) < start) {
+        uint32_t inner_left;
+        split(nodes[t].right, start, inner_left, right);
+        nodes[t].right = inner_left;
+        update(t);
+        left = t;
+    } else {
+        uint32_t inner_right;
+        split(nodes[t].left, start, left, inner_right);
+        nodes[t].left = inner_right;
+        update(t);
+        right = t;
+    }
+}
+
+uint32_t FormattingManager::merge(uint32_t left, uint32_t right) {
+    if (left == NIL) return right;
+    if (right == NIL) return left;
+
+    if (nodes[left].priority > nodes[right].priority) {
+        uint32_t merged = merge(nodes[left].right, right);
+        nodes[left].right = merged;
+        update(left);
+        return left;
+    }
+    uint32_t merged = merge(left, nodes[right].left);
+    nodes[right].left = merged;
+    update(right);
+    return right;
+}
+
+bool FormattingManager::erase(uint32_t& t, size_t start, size_t end, FormatType type) {
+    if (t == NIL) return false;
+
+    // Ranges are only ordered by start, so ranges sharing a start can be on either side
+    size_t node_start = start_of(t);
+    bool erased = false;
+    if (start < node_start) {
+        erased = erase(nodes[t].left, start, end, type);
+    } else if (start > node_start) {
+        erased = erase(nodes[t].right, start, end, type);
+    } else if (end_of(t) == end && nodes[t].type == type) {
+        remove_node(t);
+        return true;
+    } else {
+        erased = erase(nodes[t].left, start, end, type) || erase(nodes[t].right, start, end, type);
+    }
+    if (erased) update(t);
+    return erased;
+}
+
+size_t FormattingManager::erase_collapsed(uint32_t& t, size_t offset) {
+    if (t == NIL) return 0;
+
+    size_t node_start = start_of(t);
+    size_t erased = 0;
+    if (offset < node_start) {
+        erased = erase_collapsed(nodes[t].left, offset);
+    } else if (offset > node_start) {
+        erased = erase_collapsed(nodes[t].right, offset);
+    } else {
+        erased = erase_collapsed(nodes[t].left, offset) + erase_collapsed(nodes[t].right, offset);
+        if (end_of(t) <= node_start) {
+            remove_node(t);
+            return erased + 1;
+        }
+    }
+    if (erased > 0) update(t);
+    return erased;
+}
+
+void FormattingManager::remove_node(uint32_t& t) {
+    uint32_t removed = t;
+    anchors.remove(nodes[removed].start);
+    anchors.remove(nodes[removed].end);
+    t = merge(nodes[removed].left, nodes[removed].right);
+    free_nodes.push_back(removed);
+}
+
+void FormattingManager::collect_at(uint32_t t, size_t offset, std::vector<FormatSpan>& out) const {
+    // Nothing in this subtree reaches past the offset
+    if (t == NIL || anchors.get(nodes[t].max_end) <= offset) return;
+
+    const Node& node = nodes[t];
+    collect_at(node.left, offset, out);
+    size_t start = start_of(t);
+    if (start <= offset) {
+        size_t end = end_of(t);
+        if (offset < end) {
+            out.push_back({start, end, node.type});
+        }
+        // Everything to the right starts at or after this node
+        collect_at(node.right, offset, out);
+    }
+}
+
+void FormattingManager::collect_in(uint32_t t, size_t first, size_t last, std::vector<FormatSpan>& out) const {
+    if (t == NIL || anchors.get(nodes[t].max_end) <= first) return;
+
+    const Node& node = nodes[t];
+    collect_in(node.left, first, last, out);
+    size_t start = start_of(t);
+    if (start <= last) {
+        size_t end = end_of(t);
+        if (end > first) {
+            out.push_back({start, end, node.type});
+        }
+        collect_in(node.right, first, last, out);
+    }
+}
+
+void FormattingManager::collect_all(uint32_t t, std::vector<FormatSpan>& out) const {
+    if (t == NIL) return;
+    collect_all(nodes[t].left, out);
+    out.push_back({start_of(t), end_of(t), nodes[t].type});
+    collect_all(nodes[t].right, out);
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
-#include <map>
+
+#include "anchor_set.h"
 
 enum class FormatType {
     BOLD,
@@ -10,27 +13,92 @@ enum class FormatType {
     HIGHLIGHT
 };
 
+/// @brief A formatted range as line/column positions, used for drawing.
 struct FormatRange {
     int start_line;
     int start_char;
     int end_line;
     int end_char;
     FormatType type;
-    
+
     FormatRange(int sl, int sc, int el, int ec, FormatType t)
         : start_line(sl), start_char(sc), end_line(el), end_char(ec), type(t) {}
 };
 
+/// @brief A formatted range as byte offsets in the document.
+struct FormatSpan {
+    size_t start;
+    size_t end;
+    FormatType type;
+};
+
+/// @brief Stores formatting ranges in an interval tree over edit-aware anchors.
+///
+/// The start and end of every range are anchors in an AnchorSet, so ranges
+/// follow the text they cover when it moves and an edit costs the same no
+/// matter how many ranges there are. Ranges are kept in a treap ordered by
+/// start and augmented with the anchor of the furthest end in each subtree.
+/// Edits shift offsets monotonically, so neither the order nor which end is
+/// furthest ever changes and the tree needs no fixing up after an edit, other
+/// than dropping the ranges an erase collapsed to nothing.
+/// Looking up the ranges at an offset or across a span is O(log n + k).
+/// Ranges include their start and exclude their end.
 class FormattingManager {
 public:
-    void add_formatting(int start_line, int start_char, int end_line, int end_char, FormatType type);
-    void remove_formatting(int start_line, int start_char, int end_line, int end_char, FormatType type);
-    std::vector<FormatRange> get_formatting_at(int line, int char_pos) const;
+    FormattingManager();
+
+    void add_formatting(size_t start, size_t end, FormatType type);
+    void remove_formatting(size_t start, size_t end, FormatType type);
+    std::vector<FormatSpan> get_formatting_at(size_t offset) const;
     void clear_formatting();
-    
-    // Get all formatting ranges (for efficient line-based access)
-    const std::vector<FormatRange>& get_all_ranges() const { return format_ranges; }
-    
+
+    /// @brief Gets every range that covers any byte from first to last, ordered by start.
+    /// A range starting exactly at last counts, so the line break at the end of a line can be included.
+    std::vector<FormatSpan> get_formatting_in(size_t first, size_t last) const;
+
+    /// @brief Gets all formatting ranges, ordered by start.
+    std::vector<FormatSpan> get_all_ranges() const;
+
+    /// @brief Moves the ranges for length bytes inserted at offset. Text typed at either edge stays unformatted.
+    inline void on_insert(size_t offset, size_t length) { anchors.on_insert(offset, length); }
+
+    /// @brief Moves the ranges for length bytes erased at offset. Ranges whose text is all erased are removed.
+    void on_erase(size_t offset, size_t length);
+
+    inline size_t size() const { return count; }
+
 private:
-    std::vector<FormatRange> format_ranges;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        AnchorId start;
+        AnchorId end;
+        FormatType type;
+        uint32_t priority;
+        uint32_t left;
+        uint32_t right;
+        AnchorId max_end; // Furthest end of any range in this subtree
+    };
+
+    inline size_t start_of(uint32_t t) const { return anchors.get(nodes[t].start); }
+    inline size_t end_of(uint32_t t) const { return anchors.get(nodes[t].end); }
+
+    uint32_t new_node(size_t start, size_t end, FormatType type);
+    void update(uint32_t t);
+    void split(uint32_t t, size_t start, uint32_t& left, uint32_t& right);
+    uint32_t merge(uint32_t left, uint32_t right);
+    bool erase(uint32_t& t, size_t start, size_t end, FormatType type);
+    size_t erase_collapsed(uint32_t& t, size_t offset);
+    void remove_node(uint32_t& t);
+
+    void collect_at(uint32_t t, size_t offset, std::vector<FormatSpan>& out) const;
+    void collect_in(uint32_t t, size_t first, size_t last, std::vector<FormatSpan>& out) const;
+    void collect_all(uint32_t t, std::vector<FormatSpan>& out) const;
+
+    AnchorSet anchors;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t root;
+    uint32_t rng_state;
+    size_t count;
 };
@@ -2,13 +2,33 @@
 
 #include "config.h"
 
+#include <algorithm>
+
+namespace {
+
+/// @brief A line shaped by DirectWrite.
+class DWriteTextLayout : public TextLayout {
+public:
+    explicit DWriteTextLayout(IDWriteTextLayout* layout) : layout(layout) {}
+    ~DWriteTextLayout() override { if (layout) layout->Release(); }
+
+    DWriteTextLayout(const DWriteTextLayout&) = delete;
+    DWriteTextLayout& operator=(const DWriteTextLayout&) = delete;
+
+    IDWriteTextLayout* layout;
+};
+
+}
 
 Graphics::Graphics()
-    : factory(NULL), render_target(NULL), brush(NULL), w_factory(NULL), text_format(nullptr) {}
+    : factory(NULL), render_target(NULL), brush(NULL), w_factory(NULL), text_format(nullptr),
+      font_family(), font_size(0), layouts() {}
 
 
 Graphics::~Graphics()
 {
+    // Layouts hold DirectWrite objects, so release them before the factory
+    layouts.clear();
     if (factory) factory->Release();
     if (render_target) render_target->Release();
     if (brush) brush->Release();
@@ -26,9 +46,11 @@ bool Graphics::Init(HWND hWnd)
 
     res = factory->CreateHwndRenderTarget(
         D2D1::RenderTargetProperties(),
+        // Frames only repaint the damaged part of the window, so the rest has to be kept
         D2D1::HwndRenderTargetProperties(
             hWnd,
-            D2D1::SizeU(client_rect.right, client_rect.bottom)
+            D2D1::SizeU(client_rect.right, client_rect.bottom),
+            D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS
         ),
         &render_target
     );
@@ -45,19 +67,18 @@ bool Graphics::Init(HWND hWnd)
 
     if (res != S_OK) return false;
 
-    std::string font_family = Config::get_instance()->get_font_family();
-    // Convert to std::wstring
-    std::wstring w_font_family(font_family.begin(), font_family.end());
-    static const wchar_t* msc_fontName = w_font_family.c_str();
-    static FLOAT msc_fontSize = Config::get_instance()->get_font_size();
+    // Converted once here; layouts are keyed by it on every draw
+    std::string config_font_family = Config::get_instance()->get_font_family();
+    font_family.assign(config_font_family.begin(), config_font_family.end());
+    font_size = Config::get_instance()->get_font_size();
 
     res = w_factory->CreateTextFormat(
-        msc_fontName,
+        font_family.c_str(),
         NULL,
         DWRITE_FONT_WEIGHT_NORMAL,
         DWRITE_FONT_STYLE_NORMAL,
         DWRITE_FONT_STRETCH_NORMAL,
-        msc_fontSize,
+        font_size,
         L"",
         &text_format
     );
@@ -80,13 +101,20 @@ void Graphics::BeginDraw() { render_target->BeginDraw(); }
 void Graphics::EndDraw() { render_target->EndDraw(); }
 
 
-void Graphics::SetColor(const D2D1::ColorF& color) { brush->SetColor(color); }
+void Graphics::SetColor(const Color& color) { brush->SetColor(D2D1::ColorF(color.r, color.g, color.b, color.a)); }
 
-void Graphics::ClearScreen(const D2D1::ColorF& color)
+void Graphics::ClearScreen(const Color& color)
 {
-    render_target->Clear(color);
+    render_target->Clear(D2D1::ColorF(color.r, color.g, color.b, color.a));
 }
 
+void Graphics::PushClip(float x1, float y1, float x2, float y2)
+{
+    render_target->PushAxisAlignedClip(D2D1::RectF(x1, y1, x2, y2), D2D1_ANTIALIAS_MODE_ALIASED);
+}
+
+void Graphics::PopClip() { render_target->PopAxisAlignedClip(); }
+
 
 
 
@@ -96,10 +124,6 @@ void Graphics::DrawLine(const float x1, const float y1, const float x2, const fl
 }
 
 
-void Graphics::DrawRect(float x, float y, float width, float height)
-{
-    render_target->DrawRectangle(D2D1::RectF(x, y, x + width, y + height), brush);
-}
 void Graphics::DrawRect(float x, float y, float width, float height, float stroke_width)
 {
     render_target->DrawRectangle(D2D1::RectF(x, y, x + width, y + height), brush, stroke_width);
@@ -123,27 +147,48 @@ void Graphics::DrawString(const wchar_t* str, int str_len, float x, float y, flo
 
 void Graphics::DrawFormattedString(const wchar_t* str, int str_len, float x, float y, float width, float height, const std::vector<FormatRange>& formatting)
 {
-    // For now, just draw the text normally - we'll add formatting support later
-    DrawString(str, str_len, x, y, width, height);
-    
+    // Only lines whose text or formatting changed since they were last drawn get shaped again
+    const TextLayout& layout = layouts.get(*this, std::wstring_view(str, str_len), formatting, {font_family, font_size, width, height});
+    IDWriteTextLayout* text_layout = static_cast<const DWriteTextLayout&>(layout).layout;
+    if (text_layout) {
+        render_target->DrawTextLayout(D2D1::Point2F(x, y), text_layout, brush);
+    } else {
+        DrawString(str, str_len, x, y, width, height);
+    }
+
     // Draw highlights on top
-    if (!formatting.empty()) {
-        std::string font_family = Config::get_instance()->get_font_family();
-        std::wstring w_font_family(font_family.begin(), font_family.end());
-        FLOAT font_size = Config::get_instance()->get_font_size();
-        float char_width = font_size * 0.6f;
-        
-        // Draw highlights
-        for (const auto& range : formatting) {
-            if (range.type == FormatType::HIGHLIGHT && range.start_char < str_len) {
-                float highlight_x = x + range.start_char * char_width;
-                int end_char = std::min(range.end_char, str_len);
-                float highlight_width = (end_char - range.start_char) * char_width;
-                
-                // Set yellow highlight color
-                SetColor(D2D1::ColorF(D2D1::ColorF::Yellow, 0.3f));
-                FillRect(highlight_x, y, highlight_width, height);
-            }
+    float char_width = font_size * 0.6f;
+    for (const auto& range : formatting) {
+        if (range.type == FormatType::HIGHLIGHT && range.start_char < str_len) {
+            float highlight_x = x + range.start_char * char_width;
+            int end_char = std::min(range.end_char, str_len);
+            float highlight_width = (end_char - range.start_char) * char_width;
+
+            // Set yellow highlight color
+            SetColor(Color(Color::YELLOW, 0.3f));
+            FillRect(highlight_x, y, highlight_x + highlight_width, y + height);
+        }
+    }
+}
+
+std::unique_ptr<TextLayout> Graphics::shape(std::wstring_view text, const std::vector<FormatRange>& formatting, const LayoutStyle& style)
+{
+    IDWriteTextLayout* layout = nullptr;
+    HRESULT res = w_factory->CreateTextLayout(text.data(), static_cast<UINT32>(text.length()), text_format,
+                                              style.width, style.height, &layout);
+    if (res != S_OK) return std::make_unique<DWriteTextLayout>(nullptr);
+
+    for (const auto& range : formatting) {
+        int start = std::max(range.start_char, 0);
+        int end = std::min(range.end_char, static_cast<int>(text.length()));
+        if (start >= end) continue;
+        DWRITE_TEXT_RANGE text_range{static_cast<UINT32>(start), static_cast<UINT32>(end - start)};
+        switch (range.type) {
+            case FormatType::BOLD: layout->SetFontWeight(DWRITE_FONT_WEIGHT_BOLD, text_range); break;
+            case FormatType::ITALIC: layout->SetFontStyle(DWRITE_FONT_STYLE_ITALIC, text_range); break;
+            case FormatType::UNDERLINE: layout->SetUnderline(TRUE, text_range); break;
+            case FormatType::HIGHLIGHT: break; // Drawn as a rectangle, not part of the layout
         }
     }
-}
\ No newline at end of file
+    return std::make_unique<DWriteTextLayout>(layout);
+}
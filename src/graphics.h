@@ -9,31 +9,41 @@ constexpr int STARTING_SCREEN_WIDTH = 1080;
 constexpr int STARTING_SCREEN_HEIGHT = 720;
 #include <dwrite.h>
 #include "formatting.h"
+#include "layout_cache.h"
+#include "renderer.h"
 
-class Graphics
+/// @brief Draws to a window with Direct2D and DirectWrite.
+class Graphics : public Renderer, public TextShaper
 {
     ID2D1Factory* factory;
     ID2D1HwndRenderTarget* render_target;
     ID2D1SolidColorBrush* brush;
     IDWriteFactory* w_factory;
     IDWriteTextFormat* text_format;
+    std::wstring font_family;
+    float font_size;
+    LayoutCache layouts;
 public:
     Graphics();
-    ~Graphics();
+    ~Graphics() override;
 
     bool Init(HWND hWnd);
     void Resize(const short client_width, const short client_height);
 
-    void BeginDraw();
-    void EndDraw();
+    void BeginDraw() override;
+    void EndDraw() override;
 
-    void SetColor(const D2D1::ColorF& color);
-    void ClearScreen(const D2D1::ColorF& color);
-    void DrawLine(const float x1, const float y1, const float x2, const float y2, const float stroke_width);
-    void DrawRect(float x, float y, float width, float height);
-    void DrawRect(float x, float y, float width, float height, float stroke_width);
-    void FillRect(float x, float y, float width, float height);
+    void SetColor(const Color& color) override;
+    void ClearScreen(const Color& color) override;
+    void PushClip(float x1, float y1, float x2, float y2) override;
+    void PopClip() override;
+    void DrawLine(const float x1, const float y1, const float x2, const float y2, const float stroke_width) override;
+    void DrawRect(float x, float y, float width, float height, float stroke_width = 1.0f) override;
+    void FillRect(float x1, float y1, float x2, float y2) override;
     void FillRect(const D2D1_RECT_F& rect);
-    void DrawString(const wchar_t* string, int str_len, float x, float y, float width, float height);
-    void DrawFormattedString(const wchar_t* string, int str_len, float x, float y, float width, float height, const std::vector<FormatRange>& formatting);
+    void DrawString(const wchar_t* string, int str_len, float x, float y, float width, float height) override;
+    void DrawFormattedString(const wchar_t* string, int str_len, float x, float y, float width, float height, const std::vector<FormatRange>& formatting) override;
+
+    /// @brief Shapes a line with DirectWrite, applying bold, italic and underline ranges.
+    std::unique_ptr<TextLayout> shape(std::wstring_view text, const std::vector<FormatRange>& formatting, const LayoutStyle& style) override;
 };
\ No newline at end of file
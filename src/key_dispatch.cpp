@@ -0,0 +1,57 @@
+#include "key_dispatch.h"
+
+KeyDispatcher::KeyDispatcher()
+    : node_commands(1, NONE), edges(), bound(0), state(ROOT), last_press(), timeout(1000) {}
+
+void KeyDispatcher::build(const std::vector<Command>& commands) {
+    node_commands.assign(1, NONE);
+    edges.clear();
+    bound = 0;
+    state = ROOT;
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const std::vector<KeyState>& sequence = commands[i].get_key_sequence();
+        if (sequence.empty()) continue;
+
+        uint32_t node = ROOT;
+        for (const KeyState& chord : sequence) {
+            auto [it, inserted] = edges.try_emplace(Edge{node, chord}, static_cast<uint32_t>(node_commands.size()));
+            if (inserted) node_commands.push_back(NONE);
+            node = it->second;
+        }
+        if (node_commands[node] == NONE) {
+            node_commands[node] = i;
+            ++bound;
+        }
+    }
+}
+
+size_t KeyDispatcher::press(const KeyState& chord, std::chrono::steady_clock::time_point now) {
+    // Holding or pressing a modifier on its way to the next chord must not cancel the sequence
+    if (is_modifier_only(chord)) return NONE;
+
+    if (state != ROOT && now - last_press > timeout) {
+        state = ROOT;
+    }
+    last_press = now;
+
+    uint32_t next = step(state, chord);
+    if (next == NIL && state != ROOT) {
+        next = step(ROOT, chord);
+    }
+    if (next == NIL) {
+        state = ROOT;
+        return NONE;
+    }
+    if (node_commands[next] != NONE) {
+        state = ROOT;
+        return node_commands[next];
+    }
+    state = next;
+    return NONE;
+}
+
+uint32_t KeyDispatcher::step(uint32_t node, const KeyState& chord) const {
+    auto it = edges.find(Edge{node, chord});
+    return it == edges.end() ? NIL : it->second;
+}
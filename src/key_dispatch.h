@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "command.h"
+#include "keys.h"
+
+/// @brief Matches key presses against the commands' key sequences with a prefix trie.
+///
+/// Every bound sequence is a path from the root of the trie, one edge per
+/// chord, and the edges are kept in a single hash table keyed by node and
+/// chord. Each key press follows at most one edge, so finding a binding
+/// costs one hash lookup per chord no matter how many bindings there are.
+/// A chord that completes a binding runs it straight away, so a binding
+/// that extends another binding can never be reached. When several
+/// commands share a sequence, the first one in the list wins.
+class KeyDispatcher {
+public:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    KeyDispatcher();
+
+    /// @brief Indexes the key sequences of every command and cancels any sequence in progress.
+    void build(const std::vector<Command>& commands);
+
+    /// @brief Advances the sequence in progress by one chord of normalized keys.
+    /// Gets the index of the command the chord completes, or NONE. A chord that does not continue the
+    /// sequence in progress starts a new one, and chords of modifiers alone are ignored.
+    size_t press(const KeyState& chord, std::chrono::steady_clock::time_point now);
+
+    /// @brief Checks if a sequence has been started and is waiting for its next chord.
+    inline bool is_pending() const { return state != ROOT; }
+
+    /// @brief Cancels the sequence in progress.
+    inline void reset() { state = ROOT; }
+
+    /// @brief Sets the longest pause between the chords of a sequence before it is cancelled.
+    inline void set_timeout(std::chrono::milliseconds value) { timeout = value; }
+
+    /// @brief Gets the number of sequences bound to a command.
+    inline size_t size() const { return bound; }
+
+private:
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Edge {
+        uint32_t node;
+        KeyState chord;
+
+        bool operator==(const Edge&) const = default;
+    };
+
+    struct EdgeHash {
+        inline size_t operator()(const Edge& edge) const {
+            return std::hash<KeyState>{}(edge.chord) ^ (static_cast<size_t>(edge.node) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    uint32_t step(uint32_t node, const KeyState& chord) const;
+
+    std::vector<size_t> node_commands; // Command of each node, NONE if no sequence ends there
+    std::unordered_map<Edge, uint32_t, EdgeHash> edges;
+    size_t bound;
+    uint32_t state;
+    std::chrono::steady_clock::time_point last_press;
+    std::chrono::milliseconds timeout;
+};
@@ -0,0 +1,184 @@
+#include "keys.h"
+
+#include <array>
+#include <cctype>
+#include <charconv>
+
+namespace {
+
+struct KeyName {
+    uint8_t code;
+    const char* name;
+};
+
+// Modifiers come first, in the order chords are written in
+constexpr std::array<KeyName, 3> MODIFIER_NAMES = {{
+    {Key::CONTROL, "Ctrl"}, {Key::SHIFT, "Shift"}, {Key::MENU, "Alt"},
+}};
+
+constexpr std::array<KeyName, 15> KEY_NAMES = {{
+    {Key::BACK, "Backspace"}, {Key::TAB, "Tab"}, {Key::ENTER, "Enter"}, {Key::ESCAPE, "Escape"},
+    {Key::SPACE, "Space"}, {Key::PAGE_UP, "PageUp"}, {Key::PAGE_DOWN, "PageDown"}, {Key::END, "End"},
+    {Key::HOME, "Home"}, {Key::LEFT, "Left"}, {Key::UP, "Up"}, {Key::RIGHT, "Right"}, {Key::DOWN, "Down"},
+    {Key::INSERT, "Insert"}, {Key::DEL, "Delete"},
+}};
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+bool parse_key(std::string_view name, uint8_t& code) {
+    if (name.size() == 1 && std::isalnum(static_cast<unsigned char>(name[0]))) {
+        code = static_cast<uint8_t>(std::toupper(static_cast<unsigned char>(name[0])));
+        return true;
+    }
+    if (equals_ignore_case(name, "Control")) {
+        code = Key::CONTROL;
+        return true;
+    }
+    for (const KeyName& key : MODIFIER_NAMES) {
+        if (equals_ignore_case(name, key.name)) {
+            code = key.code;
+            return true;
+        }
+    }
+    for (const KeyName& key : KEY_NAMES) {
+        if (equals_ignore_case(name, key.name)) {
+            code = key.code;
+            return true;
+        }
+    }
+    // F1 to F24
+    if (name.size() >= 2 && (name[0] == 'F' || name[0] == 'f')) {
+        int number = 0;
+        auto [end, error] = std::from_chars(name.data() + 1, name.data() + name.size(), number);
+        if (error == std::errc() && end == name.data() + name.size() && number >= 1 && number <= 24) {
+            code = static_cast<uint8_t>(Key::F1 + number - 1);
+            return true;
+        }
+    }
+    // Anything else by its code
+    if (name.size() > 2 && name[0] == '0' && (name[1] == 'x' || name[1] == 'X')) {
+        unsigned value = 0;
+        auto [end, error] = std::from_chars(name.data() + 2, name.data() + name.size(), value, 16);
+        if (error == std::errc() && end == name.data() + name.size() && value < 256) {
+            code = static_cast<uint8_t>(value);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string key_name(uint8_t code) {
+    if (std::isdigit(code) || std::isupper(code)) return std::string(1, static_cast<char>(code));
+    for (const KeyName& key : KEY_NAMES) {
+        if (key.code == code) return key.name;
+    }
+    if (code >= Key::F1 && code < Key::F1 + 24) return "F" + std::to_string(code - Key::F1 + 1);
+
+    const char* digits = "0123456789ABCDEF";
+    return std::string("0x") + digits[code >> 4] + digits[code & 0xF];
+}
+
+} // namespace
+
+void normalize_modifiers(KeyState& down) {
+    // Clear the left/right keys so they don't interfere with matching
+    auto fold = [&down](uint8_t left, uint8_t right, uint8_t plain) {
+        if (down[left] || down[right]) {
+            down[plain] = true;
+            down[left] = false;
+            down[right] = false;
+        }
+    };
+    fold(Key::LSHIFT, Key::RSHIFT, Key::SHIFT);
+    fold(Key::LCONTROL, Key::RCONTROL, Key::CONTROL);
+    fold(Key::LMENU, Key::RMENU, Key::MENU);
+}
+
+bool is_modifier_only(const KeyState& down) {
+    KeyState others = down;
+    for (uint8_t modifier : {Key::SHIFT, Key::CONTROL, Key::MENU, Key::LSHIFT, Key::RSHIFT,
+                             Key::LCONTROL, Key::RCONTROL, Key::LMENU, Key::RMENU}) {
+        others.reset(modifier);
+    }
+    return others.none();
+}
+
+bool parse_chord(std::string_view text, KeyState& chord) {
+    chord.reset();
+    while (!text.empty()) {
+        size_t plus = text.find('+', 1); // A leading '+' is the key itself
+        std::string_view name = text.substr(0, plus);
+        uint8_t code;
+        if (!parse_key(name, code)) return false;
+        chord.set(code);
+        text = plus == std::string_view::npos ? std::string_view() : text.substr(plus + 1);
+    }
+    return chord.any();
+}
+
+std::string chord_string(const KeyState& chord) {
+    std::string result;
+    auto append = [&result](const std::string& name) {
+        if (!result.empty()) result += '+';
+        result += name;
+    };
+    for (const KeyName& modifier : MODIFIER_NAMES) {
+        if (chord[modifier.code]) append(modifier.name);
+    }
+    for (size_t code = 0; code < chord.size(); ++code) {
+        if (!chord[code] || code == Key::CONTROL || code == Key::SHIFT || code == Key::MENU) continue;
+        append(key_name(static_cast<uint8_t>(code)));
+    }
+    return result;
+}
+
+bool parse_key_sequence(std::string_view text, const KeyState& leader, std::vector<KeyState>& sequence) {
+    sequence.clear();
+    size_t position = 0;
+    while (position < text.size()) {
+        if (text[position] == ' ' || text[position] == '\t' || text[position] == '\r') {
+            ++position;
+            continue;
+        }
+        size_t end = text.find_first_of(" \t\r", position);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view token = text.substr(position, end - position);
+        position = end;
+
+        KeyState chord;
+        if (equals_ignore_case(token, "Leader")) {
+            chord = leader;
+        } else if (!parse_chord(token, chord)) {
+            return false;
+        }
+        sequence.push_back(chord);
+    }
+    return !sequence.empty();
+}
+
+std::string key_sequence_string(const std::vector<KeyState>& sequence, const KeyState& leader) {
+    std::string result;
+    for (const KeyState& chord : sequence) {
+        if (!result.empty()) result += ' ';
+        result += chord == leader && leader.any() ? "Leader" : chord_string(chord);
+    }
+    return result;
+}
+
+KeyState parse_key_string(const std::string& str) {
+    KeyState keys{};
+    for (size_t i = 0; i < keys.size() && i < str.size(); ++i) {
+        keys[i] = str[i] == '1';
+    }
+    return keys;
+}
+
+bool is_key_string(const std::string& str) {
+    return str.size() == 256 && str.find_first_not_of("01") == std::string::npos;
+}
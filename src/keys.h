@@ -0,0 +1,67 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Which of the 256 virtual keys are held down, indexed by key code.
+/// Packed into four words, so comparing and hashing a chord is cheap.
+using KeyState = std::bitset<256>;
+
+/// @brief Virtual key codes with the same values as the Win32 VK_ constants, usable without windows.h.
+/// Letters and digits are their ASCII upper case characters.
+namespace Key {
+    constexpr uint8_t BACK = 0x08;
+    constexpr uint8_t TAB = 0x09;
+    constexpr uint8_t ENTER = 0x0D;
+    constexpr uint8_t SHIFT = 0x10;
+    constexpr uint8_t CONTROL = 0x11;
+    constexpr uint8_t MENU = 0x12; // Alt
+    constexpr uint8_t ESCAPE = 0x1B;
+    constexpr uint8_t SPACE = 0x20;
+    constexpr uint8_t PAGE_UP = 0x21;
+    constexpr uint8_t PAGE_DOWN = 0x22;
+    constexpr uint8_t END = 0x23;
+    constexpr uint8_t HOME = 0x24;
+    constexpr uint8_t LEFT = 0x25;
+    constexpr uint8_t UP = 0x26;
+    constexpr uint8_t RIGHT = 0x27;
+    constexpr uint8_t DOWN = 0x28;
+    constexpr uint8_t INSERT = 0x2D;
+    constexpr uint8_t DEL = 0x2E;
+    constexpr uint8_t F1 = 0x70;
+    constexpr uint8_t LSHIFT = 0xA0;
+    constexpr uint8_t RSHIFT = 0xA1;
+    constexpr uint8_t LCONTROL = 0xA2;
+    constexpr uint8_t RCONTROL = 0xA3;
+    constexpr uint8_t LMENU = 0xA4;
+    constexpr uint8_t RMENU = 0xA5;
+}
+
+/// @brief Folds the left and right shift, control and alt keys into the plain ones, which bindings use.
+void normalize_modifiers(KeyState& down);
+
+/// @brief Checks if nothing but shift, control and alt is down.
+bool is_modifier_only(const KeyState& down);
+
+/// @brief Parses a chord such as "Ctrl+Shift+H". Key names are case-insensitive and
+/// keys without a name can be given by code, e.g. "0xBA". Returns false on an unknown name.
+bool parse_chord(std::string_view text, KeyState& chord);
+
+/// @brief Writes a chord as its modifiers followed by its other keys, e.g. "Ctrl+Shift+H".
+std::string chord_string(const KeyState& chord);
+
+/// @brief Parses chords separated by spaces, e.g. "Ctrl+K Ctrl+C". "Leader" stands for the leader chord.
+/// Returns false on an unknown name or an empty sequence.
+bool parse_key_sequence(std::string_view text, const KeyState& leader, std::vector<KeyState>& sequence);
+
+/// @brief Writes a sequence of chords separated by spaces, writing the leader chord as "Leader".
+std::string key_sequence_string(const std::vector<KeyState>& sequence, const KeyState& leader);
+
+/// @brief Reads a key state in the old commands.cfg format: 256 characters, '1' for keys that are down.
+KeyState parse_key_string(const std::string& str);
+
+/// @brief Checks if a line is in the old 256 character key state format.
+bool is_key_string(const std::string& str);
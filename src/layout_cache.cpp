@@ -0,0 +1,71 @@
+#include "layout_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+LayoutCache::LayoutCache(size_t capacity)
+    : capacity(std::max<size_t>(1, capacity)), entries(), index(), hits(0), misses(0) {}
+
+const TextLayout& LayoutCache::get(TextShaper& shaper, std::wstring_view text, const std::vector<FormatRange>& formatting,
+                                   const LayoutStyle& style) {
+    uint64_t hash = hash_of(text, formatting, style);
+    auto [first, last] = index.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        if (matches(*it->second, text, formatting, style)) {
+            ++hits;
+            entries.splice(entries.begin(), entries, it->second);
+            return *entries.front().layout;
+        }
+    }
+
+    ++misses;
+    if (entries.size() >= capacity) {
+        // Evict the least recently used line
+        auto [evict_first, evict_last] = index.equal_range(entries.back().hash);
+        for (auto it = evict_first; it != evict_last; ++it) {
+            if (it->second == std::prev(entries.end())) {
+                index.erase(it);
+                break;
+            }
+        }
+        entries.pop_back();
+    }
+    entries.push_front({hash, std::wstring(text), formatting, style, shaper.shape(text, formatting, style)});
+    index.emplace(hash, entries.begin());
+    return *entries.front().layout;
+}
+
+void LayoutCache::clear() {
+    entries.clear();
+    index.clear();
+}
+
+uint64_t LayoutCache::hash_of(std::wstring_view text, const std::vector<FormatRange>& formatting, const LayoutStyle& style) {
+    // boost::hash_combine style mixing of the parts
+    auto combine = [](uint64_t seed, uint64_t value) {
+        return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+    };
+    uint64_t hash = std::hash<std::wstring_view>{}(text);
+    for (const FormatRange& range : formatting) {
+        hash = combine(hash, static_cast<uint64_t>(range.start_char));
+        hash = combine(hash, static_cast<uint64_t>(range.end_char));
+        hash = combine(hash, static_cast<uint64_t>(range.type));
+    }
+    hash = combine(hash, std::hash<std::wstring>{}(style.font_family));
+    hash = combine(hash, std::hash<float>{}(style.font_size));
+    hash = combine(hash, std::hash<float>{}(style.width));
+    hash = combine(hash, std::hash<float>{}(style.height));
+    return hash;
+}
+
+bool LayoutCache::matches(const Entry& entry, std::wstring_view text, const std::vector<FormatRange>& formatting,
+                          const LayoutStyle& style) {
+    if (entry.text != text || !(entry.style == style) || entry.formatting.size() != formatting.size()) return false;
+    // Formatting is relative to the line, so only columns and types matter
+    for (size_t i = 0; i < formatting.size(); ++i) {
+        const FormatRange& a = entry.formatting[i];
+        const FormatRange& b = formatting[i];
+        if (a.start_char != b.start_char || a.end_char != b.end_char || a.type != b.type) return false;
+    }
+    return true;
+}
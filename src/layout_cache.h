@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "formatting.h"
+
+/// @brief Font and box a line of text is shaped with.
+struct LayoutStyle {
+    std::wstring font_family;
+    float font_size;
+    float width;
+    float height;
+
+    bool operator==(const LayoutStyle&) const = default;
+};
+
+/// @brief A shaped line of text, owned by the backend that created it.
+class TextLayout {
+public:
+    virtual ~TextLayout() = default;
+};
+
+/// @brief Shapes lines of text into layouts. Implemented by each render backend.
+class TextShaper {
+public:
+    virtual ~TextShaper() = default;
+
+    /// @brief Shapes text with formatting whose columns are relative to the start of text.
+    virtual std::unique_ptr<TextLayout> shape(std::wstring_view text, const std::vector<FormatRange>& formatting,
+                                              const LayoutStyle& style) = 0;
+};
+
+/// @brief Keeps shaped line layouts so that unchanged lines are not shaped again every frame.
+///
+/// Layouts are keyed by the line's text, its formatting and the style, so an
+/// edit only misses for the lines whose contents it changed; layouts for old
+/// contents age out in least-recently-used order. Lookups hash the text and
+/// compare it in full, which is far cheaper than shaping it.
+class LayoutCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    explicit LayoutCache(size_t capacity = DEFAULT_CAPACITY);
+
+    /// @brief Gets the layout for a line, shaping it with shaper only if it is not cached.
+    /// The layout stays valid until capacity other lines have been looked up or the cache is cleared.
+    const TextLayout& get(TextShaper& shaper, std::wstring_view text, const std::vector<FormatRange>& formatting,
+                          const LayoutStyle& style);
+
+    void clear();
+
+    inline size_t size() const { return entries.size(); }
+    inline size_t get_hits() const { return hits; }
+    inline size_t get_misses() const { return misses; }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::wstring text;
+        std::vector<FormatRange> formatting;
+        LayoutStyle style;
+        std::unique_ptr<TextLayout> layout;
+    };
+
+    static uint64_t hash_of(std::wstring_view text, const std::vector<FormatRange>& formatting, const LayoutStyle& style);
+    static bool matches(const Entry& entry, std::wstring_view text, const std::vector<FormatRange>& formatting,
+                        const LayoutStyle& style);
+
+    size_t capacity;
+    std::list<Entry> entries; // Most recently used first
+    std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+    size_t hits;
+    size_t misses;
+};
@@ -0,0 +1,113 @@
+#include "line_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINE_INDEX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void scan_scalar(const char* data, size_t length, size_t base, std::vector<size_t>& out) {
+    const char* end = data + length;
+    const char* p = data;
+    while ((p = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)))) != nullptr) {
+        out.push_back(base + static_cast<size_t>(p - data));
+        ++p;
+    }
+}
+
+#ifdef LINE_INDEX_X86
+
+__attribute__((target("sse2")))
+void scan_sse2(const char* data, size_t length, size_t base, std::vector<size_t>& out) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        while (mask) {
+            out.push_back(base + i + static_cast<size_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+    scan_scalar(data + i, length - i, base + i, out);
+}
+
+__attribute__((target("avx2")))
+void scan_avx2(const char* data, size_t length, size_t base, std::vector<size_t>& out) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    // Two blocks per iteration so that lines longer than 64 bytes cost a single branch
+    for (; i + 64 <= length; i += 64) {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        unsigned long long mask =
+            static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline))) |
+            (static_cast<unsigned long long>(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)))) << 32);
+        while (mask) {
+            out.push_back(base + i + static_cast<size_t>(__builtin_ctzll(mask)));
+            mask &= mask - 1;
+        }
+    }
+    scan_sse2(data + i, length - i, base + i, out);
+}
+
+#endif
+
+} // namespace
+
+void scan_line_breaks(const char* data, size_t length, size_t base, std::vector<size_t>& out) {
+#ifdef LINE_INDEX_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_sse2 = __builtin_cpu_supports("sse2");
+    if (has_avx2) {
+        scan_avx2(data, length, base, out);
+        return;
+    }
+    if (has_sse2) {
+        scan_sse2(data, length, base, out);
+        return;
+    }
+#endif
+    scan_scalar(data, length, base, out);
+}
+
+std::vector<size_t> build_line_index(const char* data, size_t length, unsigned max_threads) {
+    std::vector<size_t> result;
+    if (max_threads == 0) {
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunk_count = std::min<size_t>(max_threads, std::max<size_t>(1, length / LINE_INDEX_MIN_CHUNK));
+    if (chunk_count <= 1) {
+        scan_line_breaks(data, length, 0, result);
+        return result;
+    }
+
+    size_t chunk_size = (length + chunk_count - 1) / chunk_count;
+    std::vector<std::vector<size_t>> chunks(chunk_count);
+    std::vector<std::thread> workers;
+    workers.reserve(chunk_count - 1);
+    for (size_t c = 1; c < chunk_count; ++c) {
+        workers.emplace_back([&, c]() {
+            size_t start = c * chunk_size;
+            size_t end = std::min(length, start + chunk_size);
+            if (start < end) scan_line_breaks(data + start, end - start, start, chunks[c]);
+        });
+    }
+    // The calling thread takes the first chunk itself
+    scan_line_breaks(data, std::min(length, chunk_size), 0, chunks[0]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Offsets are already absolute, so stitching is a plain concatenation
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.size();
+    result.reserve(total);
+    for (const auto& chunk : chunks) result.insert(result.end(), chunk.begin(), chunk.end());
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// @brief Inputs smaller than this are scanned on the calling thread.
+constexpr size_t LINE_INDEX_MIN_CHUNK = 1 << 20;
+
+/// @brief Appends base + the offset of every '\n' in data[0, length) to out.
+///
+/// Uses AVX2 or SSE2 when the CPU supports them and a scalar loop otherwise.
+void scan_line_breaks(const char* data, size_t length, size_t base, std::vector<size_t>& out);
+
+/// @brief Finds the offset of every '\n' in data[0, length).
+///
+/// Large inputs are split into chunks that are scanned on separate threads
+/// and then stitched together in order. A "\r\n" boundary is reported at its
+/// '\n'; callers that care check the preceding byte.
+std::vector<size_t> build_line_index(const char* data, size_t length, unsigned max_threads = 0);
+
@@ -0,0 +1,132 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : open(false), view(nullptr), length(0), file(INVALID_HANDLE_VALUE), mapping(NULL) {}
+
+MappedFile::MappedFile(const std::string& path)
+    : MappedFile() {
+    // FILE_SHARE_DELETE lets a save rename a new file over this one while it is still mapped
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        close();
+        return;
+    }
+    open = true;
+    length = static_cast<size_t>(file_size.QuadPart);
+    if (length == 0) return;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        close();
+        return;
+    }
+    view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (view == nullptr) {
+        close();
+    }
+}
+
+void MappedFile::close() {
+    if (view) UnmapViewOfFile(view);
+    if (mapping != NULL) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    open = false;
+    view = nullptr;
+    length = 0;
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : open(std::exchange(other.open, false)),
+      view(std::exchange(other.view, nullptr)),
+      length(std::exchange(other.length, 0)),
+      file(std::exchange(other.file, INVALID_HANDLE_VALUE)),
+      mapping(std::exchange(other.mapping, static_cast<HANDLE>(NULL))) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        open = std::exchange(other.open, false);
+        view = std::exchange(other.view, nullptr);
+        length = std::exchange(other.length, 0);
+        file = std::exchange(other.file, INVALID_HANDLE_VALUE);
+        mapping = std::exchange(other.mapping, static_cast<HANDLE>(NULL));
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile()
+    : open(false), view(nullptr), length(0), fd(-1) {}
+
+MappedFile::MappedFile(const std::string& path)
+    : MappedFile() {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close();
+        return;
+    }
+    open = true;
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0) return;
+
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return;
+    }
+    view = static_cast<const char*>(address);
+    madvise(address, length, MADV_SEQUENTIAL);
+}
+
+void MappedFile::close() {
+    if (view) munmap(const_cast<char*>(view), length);
+    if (fd >= 0) ::close(fd);
+    open = false;
+    view = nullptr;
+    length = 0;
+    fd = -1;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : open(std::exchange(other.open, false)),
+      view(std::exchange(other.view, nullptr)),
+      length(std::exchange(other.length, 0)),
+      fd(std::exchange(other.fd, -1)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        open = std::exchange(other.open, false);
+        view = std::exchange(other.view, nullptr);
+        length = std::exchange(other.length, 0);
+        fd = std::exchange(other.fd, -1);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
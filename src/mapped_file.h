@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/// @brief Read-only memory mapping of a whole file.
+///
+/// Pages are only faulted in as they are touched, so opening a file this way
+/// costs the same regardless of its size.
+class MappedFile {
+public:
+    MappedFile();
+
+    /// @brief Attempts to map the file at the specified path.
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /// @brief Checks if the file was opened. An empty file is open but has no mapping.
+    inline bool is_open() const { return open; }
+
+    inline const char* data() const { return view; }
+    inline size_t size() const { return length; }
+
+    /// @brief Unmaps the file and closes all handles.
+    void close();
+
+private:
+    bool open;
+    const char* view;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
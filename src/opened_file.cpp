@@ -1,67 +1,164 @@
 #include "opened_file.h"
 #include "config.h"
-#include "graphics.h"
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <algorithm>
+#include <cmath>
 
-OpenedFile::OpenedFile(const std::string& path)
+#include "block_text.h"
+#include "replace.h"
+#include "utf8.h"
+
+namespace {
+
+// The first character of UTF-8 text
+wchar_t first_character(std::string_view utf8) {
+    size_t length = 1;
+    while (length < utf8.size() && length < 4 && (static_cast<unsigned char>(utf8[length]) & 0xC0) == 0x80) ++length;
+    std::wstring decoded = utf8_to_wide(utf8.substr(0, length));
+    return decoded.empty() ? 0 : decoded.front();
+}
+
+// The last character of UTF-8 text
+wchar_t last_character(std::string_view utf8) {
+    size_t start = utf8.size() - 1;
+    while (start > 0 && utf8.size() - start < 4 && (static_cast<unsigned char>(utf8[start]) & 0xC0) == 0x80) --start;
+    std::wstring decoded = utf8_to_wide(utf8.substr(start));
+    return decoded.empty() ? 0 : decoded.back();
+}
+
+} // namespace
+
+OpenedFile::OpenedFile(const std::string& path, OpenMode mode)
     : file_path(path),
-      lines(),
+      text(),
+      line_view(),
       current_line(0),
       current_character(0),
       open(false),
-      past_actions(),
-      past_undos(),
-      selection() {
-    std::wifstream file(file_path);
+      history(),
+      undo_group_open(false),
+      undo_group_in_word(false),
+      last_edit_time(),
+      batch_depth(0),
+      batch_has_edits(false),
+      selection(),
+      cursors(),
+      find_needle(),
+      find_options(),
+      matches(),
+      formatting_manager(),
+      viewport(),
+      damage() {
+    if (mode == OpenMode::MAPPED && open_mapped()) {
+        return;
+    }
+    open_stream();
+}
+
+bool OpenedFile::open_mapped() {
+    auto mapping = std::make_shared<MappedFile>(file_path);
+    if (!mapping->is_open()) {
+        return false;
+    }
+    open = true;
+
+    size_t length = mapping->size();
+    if (length == 0) {
+        return true;
+    }
+    const char* bytes = mapping->data();
+    if (bytes == nullptr) {
+        open = false;
+        return false;
+    }
+
+    // Match std::getline, which does not produce an empty line after a trailing newline
+    if (bytes[length - 1] == '\n') {
+        --length;
+    }
+    text.reset(std::move(mapping), length);
+    return true;
+}
+
+void OpenedFile::open_stream() {
+    std::ifstream file(file_path, std::ios::binary);
     if (file.is_open()) {
         open = true;
-        std::wstring line;
-        while (std::getline(file, line)) {
-            lines.push_back(line);
-        }
+        set_contents(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
         file.close();
     }
-    if (lines.empty()) {
-        lines.push_back(L"");
-    }
 }
 
 OpenedFile::OpenedFile(const OpenedFile& other)
     : file_path(other.file_path),
-      lines(other.lines),
+      text(other.text),
+      line_view(),
       current_line(other.current_line),
       current_character(other.current_character),
       open(other.open),
-      past_actions(other.past_actions),
-      past_undos(other.past_undos),
-      selection(other.selection) {}
+      history(other.history),
+      undo_group_open(false),
+      undo_group_in_word(false),
+      last_edit_time(),
+      batch_depth(0),
+      batch_has_edits(false),
+      selection(other.selection),
+      cursors(other.cursors),
+      find_needle(other.find_needle),
+      find_options(other.find_options),
+      matches(other.matches),
+      formatting_manager(other.formatting_manager),
+      viewport(other.viewport),
+      damage(other.damage) {}
 
 OpenedFile& OpenedFile::operator=(const OpenedFile& other) {
     if (this != &other) {
         file_path = other.file_path;
-        lines = other.lines;
+        text = other.text;
+        line_view = LineView();
         current_line = other.current_line;
         current_character = other.current_character;
         open = other.open;
-        past_actions = other.past_actions;
-        past_undos = other.past_undos;
+        history = other.history;
+        undo_group_open = false;
+        batch_depth = 0;
+        batch_has_edits = false;
         selection = other.selection;
+        cursors = other.cursors;
+        find_needle = other.find_needle;
+        find_options = other.find_options;
+        matches = other.matches;
+        formatting_manager = other.formatting_manager;
+        viewport = other.viewport;
+        damage = other.damage;
     }
     return *this;
 }
 
 OpenedFile::OpenedFile(OpenedFile&& other) noexcept
     : file_path(std::move(other.file_path)),
-      lines(std::move(other.lines)),
+      text(std::move(other.text)),
+      line_view(),
       current_line(other.current_line),
       current_character(other.current_character),
       open(other.open),
-      past_actions(std::move(other.past_actions)),
-      past_undos(std::move(other.past_undos)),
-      selection(std::move(other.selection)) {
+      history(std::move(other.history)),
+      undo_group_open(false),
+      undo_group_in_word(false),
+      last_edit_time(),
+      batch_depth(0),
+      batch_has_edits(false),
+      selection(std::move(other.selection)),
+      cursors(std::move(other.cursors)),
+      find_needle(std::move(other.find_needle)),
+      find_options(other.find_options),
+      matches(std::move(other.matches)),
+      formatting_manager(std::move(other.formatting_manager)),
+      viewport(other.viewport),
+      damage(other.damage) {
     other.current_line = 0;
     other.current_character = 0;
     other.open = false;
@@ -70,13 +167,23 @@ OpenedFile::OpenedFile(OpenedFile&& other) noexcept
 OpenedFile& OpenedFile::operator=(OpenedFile&& other) noexcept {
     if (this != &other) {
         file_path = std::move(other.file_path);
-        lines = std::move(other.lines);
+        text = std::move(other.text);
+        line_view = LineView();
         current_line = other.current_line;
         current_character = other.current_character;
         open = other.open;
-        past_actions = std::move(other.past_actions);
-        past_undos = std::move(other.past_undos);
+        history = std::move(other.history);
+        undo_group_open = false;
+        batch_depth = 0;
+        batch_has_edits = false;
         selection = std::move(other.selection);
+        cursors = std::move(other.cursors);
+        find_needle = std::move(other.find_needle);
+        find_options = other.find_options;
+        matches = std::move(other.matches);
+        formatting_manager = std::move(other.formatting_manager);
+        viewport = other.viewport;
+        damage = other.damage;
 
         other.current_line = 0;
         other.current_character = 0;
@@ -89,93 +196,697 @@ bool OpenedFile::write() const {
     if (!open) {
         return false;
     }
-    std::wofstream file(file_path);
+    // The file cannot be overwritten while it is still mapped
+    text.detach_original();
+    std::ofstream file(file_path);
     if (!file.is_open()) {
         return false;
     }
-    for (const auto& line : lines) {
-        file << line << '\n';
-    }
+    file << text.get_text() << '\n';
     file.close();
     return true;
 }
 
+void OpenedFile::set_line(const std::wstring& str) {
+    size_t start = text.line_start(current_line);
+    std::string old_line = text.get_line(current_line);
+    apply(EditType::ERASE, start, old_line, false, 0, 0);
+    apply(EditType::INSERT, start, wide_to_utf8(str), false, 0, 0);
+}
+
+void OpenedFile::set_lines(const std::vector<std::wstring>& new_lines) {
+    std::string contents;
+    for (size_t i = 0; i < new_lines.size(); ++i) {
+        if (i > 0) contents += '\n';
+        contents += wide_to_utf8(new_lines[i]);
+    }
+    text.reset(std::move(contents));
+    damage.add_all();
+}
+
+void OpenedFile::set_contents(std::string utf8) {
+    // Only pay for a copy when the text actually has CRLF line endings
+    if (utf8.find("\r\n") != std::string::npos) {
+        size_t out = 0;
+        for (size_t in = 0; in < utf8.size(); ++in) {
+            if (utf8[in] == '\r' && in + 1 < utf8.size() && utf8[in + 1] == '\n') continue;
+            utf8[out++] = utf8[in];
+        }
+        utf8.resize(out);
+    }
+    // Match std::getline, which does not produce an empty line after a trailing newline
+    if (!utf8.empty() && utf8.back() == '\n') {
+        utf8.pop_back();
+    }
+    text.reset(std::move(utf8));
+    damage.add_all();
+}
+
+bool OpenedFile::has_contents(std::string_view utf8) const {
+    if (!utf8.empty() && utf8.back() == '\n') utf8.remove_suffix(1);
+    if (utf8.size() != text.length()) return false;
+    // An unedited document is one piece, which is viewed in place
+    std::string scratch;
+    return text.view(0, text.length(), scratch) == utf8;
+}
+
 // Selection methods
 void OpenedFile::start_selection() {
-    selection.start_selection(current_line, current_character);
+    if (batch_depth == 0) damage_selection();
+    selection.start_selection(offset_of(current_line, current_character));
 }
 
 void OpenedFile::update_selection() {
-    selection.update_selection(current_line, current_character);
+    size_t offset = offset_of(current_line, current_character);
+    // Moving a corner of a block can change the columns of every line in it
+    if (selection.has_selection() && selection.is_block()) {
+        if (batch_depth == 0) damage_selection();
+        selection.update_selection(offset);
+        if (batch_depth == 0) damage_selection();
+        return;
+    }
+    // The start stays put, so only the lines between the old and the new end change
+    if (selection.has_selection() && batch_depth == 0) {
+        size_t old_end = selection.get_end();
+        damage.add(line_at(std::min(old_end, offset)), line_at(std::max(old_end, offset)));
+    }
+    selection.update_selection(offset);
+}
+
+void OpenedFile::get_selection_range(int& start_line, int& start_char, int& end_line, int& end_char) const {
+    size_t start, end;
+    selection.get_normalized_range(start, end);
+    position_of(start, start_line, start_char);
+    position_of(end, end_line, end_char);
+}
+
+void OpenedFile::set_block_selection(bool block) {
+    if (!selection.has_selection() || selection.is_block() == block) return;
+    selection.set_block(block);
+    damage_selection();
+}
+
+void OpenedFile::get_block_range(int& first_line, int& last_line, int& first_column, int& last_column) const {
+    int start_line, start_char, end_line, end_char;
+    position_of(selection.get_start(), start_line, start_char);
+    position_of(selection.get_end(), end_line, end_char);
+    first_line = std::min(start_line, end_line);
+    last_line = std::max(start_line, end_line);
+    first_column = std::min(start_char, end_char);
+    last_column = std::max(start_char, end_char);
 }
 
 void OpenedFile::clear_selection() {
+    if (batch_depth == 0) damage_selection();
     selection.clear_selection();
 }
 
+void OpenedFile::damage_selection() {
+    if (!selection.has_selection()) return;
+    size_t start, end;
+    selection.get_normalized_range(start, end);
+    damage.add(line_at(start), line_at(end));
+}
+
 std::wstring OpenedFile::get_selected_text() const {
     if (!selection.has_selection()) return L"";
-    
-    int start_line, start_char, end_line, end_char;
-    selection.get_normalized_range(start_line, start_char, end_line, end_char);
-    
-    std::wstring result;
-    
-    if (start_line == end_line) {
-        // Selection within single line
-        result = lines[start_line].substr(start_char, end_char - start_char);
-    } else {
-        // Multi-line selection
-        // First line
-        result = lines[start_line].substr(start_char);
-        result += L'\n';
-        
-        // Middle lines
-        for (int i = start_line + 1; i < end_line; ++i) {
-            result += lines[i];
-            result += L'\n';
-        }
-        
-        // Last line
-        result += lines[end_line].substr(0, end_char);
+    if (selection.is_block()) {
+        int first_line, last_line, first_column, last_column;
+        get_block_range(first_line, last_line, first_column, last_column);
+        size_t start = text.line_start(first_line);
+        size_t end = text.line_start(last_line) + text.line_length(last_line);
+        return utf8_to_wide(extract_columns(text.get_text(start, end - start), first_column, last_column));
     }
     
-    return result;
+    size_t start, end;
+    selection.get_normalized_range(start, end);
+    return utf8_to_wide(text.get_text(start, end - start));
 }
 
 void OpenedFile::delete_selection() {
     if (!selection.has_selection()) return;
+    if (selection.is_block()) {
+        edit_block({}, 0);
+        clear_selection();
+        return;
+    }
     
     int start_line, start_char, end_line, end_char;
-    selection.get_normalized_range(start_line, start_char, end_line, end_char);
+    get_selection_range(start_line, start_char, end_line, end_char);
     
     delete_range(start_line, start_char, end_line, end_char);
     clear_selection();
 }
 
+void OpenedFile::insert_text(const std::wstring& str) {
+    int tab_size = Config::get_instance()->get_tab_size();
+    std::wstring inserted;
+    inserted.reserve(str.size());
+    int line_breaks = 0;
+    int last_line_characters = 0;
+    for (size_t i = 0; i < str.size(); ++i) {
+        wchar_t wc = str[i];
+        if (wc == L'\r' || wc == L'\n') {
+            // CRLF counts as one line break
+            if (wc == L'\r' && i + 1 < str.size() && str[i + 1] == L'\n') ++i;
+            inserted.push_back(L'\n');
+            ++line_breaks;
+            last_line_characters = 0;
+        } else if (wc == L'\t') {
+            inserted.append(tab_size, L' ');
+            last_line_characters += tab_size;
+        } else if (wc >= L' ') {
+            inserted.push_back(wc);
+            ++last_line_characters;
+        }
+    }
+
+    std::string bytes = wide_to_utf8(inserted);
+    if (!cursors.empty() || (has_block_selection() && line_breaks == 0)) {
+        insert_at_cursors(bytes);
+        return;
+    }
+    // Pasting over a selection replaces it, and is undone in one step along with the paste
+    bool replacing = selection.has_selection();
+    if (replacing) {
+        begin_batch();
+        delete_selection();
+    }
+    int line_after = current_line + line_breaks;
+    int character_after = (line_breaks > 0 ? 0 : current_character) + last_line_characters;
+    record({EditType::INSERT, true, false, offset_of(current_line, current_character), 0, 0,
+            current_line, current_character, line_after, character_after}, bytes);
+    if (replacing) {
+        end_batch();
+    }
+}
+
 void OpenedFile::apply_formatting(FormatType type) {
     if (!selection.has_selection()) return;
     
-    int start_line, start_char, end_line, end_char;
-    selection.get_normalized_range(start_line, start_char, end_line, end_char);
+    size_t start, end;
+    selection.get_normalized_range(start, end);
     
-    formatting_manager.add_formatting(start_line, start_char, end_line, end_char, type);
+    formatting_manager.add_formatting(start, end, type);
+    damage.add(line_at(start), line_at(end));
+}
+
+void OpenedFile::add_cursor(int line, int character) {
+    size_t offset = offset_of(line, character);
+    cursors.add(offset, offset);
+    damage.add(line);
+}
+
+void OpenedFile::clear_cursors() {
+    if (cursors.empty()) return;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        CursorSet::Cursor cursor = cursors.get(i);
+        damage.add(line_at(cursor.start()), line_at(cursor.end()));
+    }
+    cursors.clear();
+}
+
+size_t OpenedFile::select_all_occurrences() {
+    size_t start, end;
+    get_selection_or_word(start, end);
+    if (start == end) return 1;
+
+    clear_cursors();
+    Finder finder(text.get_text(start, end - start), FindOptions{true, false});
+    for (size_t found : finder.find_all(text)) {
+        if (found != start) {
+            cursors.add(found, found + finder.length());
+        }
+    }
+    damage.add_all();
+
+    // The main cursor selects the occurrence it was on
+    select_range(start, end);
+    return cursors.size() + 1;
+}
+
+size_t OpenedFile::find(std::string_view needle, FindOptions options) {
+    clear_find();
+    find_needle = needle;
+    find_options = options;
+
+    Finder finder(needle, options);
+    for (size_t start : finder.find_all(text)) {
+        matches.add(start, start + needle.size());
+    }
+    if (!matches.empty()) damage.add_all();
+    return matches.size();
+}
+
+size_t OpenedFile::find_selection(FindOptions options) {
+    size_t start, end;
+    get_selection_or_word(start, end);
+    if (start == end) return 0;
+
+    size_t count = find(text.get_text(start, end - start), options);
+    select_range(start, end);
+    return count;
+}
+
+bool OpenedFile::find_next() {
+    if (find_needle.empty()) return false;
+
+    // Continue after the selected match rather than finding it again
+    size_t from = offset_of(current_line, current_character);
+    if (selection.has_selection()) {
+        size_t start;
+        selection.get_normalized_range(start, from);
+    }
+    Finder finder(find_needle, find_options);
+    size_t found = finder.find_next(text, from);
+    if (found == Finder::NONE) found = finder.find_next(text, 0);
+    if (found == Finder::NONE) return false;
+
+    select_range(found, found + finder.length());
+    return true;
+}
+
+bool OpenedFile::find_previous() {
+    if (find_needle.empty()) return false;
+
+    size_t before = offset_of(current_line, current_character);
+    if (selection.has_selection()) {
+        size_t end;
+        selection.get_normalized_range(before, end);
+    }
+    Finder finder(find_needle, find_options);
+    size_t found = finder.find_previous(text, before);
+    if (found == Finder::NONE) found = finder.find_previous(text, text.length());
+    if (found == Finder::NONE) return false;
+
+    select_range(found, found + finder.length());
+    return true;
+}
+
+size_t OpenedFile::replace_all(std::string_view pattern, std::string_view format, FindOptions options, std::string& error) {
+    error.clear();
+    Replacements replacements;
+    {
+        std::string scratch;
+        if (!find_replacements(text.view(0, text.length(), scratch), pattern, format, options, replacements, error)) {
+            return 0;
+        }
+    }
+    if (replacements.spans.empty()) return 0;
+
+    // The highlighted matches would only be left covering what replaced them
+    clear_find();
+    clear_selection();
+    close_undo_group();
+
+    // The cursor keeps its place in the text around it, or ends up after the replacement it was in
+    size_t cursor = offset_of(current_line, current_character);
+    int64_t shift = 0;
+    for (const Replacement& span : replacements.spans) {
+        if (span.position >= cursor) break;
+        shift += static_cast<int64_t>(span.inserted_length) - static_cast<int64_t>(span.removed_length);
+        if (cursor < span.position + span.removed_length) {
+            cursor = span.position + span.removed_length;
+            break;
+        }
+    }
+
+    size_t count = replacements.spans.size();
+    Edit edit{EditType::REPLACE, true, false, replacements.spans.front().position, 0, 0,
+              current_line, current_character, 0, 0};
+    std::string packed = pack_replacements(replacements.spans, replacements.removed, replacements.inserted);
+    replacements = Replacements();
+    apply_replacements(packed, false, false, 0, 0);
+    position_of(static_cast<size_t>(static_cast<int64_t>(cursor) + shift), edit.line_after, edit.character_after);
+    move_cursor(edit.line_after, edit.character_after);
+    push_history(edit, packed);
+    return count;
+}
+
+void OpenedFile::clear_find() {
+    if (!matches.empty()) damage.add_all();
+    matches.clear();
+    find_needle.clear();
+}
+
+void OpenedFile::get_selection_or_word(size_t& start, size_t& end) const {
+    if (selection.has_selection()) {
+        selection.get_normalized_range(start, end);
+        return;
+    }
+    // Words never span lines, and are made of the same characters as whole-word matches
+    const std::wstring& line = get_line_contents(current_line);
+    size_t first = std::min(static_cast<size_t>(current_character), line.size());
+    size_t last = first;
+    while (first > 0 && is_word_character(line[first - 1])) --first;
+    while (last < line.size() && is_word_character(line[last])) ++last;
+    start = offset_of(current_line, static_cast<int>(first));
+    end = offset_of(current_line, static_cast<int>(last));
+}
+
+void OpenedFile::select_range(size_t start, size_t end) {
+    clear_selection();
+    int line, character;
+    position_of(end, line, character);
+    move_cursor(line, character);
+    close_undo_group();
+    selection.start_selection(start);
+    selection.update_selection(end);
+    if (batch_depth == 0) damage_selection();
+}
+
+void OpenedFile::insert_at_cursors(std::string_view utf8) {
+    if (has_block_selection()) {
+        edit_block(utf8, 0);
+    } else {
+        edit_at_cursors(utf8, 0);
+    }
+}
+
+void OpenedFile::backspace_at_cursors() {
+    if (has_block_selection()) {
+        edit_block({}, -1);
+    } else {
+        edit_at_cursors({}, -1);
+    }
+}
+
+void OpenedFile::delete_at_cursors() {
+    if (has_block_selection()) {
+        edit_block({}, 1);
+    } else {
+        edit_at_cursors({}, 1);
+    }
+}
+
+void OpenedFile::edit_block(std::string_view inserted, int direction) {
+    int first_line, last_line, first_column, last_column;
+    get_block_range(first_line, last_line, first_column, last_column);
+    if (first_column == last_column) {
+        if (direction < 0 && first_column > 0) --first_column;
+        if (direction > 0) ++last_column;
+    }
+    bool cursor_on_first = current_line == first_line;
+
+    size_t start = text.line_start(first_line);
+    size_t end = text.line_start(last_line) + text.line_length(last_line);
+    std::string old_lines = text.get_text(start, end - start);
+    std::string new_lines = replace_columns(old_lines, first_column, last_column, inserted);
+
+    // Splice in only what changed, so that anchors around it are left alone and the history stays small
+    size_t prefix = std::mismatch(old_lines.begin(), old_lines.end(), new_lines.begin(), new_lines.end()).first - old_lines.begin();
+    size_t suffix = 0;
+    size_t max_suffix = std::min(old_lines.size(), new_lines.size()) - prefix;
+    while (suffix < max_suffix && old_lines[old_lines.size() - 1 - suffix] == new_lines[new_lines.size() - 1 - suffix]) ++suffix;
+
+    int column_after = first_column + static_cast<int>(utf8_to_wide(inserted).size());
+    int head_line = cursor_on_first ? first_line : last_line;
+    int anchor_line = cursor_on_first ? last_line : first_line;
+    begin_batch();
+    record({EditType::ERASE, true, false, start + prefix, 0, 0, current_line, current_character, current_line, current_character},
+           std::string_view(old_lines).substr(prefix, old_lines.size() - prefix - suffix));
+    record({EditType::INSERT, true, false, start + prefix, 0, 0, current_line, current_character, head_line, column_after},
+           std::string_view(new_lines).substr(prefix, new_lines.size() - prefix - suffix));
+    move_cursor(head_line, std::min(column_after, get_num_characters(head_line)));
+
+    // Keep a zero width block on the same lines, so that typing carries on in every line
+    selection.start_selection(offset_of(anchor_line, column_after));
+    selection.update_selection(offset_of(head_line, column_after));
+    selection.set_block(true);
+    end_batch();
+}
+
+void OpenedFile::edit_at_cursors(std::string_view inserted, int direction) {
+    struct Target {
+        size_t start;
+        size_t end;
+        bool main;
+    };
+
+    // Every cursor as a span to replace, in document order, with overlapping ones merged
+    std::vector<Target> targets;
+    targets.reserve(cursors.size() + 1);
+    size_t main_start, main_end;
+    if (selection.has_selection()) {
+        selection.get_normalized_range(main_start, main_end);
+    } else {
+        main_start = main_end = offset_of(current_line, current_character);
+    }
+    std::vector<CursorSet::Cursor> sorted = cursors.get_sorted();
+    auto main_position = std::lower_bound(sorted.begin(), sorted.end(), main_start,
+        [](const CursorSet::Cursor& cursor, size_t offset) { return cursor.start() < offset; });
+    sorted.insert(main_position, {main_start, main_end});
+    for (const CursorSet::Cursor& cursor : sorted) {
+        bool main = cursor.start() == main_start && cursor.end() == main_end;
+        if (!targets.empty() && (cursor.start() < targets.back().end || cursor.start() == targets.back().start)) {
+            targets.back().end = std::max(targets.back().end, cursor.end());
+            targets.back().main = targets.back().main || main;
+        } else {
+            targets.push_back({cursor.start(), cursor.end(), main});
+        }
+    }
+
+    int line_before = current_line;
+    int character_before = current_character;
+    begin_batch();
+    selection.clear_selection();
+    cursors.clear();
+
+    // Working from the back keeps the offsets of the targets still to come valid. The edits are
+    // kept aside until the main cursor's final position is known, since undo and redo restore it
+    struct Pending {
+        Edit edit;
+        size_t text_offset;
+    };
+    std::vector<Pending> pending;
+    pending.reserve(targets.size() * (inserted.empty() ? 1 : 2));
+    std::string erased_text;
+    std::vector<size_t> carets(targets.size());
+    std::vector<int64_t> shifts(targets.size());
+    for (size_t i = targets.size(); i-- > 0;) {
+        size_t erase_start = targets[i].start;
+        size_t erase_end = targets[i].end;
+        if (erase_start == erase_end && direction < 0) {
+            // Back over one UTF-8 sequence, staying on the line and out of the previous target
+            size_t limit = std::max(text.line_start(text.line_of(erase_start)), i > 0 ? targets[i - 1].end : 0);
+            if (erase_start > limit) {
+                --erase_start;
+                while (erase_start > limit && (static_cast<unsigned char>(text.char_at(erase_start)) & 0xC0) == 0x80) --erase_start;
+            }
+        } else if (erase_start == erase_end && direction > 0) {
+            size_t limit = i + 1 < targets.size() ? targets[i + 1].start : text.length();
+            if (erase_end < limit) {
+                ++erase_end;
+                while (erase_end < limit && (static_cast<unsigned char>(text.char_at(erase_end)) & 0xC0) == 0x80) ++erase_end;
+            }
+        }
+
+        if (erase_end > erase_start) {
+            size_t text_offset = erased_text.size();
+            erased_text += text.get_text(erase_start, erase_end - erase_start);
+            apply(EditType::ERASE, erase_start, std::string_view(erased_text).substr(text_offset), false, 0, 0);
+            pending.push_back({{EditType::ERASE, false, false, erase_start, erase_end - erase_start, 0, 0, 0, 0, 0}, text_offset});
+        }
+        if (!inserted.empty()) {
+            apply(EditType::INSERT, erase_start, inserted, false, 0, 0);
+            pending.push_back({{EditType::INSERT, false, false, erase_start, inserted.size(), 0, 0, 0, 0, 0}, SIZE_MAX});
+        }
+        carets[i] = erase_start + inserted.size();
+        shifts[i] = static_cast<int64_t>(inserted.size()) - static_cast<int64_t>(erase_end - erase_start);
+    }
+
+    // Each cursor ends up after its own text, moved by everything that changed in front of it
+    int64_t shift = 0;
+    size_t main_offset = 0;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        size_t offset = static_cast<size_t>(static_cast<int64_t>(carets[i]) + shift);
+        shift += shifts[i];
+        if (targets[i].main) {
+            main_offset = offset;
+        } else {
+            cursors.add(offset, offset);
+        }
+    }
+    int line_after, character_after;
+    position_of(main_offset, line_after, character_after);
+    move_cursor(line_after, character_after);
+
+    // Only the first and last entries move the cursor, which is where undo and redo stop
+    for (size_t i = 0; i < pending.size(); ++i) {
+        Edit& edit = pending[i].edit;
+        edit.move_cursor = i == 0 || i + 1 == pending.size();
+        edit.line_before = line_before;
+        edit.character_before = character_before;
+        edit.line_after = line_after;
+        edit.character_after = character_after;
+        std::string_view bytes = edit.type == EditType::ERASE
+            ? std::string_view(erased_text).substr(pending[i].text_offset, edit.length)
+            : inserted;
+        push_history(edit, bytes);
+    }
+    end_batch();
 }
 
 std::vector<FormatRange> OpenedFile::get_line_formatting(int line) const {
     std::vector<FormatRange> result;
-    
-    // Get all formatting ranges that intersect with this line
-    for (const auto& range : formatting_manager.get_all_ranges()) {
-        if (range.start_line <= line && range.end_line >= line) {
-            result.push_back(range);
-        }
+    size_t first = text.line_start(line);
+    for (const FormatSpan& span : formatting_manager.get_formatting_in(first, first + text.line_length(line))) {
+        int start_line, start_char, end_line, end_char;
+        position_of(span.start, start_line, start_char);
+        position_of(span.end, end_line, end_char);
+        result.emplace_back(start_line, start_char, end_line, end_char, span.type);
     }
-    
     return result;
 }
 
+void OpenedFile::position_of(size_t offset, int& line, int& character) const {
+    offset = std::min(offset, text.length());
+    size_t line_index = text.line_of(offset);
+    line = static_cast<int>(line_index);
+    character = static_cast<int>(line_view.column_of(text, line_index, offset));
+}
+
 // Edit methods
+void OpenedFile::record(const Edit& edit, std::string_view bytes, bool typing) {
+    if (bytes.empty()) {
+        return;
+    }
+    apply(edit.type, edit.position, bytes, edit.move_cursor, edit.line_after, edit.character_after);
+
+    // Inserts are typed forwards and backspaces remove text backwards, so the byte that joins
+    // this edit onto the run is the first one of an insert and the last one of an erase
+    bool inserting = edit.type == EditType::INSERT;
+    bool joins_word = is_word_character(inserting ? first_character(bytes) : last_character(bytes));
+    auto now = std::chrono::steady_clock::now();
+    auto pause = std::chrono::milliseconds(Config::get_instance()->get_undo_group_timeout());
+
+    bool merged = typing && undo_group_open
+        && now - last_edit_time <= pause
+        && !(joins_word && !undo_group_in_word)
+        && history.extend(edit, bytes);
+    if (!merged) {
+        push_history(edit, bytes);
+    }
+
+    undo_group_open = typing;
+    undo_group_in_word = is_word_character(inserting ? last_character(bytes) : first_character(bytes));
+    last_edit_time = now;
+}
+
+void OpenedFile::push_history(const Edit& edit, std::string_view bytes) {
+    Edit entry = edit;
+    entry.joins_previous = batch_has_edits;
+    history.set_memory_limit(static_cast<size_t>(std::max(0, Config::get_instance()->get_undo_memory_limit())) * 1024);
+    history.push(entry, bytes);
+    batch_has_edits = batch_depth > 0;
+}
+
+void OpenedFile::apply(EditType type, size_t position, std::string_view bytes, bool move_cursor, int line, int character) {
+    // Adding or removing a line break moves every line below it
+    int edited_line = line_at(position);
+    bool line_breaks = bytes.find('\n') != std::string_view::npos;
+    int digits = line_breaks ? gutter_digits() : 0;
+    if (line_breaks) {
+        damage.add_from(edited_line);
+    } else {
+        damage.add(edited_line);
+    }
+
+    if (type == EditType::INSERT) {
+        text.insert(position, bytes);
+    } else {
+        text.erase(position, bytes.size());
+    }
+    // A wider or narrower gutter moves the lines above the edit as well
+    if (line_breaks && gutter_digits() != digits) {
+        damage.add_all();
+    }
+    move_anchors(type, position, bytes.size());
+    if (move_cursor) {
+        this->move_cursor(line, character);
+    }
+}
+
+int OpenedFile::gutter_digits() const {
+    // Only the line numbers on screen are drawn, so only those set the width
+    size_t end_line = text.line_count_up_to(static_cast<size_t>(std::max(0, viewport.get_end_line())));
+    return std::max(4, static_cast<int>(std::to_string(end_line).size()));
+}
+
+void OpenedFile::move_anchors(EditType type, size_t position, size_t length) {
+    if (type == EditType::INSERT) {
+        formatting_manager.on_insert(position, length);
+        selection.on_insert(position, length);
+        cursors.on_insert(position, length);
+        matches.on_insert(position, length);
+    } else {
+        formatting_manager.on_erase(position, length);
+        selection.on_erase(position, length);
+        cursors.on_erase(position, length);
+        matches.on_erase(position, length);
+    }
+}
+
+void OpenedFile::apply_replacements(std::string_view packed, bool revert, bool move_cursor, int line, int character) {
+    std::vector<Replacement> spans;
+    std::string_view removed, inserted;
+    unpack_replacements(packed, spans, removed, inserted);
+    if (spans.empty()) return;
+    damage.add_from(line_at(spans.front().position));
+    int digits = gutter_digits();
+
+    // Splice the whole document in one pass, copying the text between the spans and putting
+    // each span's new text in its place. Reverting swaps which text goes in and which comes out.
+    std::string scratch;
+    std::string_view source = text.view(0, text.length(), scratch);
+    std::string_view put = revert ? removed : inserted;
+    std::string result;
+    result.reserve(source.size() - (revert ? inserted.size() : removed.size()) + put.size());
+    size_t read = 0;
+    size_t put_offset = 0;
+    int64_t shift = 0; // How far the spans so far moved what follows them
+    for (const Replacement& span : spans) {
+        size_t take = revert ? span.inserted_length : span.removed_length;
+        size_t give = revert ? span.removed_length : span.inserted_length;
+        size_t position = span.position + (revert ? shift : 0);
+        result.append(source.substr(read, position - read));
+        result.append(put.substr(put_offset, give));
+        put_offset += give;
+        read = position + take;
+
+        // Anchors see the spans one at a time, front to back, as if each was its own edit
+        size_t anchor_position = span.position + (revert ? 0 : shift);
+        move_anchors(EditType::ERASE, anchor_position, take);
+        move_anchors(EditType::INSERT, anchor_position, give);
+        shift += static_cast<int64_t>(span.inserted_length) - static_cast<int64_t>(span.removed_length);
+    }
+    result.append(source.substr(read));
+    scratch = std::string();
+    text.reset(std::move(result));
+    if (gutter_digits() != digits) {
+        damage.add_all();
+    }
+
+    if (move_cursor) {
+        this->move_cursor(line, character);
+    }
+}
+
+void OpenedFile::replay(const Edit& edit, bool undoing) {
+    std::string_view bytes = history.text_of(edit);
+    int line = undoing ? edit.line_before : edit.line_after;
+    int character = undoing ? edit.character_before : edit.character_after;
+    if (edit.type == EditType::REPLACE) {
+        apply_replacements(bytes, undoing, edit.move_cursor, line, character);
+        return;
+    }
+    EditType type = edit.type;
+    if (undoing) {
+        type = type == EditType::INSERT ? EditType::ERASE : EditType::INSERT;
+    }
+    apply(type, edit.position, bytes, edit.move_cursor, line, character);
+}
+
 void OpenedFile::new_line(int line_number, int character_position, bool move_cursor) {
     if (line_number == -1) {
         line_number = current_line;
@@ -190,40 +901,14 @@ void OpenedFile::new_line(int line_number, int character_position, bool move_cur
         character_position = current_character;
     }
 
+    const std::wstring& line_contents = get_line_contents(line_number);
     int n_spaces = 0;
-    while (n_spaces < static_cast<int>(lines[line_number].size()) && lines[line_number][n_spaces] == ' ') ++n_spaces;
-    
-    std::wstring deleted_characters = lines[line_number].substr(character_position);
-    past_actions.push_back(Edit(
-        [this, line_number, character_position, move_cursor, n_spaces, deleted_characters = std::move(deleted_characters)]() mutable {
-            std::wstring new_line(n_spaces, L' ');
-            if (character_position < static_cast<int>(lines[line_number].size())) {
-                new_line += lines[line_number].substr(character_position);
-                lines[line_number] = lines[line_number].substr(0, character_position);
-            }
-            lines.insert(lines.begin() + line_number + 1, std::move(new_line));
-            if (move_cursor) {
-                set_current_line(line_number + 1);
-                set_current_character(n_spaces);
-            }
-            return true;
-        },
-        [this, line_number, character_position, move_cursor, deleted_characters]() {
-            lines.erase(lines.begin() + line_number + 1);
-            lines[line_number] += deleted_characters;
-            if (move_cursor) {
-                set_current_line(line_number);
-                set_current_character(character_position);
-            }
-            return true;
-        }
-    ));
-    
-    past_actions.back().edit();
-    if (static_cast<int>(past_actions.size()) > Config::get_instance()->get_undo_history_size()) {
-        past_actions.pop_front();
-    }
-    past_undos.clear();
+    while (n_spaces < static_cast<int>(line_contents.size()) && line_contents[n_spaces] == ' ') ++n_spaces;
+
+    std::string inserted(1, '\n');
+    inserted.append(n_spaces, ' ');
+    record({EditType::INSERT, move_cursor, false, offset_of(line_number, character_position), 0, 0,
+            line_number, character_position, line_number + 1, n_spaces}, inserted);
 }
 
 void OpenedFile::insert_character(char character, int line_number, int char_position, bool move_cursor) {
@@ -240,54 +925,17 @@ void OpenedFile::insert_character(char character, int line_number, int char_posi
         char_position = current_character;
     }
 
+    std::string inserted;
+    int columns = 1;
     if (character == '\t') {
-        int tab_size = Config::get_instance()->get_tab_size();
-        past_actions.push_back(Edit(
-            [this, line_number, char_position, tab_size, move_cursor]() {
-                this->lines[line_number].insert(this->lines[line_number].begin() + char_position, tab_size, ' ');
-                if (move_cursor) {
-                    this->set_current_line(line_number);
-                    this->set_current_character(char_position + tab_size);
-                }
-                return true;
-            },
-            [this, line_number, char_position, tab_size, move_cursor]() {
-                this->lines[line_number].erase(this->lines[line_number].begin() + char_position, this->lines[line_number].begin() + char_position + tab_size);
-                if (move_cursor) {
-                    this->set_current_line(line_number);
-                    this->set_current_character(char_position);
-                }
-                return true;
-            }
-        ));
+        columns = Config::get_instance()->get_tab_size();
+        inserted.assign(columns, ' ');
     } else {
-        wchar_t wch = static_cast<wchar_t>(character);
-        past_actions.push_back(Edit(
-            [this, line_number, char_position, wch, move_cursor]() {
-                this->lines[line_number].insert(this->lines[line_number].begin() + char_position, 1, wch);
-                if (move_cursor) {
-                    this->set_current_line(line_number);
-                    this->set_current_character(char_position + 1);
-                }
-                return true;
-            },
-            [this, line_number, char_position, move_cursor]() {
-                this->lines[line_number].erase(this->lines[line_number].begin() + char_position, this->lines[line_number].begin() + char_position + 1);
-                if (move_cursor) {
-                    this->set_current_line(line_number);
-                    this->set_current_character(char_position);
-                }
-                return true;
-            }
-        ));
-    }
-    
-    past_actions.back().edit();
-    past_undos.clear();
-    
-    if (static_cast<int>(past_actions.size()) > Config::get_instance()->get_undo_history_size()) {
-        past_actions.pop_front();
+        // Characters arrive as single bytes; anything outside ASCII is treated as Latin-1
+        inserted = wide_to_utf8(std::wstring(1, static_cast<wchar_t>(static_cast<unsigned char>(character))));
     }
+    record({EditType::INSERT, move_cursor, false, offset_of(line_number, char_position), 0, 0,
+            line_number, char_position, line_number, char_position + columns}, inserted, true);
 }
 
 void OpenedFile::delete_character(int line_number, int char_position, bool move_cursor) {
@@ -304,32 +952,10 @@ void OpenedFile::delete_character(int line_number, int char_position, bool move_
     }
 
     if (char_position > 0) {
-        wchar_t deleted = lines[line_number][char_position - 1];
-        past_actions.push_back(Edit(
-            [this, line_number, char_position, move_cursor, deleted]() {
-                this->lines[line_number].erase(this->lines[line_number].begin() + char_position - 1, this->lines[line_number].begin() + char_position);
-                if (move_cursor) {
-                    this->set_current_line(line_number);
-                    this->set_current_character(char_position - 1);
-                }
-                return true;
-            },
-            [this, line_number, char_position, move_cursor, deleted]() {
-                this->lines[line_number].insert(this->lines[line_number].begin() + char_position - 1, 1, deleted);
-                if (move_cursor) {
-                    this->set_current_line(line_number);
-                    this->set_current_character(char_position);
-                }
-                return true;
-            }
-        ));
-        
-        past_actions.back().edit();
-        past_undos.clear();
-        
-        if (static_cast<int>(past_actions.size()) > Config::get_instance()->get_undo_history_size()) {
-            past_actions.pop_front();
-        }
+        size_t deleted_start = offset_of(line_number, char_position - 1);
+        std::string deleted = text.get_text(deleted_start, offset_of(line_number, char_position) - deleted_start);
+        record({EditType::ERASE, move_cursor, false, deleted_start, 0, 0,
+                line_number, char_position, line_number, char_position - 1}, deleted, true);
     }
 }
 
@@ -344,107 +970,106 @@ void OpenedFile::delete_range(int start_line, int start_char, int end_line, int
         std::swap(start_char, end_char);
     }
 
-    std::wstring deleted_content;
-    int num_lines_deleted = 0;
-
-    if (start_line == end_line) {
-        deleted_content = lines[start_line].substr(start_char, end_char - start_char);
-        num_lines_deleted = 0;
-    } else {
-        deleted_content = lines[start_line].substr(start_char) + L"\n";
-        for (int l = start_line + 1; l < end_line; ++l) {
-            deleted_content += lines[l] + L"\n";
-        }
-        deleted_content += lines[end_line].substr(0, end_char);
-        num_lines_deleted = end_line - start_line;
-    }
+    size_t start_offset = offset_of(start_line, start_char);
+    size_t end_offset = offset_of(end_line, end_char);
+    std::string deleted_content = text.get_text(start_offset, end_offset - start_offset);
 
-    past_actions.push_back(Edit(
-        [this, start_line, start_char, end_line, end_char, num_lines_deleted, move_cursor]() {
-            if (num_lines_deleted == 0) {
-                this->lines[start_line].erase(start_char, end_char - start_char);
-            } else {
-                this->lines[start_line].erase(start_char);
-                this->lines[start_line] += this->lines[end_line].substr(end_char);
-                this->lines.erase(this->lines.begin() + start_line + 1, this->lines.begin() + end_line + 1);
-            }
-            if (move_cursor) {
-                set_current_line(start_line);
-                set_current_character(start_char);
-            }
-            return true;
-        },
-        [this, start_line, start_char, deleted_content, num_lines_deleted, move_cursor]() {
-            if (num_lines_deleted == 0) {
-                this->lines[start_line].insert(start_char, deleted_content);
-            } else {
-                std::vector<std::wstring> restored_lines;
-                std::wstring current_line_text;
-                for (wchar_t ch : deleted_content) {
-                    if (ch == L'\n') {
-                        restored_lines.push_back(current_line_text);
-                        current_line_text.clear();
-                    } else {
-                        current_line_text += ch;
-                    }
-                }
-                restored_lines.push_back(current_line_text);
-                std::wstring after_cursor = this->lines[start_line].substr(start_char);
-                this->lines[start_line] = this->lines[start_line].substr(0, start_char) + restored_lines[0];
-                for (size_t i = 1; i < restored_lines.size() - 1; ++i) {
-                    this->lines.insert(this->lines.begin() + start_line + i, restored_lines[i]);
-                }
-                this->lines.insert(this->lines.begin() + start_line + restored_lines.size() - 1,
-                                 restored_lines[restored_lines.size() - 1] + after_cursor);
-            }
-            return true;
-        }
-    ));
-    
-    past_actions.back().edit();
-    past_undos.clear();
-    
-    if (static_cast<int>(past_actions.size()) > Config::get_instance()->get_undo_history_size()) {
-        past_actions.pop_front();
-    }
+    // Undoing puts the cursor back where it was when the range was deleted
+    record({EditType::ERASE, move_cursor, false, start_offset, 0, 0,
+            current_line, current_character, start_line, start_char}, deleted_content);
 }
 
 bool OpenedFile::undo() {
-    if (past_actions.empty()) {
+    close_undo_group();
+    const Edit* edit = history.undo();
+    if (edit == nullptr) {
         return false;
     }
-    bool result = past_actions.back().undo();
-    past_undos.push_back(std::move(past_actions.back()));
-    past_actions.pop_back();
-    return result;
+    // Entries recorded in one batch are walked back together, newest first
+    bool joined;
+    do {
+        replay(*edit, true);
+        joined = edit->joins_previous;
+    } while (joined && (edit = history.undo()) != nullptr);
+    return true;
 }
 
 bool OpenedFile::redo() {
-    if (!past_undos.empty()) {
-        bool result = past_undos.back().edit();
-        past_actions.push_back(past_undos.back());
-        past_undos.pop_back();
-        return result;
+    close_undo_group();
+    const Edit* edit = history.redo();
+    if (edit == nullptr) {
+        return false;
     }
-    return false;
+    replay(*edit, false);
+    while (history.redo_joins_previous()) {
+        replay(*history.redo(), false);
+    }
+    return true;
+}
+
+void OpenedFile::begin_batch() {
+    if (batch_depth++ > 0) return;
+    // Typing from before the batch must not be merged into it
+    close_undo_group();
+    batch_has_edits = false;
+    damage_selection();
+}
+
+void OpenedFile::end_batch() {
+    if (batch_depth == 0 || --batch_depth > 0) return;
+    close_undo_group();
+    batch_has_edits = false;
+    damage_selection();
 }
 
-void OpenedFile::draw(Graphics* g, int start_x, int start_y, int max_chars_per_line, int max_lines) const {
+void OpenedFile::for_each_selected_line(const std::function<void()>& step) {
+    if (!selection.has_selection()) return;
+    int first_line, first_char, last_line, last_char;
+    get_selection_range(first_line, first_char, last_line, last_char);
+
+    begin_batch();
+    clear_selection();
+    for (int line = first_line; line <= last_line && has_line(line); ++line) {
+        int lines_before = get_num_lines();
+        set_current_line(line);
+        set_current_character(0);
+        step();
+        // Lines the step added or removed move the ones still to come
+        int added = get_num_lines() - lines_before;
+        line += added;
+        last_line += added;
+    }
+    end_batch();
+}
+
+void OpenedFile::draw(Renderer* g, float top, float bottom) const {
     const float& font_size = Config::get_instance()->get_font_size();
     int line_height = static_cast<int>(Config::get_instance()->get_font_size() * 1.25f);
+    float char_width = font_size * 0.6f;
+
+    int first_line = viewport.get_first_line();
+    // Only the lines up to the bottom of the viewport need to be indexed to draw them
+    int end_line = static_cast<int>(text.line_count_up_to(static_cast<size_t>(std::max(0, viewport.get_end_line()))));
+    int first_column = viewport.get_first_column();
+    int visible_columns = viewport.get_visible_columns();
+
+    // Lines outside the band keep what was drawn for them last time
+    int band_first = first_line + static_cast<int>(std::max(0.0f, top) / line_height);
+    int band_end = bottom < static_cast<float>(end_line - first_line) * line_height
+        ? first_line + static_cast<int>(std::ceil(bottom / line_height))
+        : end_line;
 
     // Calculate line number area width
     float line_number_width = 0;
     if (Config::get_instance()->get_show_line_numbers()) {
-        // Calculate width needed for line numbers (assuming up to 4 digits)
-        line_number_width = font_size * 0.6f * 4 + 10; // 4 digits + 10px padding
+        line_number_width = char_width * gutter_digits() + 10; // digits + 10px padding
         
         // Draw line numbers
         g->SetColor(Config::get_instance()->get_line_number_color());
-        for (int i = 0; i < max_lines && i < static_cast<int>(lines.size()); ++i) {
+        for (int i = band_first; i < band_end; ++i) {
             std::wstring line_number = std::to_wstring(i + 1);
             float numbers_x = Config::get_instance()->get_explorer_width() + 5; // 5 pixels from left edge
-            g->DrawString(line_number.c_str(), static_cast<int>(line_number.length()), numbers_x, static_cast<float>(start_y + i * line_height), line_number_width, static_cast<float>(line_height));
+            g->DrawString(line_number.c_str(), static_cast<int>(line_number.length()), numbers_x, static_cast<float>((i - first_line) * line_height), line_number_width, static_cast<float>(line_height));
         }   
     }
 
@@ -453,74 +1078,116 @@ void OpenedFile::draw(Graphics* g, int start_x, int start_y, int max_chars_per_l
     // Get normalized selection range if active
     int sel_start_line = -1, sel_start_char = -1, sel_end_line = -1, sel_end_char = -1;
     bool has_sel = selection.has_selection();
-    if (has_sel) {
-        selection.get_normalized_range(sel_start_line, sel_start_char, sel_end_line, sel_end_char);
+    int block_first_column = 0, block_last_column = 0;
+    if (has_sel && selection.is_block()) {
+        get_block_range(sel_start_line, sel_end_line, block_first_column, block_last_column);
+    } else if (has_sel) {
+        get_selection_range(sel_start_line, sel_start_char, sel_end_line, sel_end_char);
+    }
+
+    auto highlight = [&](int line, int highlight_start, int highlight_end, const Color& color) {
+        highlight_start = std::max(highlight_start, first_column) - first_column;
+        highlight_end = std::min(highlight_end, first_column + visible_columns) - first_column;
+        if (highlight_start >= highlight_end) return;
+
+        float line_y = static_cast<float>((line - first_line) * line_height);
+        float highlight_x = x + highlight_start * char_width;
+        float highlight_width = (highlight_end - highlight_start) * char_width;
+        g->SetColor(color);
+        g->FillRect(highlight_x, line_y, highlight_x + highlight_width, line_y + line_height);
+    };
+    auto draw_cursor = [&](int line, int character) {
+        if (line < band_first || line >= band_end || character < first_column) return;
+        float cursor_x = (character - first_column) * char_width + x;
+        float cursor_y = static_cast<float>((line - first_line) * line_height);
+        g->SetColor(Config::get_instance()->get_indicator_color());
+        g->DrawLine(cursor_x, cursor_y, cursor_x, cursor_y + line_height, 2.0f);
+    };
+
+    const Color selection_color(Color::LIGHT_BLUE, 0.4f);
+    size_t band_start_offset = 0, band_end_offset = 0;
+    if (band_first < band_end) {
+        band_start_offset = text.line_start(band_first);
+        band_end_offset = text.line_start(band_end - 1) + text.line_length(band_end - 1);
     }
 
-    // Draw text and selection
-    for (int i = 0; i < max_lines && i < static_cast<int>(lines.size()); ++i) {
-        float line_y = static_cast<float>(start_y + i * line_height);
-        std::wstring line = lines[i];
+    // Matches of the last search that touch the band, under the selections
+    if (!matches.empty() && band_first < band_end) {
+        const Color match_color(Color::YELLOW, 0.3f);
+        for (const auto& [start, end] : matches.get_in(band_start_offset, band_end_offset + 1)) {
+            int start_line, start_char, end_line, end_char;
+            position_of(start, start_line, start_char);
+            position_of(end, end_line, end_char);
+            for (int i = std::max(start_line, band_first); i <= std::min(end_line, band_end - 1); ++i) {
+                highlight(i, i == start_line ? start_char : 0, i == end_line ? end_char : get_num_characters(i), match_color);
+            }
+        }
+    }
+
+    // Extra cursors that touch the band, with their selections drawn under the text
+    std::vector<std::pair<int, int>> extra_cursors;
+    if (!cursors.empty() && band_first < band_end) {
+        for (const CursorSet::Cursor& cursor : cursors.get_sorted()) {
+            if (cursor.start() > band_end_offset) break;
+            if (cursor.end() < band_start_offset) continue;
+
+            int start_line, start_char, end_line, end_char;
+            position_of(cursor.start(), start_line, start_char);
+            position_of(cursor.end(), end_line, end_char);
+            for (int i = std::max(start_line, band_first); i <= std::min(end_line, band_end - 1); ++i) {
+                highlight(i, i == start_line ? start_char : 0, i == end_line ? end_char : get_num_characters(i), selection_color);
+            }
+            if (cursor.head == cursor.start()) {
+                extra_cursors.emplace_back(start_line, start_char);
+            } else {
+                extra_cursors.emplace_back(end_line, end_char);
+            }
+        }
+    }
+
+    // Draw text and selection, visiting only the lines in the viewport
+    for (int i = band_first; i < band_end; ++i) {
+        float line_y = static_cast<float>((i - first_line) * line_height);
+
+        auto line_formatting = get_line_formatting(i);
+        const std::wstring& line = get_line_contents(i);
+        int line_length = static_cast<int>(line.length());
         
         // Draw selection highlighting for this line
         if (has_sel && i >= sel_start_line && i <= sel_end_line) {
-            int highlight_start = 0;
-            int highlight_end = static_cast<int>(line.length());
-            
-            if (i == sel_start_line) {
-                highlight_start = sel_start_char;
-            }
-            if (i == sel_end_line) {
-                highlight_end = sel_end_char;
-            }
-            
-            if (highlight_start < highlight_end) {
-                float highlight_x = x + highlight_start * font_size * 0.6f;
-                float highlight_width = (highlight_end - highlight_start) * font_size * 0.6f;
-                
-                // Draw selection background
-                g->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.4f));
-                g->FillRect(highlight_x, line_y, highlight_x + highlight_width, line_y + line_height);
+            if (selection.is_block()) {
+                highlight(i, block_first_column, std::min(block_last_column, line_length), selection_color);
+            } else {
+                highlight(i, i == sel_start_line ? sel_start_char : 0, i == sel_end_line ? sel_end_char : line_length, selection_color);
             }
         }
         
         // Draw text
         g->SetColor(Config::get_instance()->get_text_color());
         
-        // Get formatting for this line
-        auto line_formatting = get_line_formatting(i);
-        
-        if (start_x > 0 || start_x + max_chars_per_line < static_cast<int>(line.length())) {
-            std::wstring substringed_line = line.substr(start_x, max_chars_per_line);
-            
-            // Adjust formatting ranges for substring
-            std::vector<FormatRange> adjusted_formatting;
-            for (const auto& range : line_formatting) {
-                if (range.start_line == i && range.end_line == i) {
-                    // Single line range - adjust for substring
-                    int adj_start = std::max(0, range.start_char - start_x);
-                    int adj_end = std::min(max_chars_per_line, range.end_char - start_x);
-                    if (adj_start < adj_end) {
-                        adjusted_formatting.emplace_back(i, adj_start, i, adj_end, range.type);
-                    }
-                }
+        // Clip formatting to the visible columns of this line
+        std::vector<FormatRange> visible_formatting;
+        for (const auto& range : line_formatting) {
+            int range_start = range.start_line == i ? range.start_char : 0;
+            int range_end = range.end_line == i ? range.end_char : line_length;
+            range_start = std::max(range_start, first_column) - first_column;
+            range_end = std::min(range_end, first_column + visible_columns) - first_column;
+            if (range_start < range_end) {
+                visible_formatting.emplace_back(i, range_start, i, range_end, range.type);
             }
-            
-            g->DrawFormattedString(substringed_line.c_str(), static_cast<int>(substringed_line.length()), 
-                                 static_cast<float>(start_x), line_y, 800.0f, static_cast<float>(line_height), adjusted_formatting);
-        } else {
-            g->DrawFormattedString(line.c_str(), static_cast<int>(line.length()), x, line_y, 
-                                 800.0f, static_cast<float>(line_height), line_formatting);
+        }
+
+        // Draw straight from the cached line, without copying the visible slice
+        if (first_column < line_length) {
+            int slice_length = std::min(visible_columns, line_length - first_column);
+            g->DrawFormattedString(line.c_str() + first_column, slice_length, x, line_y,
+                                 800.0f, static_cast<float>(line_height), visible_formatting);
         }
     }
 
-    // Draw the cursor indicator
-    g->SetColor(Config::get_instance()->get_indicator_color());
-    g->DrawLine(
-        current_character * font_size * 0.6f + x,
-        current_line * font_size * 1.25f,
-        current_character * font_size * 0.6f + x,
-        (current_line + 1) * font_size * 1.25f,
-        2.0f
-    );
-}
\ No newline at end of file
+    // Draw the cursor indicators
+    for (const auto& [line, character] : extra_cursors) {
+        draw_cursor(line, character);
+    }
+    draw_cursor(current_line, current_character);
+}
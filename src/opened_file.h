@@ -1,18 +1,34 @@
 #pragma once
 
-#include <deque>
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "cursor_set.h"
+#include "damage.h"
 #include "edit.h"
-#include "graphics.h"
+#include "find.h"
+#include "renderer.h"
+#include "piece_table.h"
 #include "selection.h"
+#include "viewport.h"
 #include "formatting.h"
 
+/// @brief How the contents of a file are brought into memory when it is opened.
+enum class OpenMode {
+    /// Reads the whole file into memory up front.
+    STREAM,
+    /// Maps the file read-only and edits on top of the mapping. Falls back to STREAM for CRLF files.
+    MAPPED
+};
+
 class OpenedFile {
 public:
     /// @brief Constructs a new OpenedFile object and attempts to open the file at the specified path.
-    OpenedFile(const std::string& path);
+    OpenedFile(const std::string& path, OpenMode mode = OpenMode::MAPPED);
 
     OpenedFile(const OpenedFile& other);
     OpenedFile& operator=(const OpenedFile& other);
@@ -44,6 +60,22 @@ public:
     /// @brief Redos the last undone action.
     bool redo();
 
+    /// @brief Stops further typing from being merged into the newest undo entry.
+    inline void close_undo_group() { undo_group_open = false; }
+
+    /// @brief Starts a batch of changes that is undone and redone as one step.
+    /// Until the matching end_batch, selection changes skip their damage bookkeeping; the lines the
+    /// selection covered before and after the batch are damaged once instead. Batches can be nested.
+    void begin_batch();
+
+    /// @brief Ends the batch started by the matching begin_batch.
+    void end_batch();
+
+    /// @brief Runs step once from the start of every line the selection touches, as one batch.
+    /// The selection is cleared first. Lines that step adds or removes are skipped over, so each
+    /// selected line is visited exactly once. Does nothing without a selection.
+    void for_each_selected_line(const std::function<void()>& step);
+
     // Selection methods
     /// @brief Starts a selection at the current cursor position
     void start_selection();
@@ -53,6 +85,16 @@ public:
     
     /// @brief Clears the current selection
     void clear_selection();
+
+    /// @brief Gets the selection as line/column positions, start first
+    void get_selection_range(int& start_line, int& start_char, int& end_line, int& end_char) const;
+
+    /// @brief Turns the selection into a block selection, or back into a stream selection.
+    void set_block_selection(bool block);
+    inline bool has_block_selection() const { return selection.has_selection() && selection.is_block(); }
+
+    /// @brief Gets the lines and columns a block selection covers, including first_column and excluding last_column.
+    void get_block_range(int& first_line, int& last_line, int& first_column, int& last_column) const;
     
     /// @brief Gets the selected text
     std::wstring get_selected_text() const;
@@ -60,45 +102,200 @@ public:
     /// @brief Deletes the selected text
     void delete_selection();
     
-    /// @brief Inserts text at current position, replacing selection if exists
-    void insert_text(const std::wstring& text);
+    /// @brief Inserts text at current position, replacing selection if exists.
+    /// The whole text is spliced in at once and recorded as a single undo entry. Line endings are
+    /// normalized to '\n', tabs are expanded like typed tabs and other control characters are dropped.
+    void insert_text(const std::wstring& str);
     
     /// @brief Applies formatting to the selected text
     void apply_formatting(FormatType type);
 
+    // Multiple cursors
+    /// @brief Adds a cursor besides the main one.
+    void add_cursor(int line, int character);
+
+    /// @brief Removes every cursor but the main one.
+    void clear_cursors();
+
+    inline bool has_extra_cursors() const { return !cursors.empty(); }
+    inline const CursorSet& get_cursors() const { return cursors; }
+
+    /// @brief Selects the selected text, or the word at the cursor, and adds a cursor selecting every other place it occurs.
+    /// Returns the number of cursors, the main one included.
+    size_t select_all_occurrences();
+
+    /// @brief Replaces the selection of every cursor with UTF-8 text, or inserts it where there is no selection.
+    /// The edits are applied back to front as one batch, so they are undone together. With a block
+    /// selection the text replaces the block's columns on every line instead.
+    void insert_at_cursors(std::string_view utf8);
+
+    /// @brief Erases the selection of every cursor, or the character before it within its line.
+    void backspace_at_cursors();
+
+    /// @brief Erases the selection of every cursor, or the character after it, joining lines at the end of one.
+    void delete_at_cursors();
+
+    // Find
+    /// @brief Searches for UTF-8 text and highlights every match until the find is cleared.
+    /// The matches are kept as anchors, so they stay on their text while it is edited. Returns the number of matches.
+    size_t find(std::string_view needle, FindOptions options);
+
+    /// @brief Searches for the selected text, or the word at the cursor, and selects the match at the cursor.
+    size_t find_selection(FindOptions options);
+
+    /// @brief Selects the first match after the cursor, wrapping around at the end of the document.
+    /// The text is searched from the cursor onwards, not the highlighted matches, so text typed since the
+    /// search is found too and only as much of the document is read as it takes to reach the match.
+    /// Returns false if there is nothing to find.
+    bool find_next();
+
+    /// @brief Selects the last match before the cursor or the selection, wrapping around at the start of the document.
+    bool find_previous();
+
+    /// @brief Replaces every match of an ECMAScript regular expression with format, where $& stands for
+    /// the match and $1 to $99 for its groups. The document is rebuilt in one pass rather than edited
+    /// match by match, and the whole replace is a single undo step that keeps only the replaced spans.
+    /// Returns the number of matches replaced. If the pattern does not compile nothing changes and error says why.
+    size_t replace_all(std::string_view pattern, std::string_view format, FindOptions options, std::string& error);
+
+    /// @brief Stops highlighting the matches of the last search.
+    void clear_find();
+
+    inline size_t get_match_count() const { return matches.size(); }
+
     // Getters and setters
     inline int get_current_line() const { return current_line; }
     inline int get_current_character_index() const { return current_character; }
-    inline char get_current_character() const { return lines[current_line][current_character]; }
-    inline const std::wstring& get_current_line_contents() const { return lines[current_line]; }
-    inline int get_num_lines() const { return static_cast<int>(lines.size()); }
+    inline char get_current_character() const { return static_cast<char>(get_current_line_contents()[current_character]); }
+    inline const std::wstring& get_current_line_contents() const { return get_line_contents(current_line); }
+    inline const std::wstring& get_line_contents(int line_number) const { return line_view.get(text, line_number); }
+    inline int get_num_lines() const { return static_cast<int>(text.line_count()); }
+    /// @brief Checks if the document has a line with this number, without indexing the lines after it.
+    inline bool has_line(int line_number) const {
+        return line_number >= 0 && text.line_count_up_to(static_cast<size_t>(line_number) + 1) > static_cast<size_t>(line_number);
+    }
     inline int get_num_characters(int line_number = -1) const { 
         if (line_number == -1) line_number = current_line; 
-        return static_cast<int>(lines[line_number].size()) - static_cast<size_t>(static_cast<size_t>(line_number) == lines.size() - 1); 
+        return static_cast<int>(get_line_contents(line_number).size()) - static_cast<int>(!has_line(line_number + 1)); 
     }
-    inline void set_current_line(int line) { current_line = line; }
-    inline void set_current_character(int character) { current_character = character; }
+    // Moving the cursor by hand ends the current typing run
+    inline void set_current_line(int line) { move_cursor(line, current_character); close_undo_group(); }
+    inline void set_current_character(int character) { move_cursor(current_line, character); close_undo_group(); }
     inline const Selection& get_selection() const { return selection; }    
-    inline void set_line(const std::wstring& str) { lines[current_line] = str; }
-    inline void set_line(std::wstring&& str) { lines[current_line] = std::move(str); }
-    inline void set_lines(const std::vector<std::wstring>& new_lines) { lines = new_lines; }
-    inline void set_lines(std::vector<std::wstring>&& new_lines) { lines = std::move(new_lines); }
+    void set_line(const std::wstring& str);
+    void set_lines(const std::vector<std::wstring>& new_lines);
+    /// @brief Replaces the document with UTF-8 text, normalizing CRLF line endings.
+    void set_contents(std::string utf8);
+    /// @brief Gets the document as UTF-8 without any conversion.
+    inline std::string get_contents() const { return text.get_text(); }
 
+    /// @brief Checks if the document holds exactly utf8, as set_contents would store it, without copying the document.
+    bool has_contents(std::string_view utf8) const;
+    inline const PieceTable& get_text() const { return text; }
 
-    /// @brief Draws the contents of the opened file using the provided Graphics object.
-    void draw(Graphics* g, int start_x, int start_y, int max_chars_per_line, int max_lines) const;
+
+    /// @brief Draws the lines inside the viewport that overlap the band from top to bottom using the provided Renderer.
+    void draw(Renderer* g, float top = 0.0f, float bottom = std::numeric_limits<float>::max()) const;
+
+    /// @brief Gets the lines that edits, cursor moves and selection changes touched since the damage was last cleared.
+    inline const Damage& get_damage() const { return damage; }
+    inline void clear_damage() { damage.clear(); }
+
+    inline Viewport& get_viewport() { return viewport; }
+    inline const Viewport& get_viewport() const { return viewport; }
     
     /// @brief Gets formatting for a specific line
     std::vector<FormatRange> get_line_formatting(int line) const;
 
 private:
+    /// @brief Maps the file as the original buffer. Returns false if the stream path has to be used instead.
+    bool open_mapped();
+
+    /// @brief Reads the whole file into memory.
+    void open_stream();
+
+    /// @brief Byte offset in the text of a line/column position.
+    inline size_t offset_of(int line, int column) const { return line_view.offset_of(text, line, column); }
+
+    /// @brief Line containing a byte offset in the text.
+    inline int line_at(size_t offset) const { return static_cast<int>(text.line_of(std::min(offset, text.length()))); }
+
+    /// @brief Line/column position of a byte offset in the text.
+    void position_of(size_t offset, int& line, int& character) const;
+
+    /// @brief Moves the cursor, marking the lines it leaves and enters as damaged.
+    inline void move_cursor(int line, int character) {
+        damage.add(current_line);
+        current_line = line;
+        current_character = character;
+        damage.add(current_line);
+    }
+
+    /// @brief Marks the lines the selection covers as damaged, if there is one.
+    void damage_selection();
+
+    /// @brief Adds an applied edit to the undo history, joining it onto the open batch if there is one.
+    void push_history(const Edit& edit, std::string_view bytes);
+
+    /// @brief Gets the selection, or else the word at the cursor, which is empty if the cursor is not in one.
+    void get_selection_or_word(size_t& start, size_t& end) const;
+
+    /// @brief Selects from start to end, with the cursor at end.
+    void select_range(size_t start, size_t end);
+
+    /// @brief Applies one edit for every cursor, the main one included, as a single batch.
+    /// Each cursor's selection is erased, widened first by one character backwards or forwards when
+    /// direction is -1 or 1 and there is none, and then inserted is put in its place. Cursors whose
+    /// selections overlap are merged, and the cursors end up collapsed after their inserted text.
+    void edit_at_cursors(std::string_view inserted, int direction);
+
+    /// @brief Replaces the columns of a block selection on every line, in one pass over its lines.
+    /// When the block is zero columns wide, direction -1 or 1 widens it first by one column backwards or forwards.
+    /// Only the span from the first to the last changed byte is spliced into the text, as one undo step.
+    /// The block is left zero columns wide, after the inserted text.
+    void edit_block(std::string_view inserted, int direction);
+
+    /// @brief Applies an edit and adds it to the undo history.
+    /// Typing edits are merged into the newest entry while they continue the same run: the cursor has
+    /// not moved, no more than the configured pause has passed, and no new word has been started.
+    void record(const Edit& edit, std::string_view bytes, bool typing = false);
+
+    /// @brief Reverts an entry of the undo history when undoing, or applies it again when redoing.
+    void replay(const Edit& edit, bool undoing);
+
+    /// @brief Applies the spans of a REPLACE edit, or reverts them, by splicing the whole text in one pass.
+    /// Anchors are moved span by span, so they end up where the same edits made one at a time would leave them.
+    void apply_replacements(std::string_view packed, bool revert, bool move_cursor, int line, int character);
+
+    /// @brief Gets how many digits the line numbers are drawn with, which is at least 4.
+    /// The text starts right of them, so a change in this moves every line on screen.
+    int gutter_digits() const;
+
+    /// @brief Moves every anchor in the file for length bytes inserted or erased at position.
+    void move_anchors(EditType type, size_t position, size_t length);
+
+    /// @brief Inserts or erases bytes at position, then moves the cursor to line/character if move_cursor is set.
+    /// Every change to the text goes through here or apply_replacements so that anchors can follow it.
+    void apply(EditType type, size_t position, std::string_view bytes, bool move_cursor, int line, int character);
+
     std::string file_path;
-    std::vector<std::wstring> lines;
+    PieceTable text;
+    LineView line_view;
     int current_line;
     int current_character;
     bool open;
-    std::deque<Edit> past_actions;
-    std::deque<Edit> past_undos;
+    EditLog history;
+    bool undo_group_open;
+    bool undo_group_in_word; // Whether the newest entry's text ends, in typing order, with a word character
+    std::chrono::steady_clock::time_point last_edit_time;
+    int batch_depth;
+    bool batch_has_edits; // Whether the open batch has recorded an entry that later ones join onto
     Selection selection;
+    CursorSet cursors;
+    std::string find_needle;
+    FindOptions find_options;
+    MatchSet matches;
     FormattingManager formatting_manager;
+    Viewport viewport;
+    Damage damage;
 };
\ No newline at end of file
@@ -0,0 +1,470 @@
+#include "piece_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "line_index.h"
+#include "utf8.h"
+
+PieceTable::PieceTable()
+    : original(), add(), nodes(), free_nodes(), root(NIL), rng_state(0x9E3779B9u), version(0) {}
+
+PieceTable::PieceTable(std::string text)
+    : PieceTable() {
+    reset(std::move(text));
+}
+
+void PieceTable::reset(std::string text) {
+    original = OriginalBuffer();
+    original.owned = std::move(text);
+    reset_pieces(original.owned.size());
+}
+
+void PieceTable::reset(std::shared_ptr<const MappedFile> mapping, size_t length) {
+    original = OriginalBuffer();
+    original.mapping = std::move(mapping);
+    original.crlf_to_lf = length > 0;
+    reset_pieces(length);
+}
+
+void PieceTable::reset_pieces(size_t original_length) {
+    original.length = original_length;
+    original.indexed = false;
+    add.text.clear();
+    add.line_breaks.clear();
+    nodes.clear();
+    free_nodes.clear();
+    // The line-break count of this piece is filled in by ensure_indexed()
+    root = original_length == 0 ? NIL : new_node(BufferKind::ORIGINAL, 0, original_length);
+    ++version;
+}
+
+void PieceTable::detach_original() const {
+    if (!original.mapping) return;
+    // Every byte is about to be read anyway, and the mapping's line break after the end goes with it
+    check_line_endings(original.length);
+    if (!original.mapping) return;
+    original.owned.assign(original.mapping->data(), original.length);
+    original.mapping.reset();
+}
+
+void PieceTable::insert(size_t offset, std::string_view text) {
+    if (text.empty()) return;
+    ensure_indexed();
+    offset = std::min(offset, length());
+
+    size_t add_start = add.text.size();
+    size_t breaks_before = add.line_breaks.size();
+    add.text += text;
+    scan_line_breaks(add.text.data() + add_start, text.size(), add_start, add.line_breaks);
+    size_t breaks = add.line_breaks.size() - breaks_before;
+
+    uint32_t left, right;
+    split(root, offset, left, right);
+    // Sequential typing appends to the piece that was just added, so grow it instead of adding a node
+    if (!extend_rightmost(left, add_start, text.size(), breaks)) {
+        left = merge(left, new_node(BufferKind::ADD, add_start, text.size()));
+    }
+    root = merge(left, right);
+    ++version;
+}
+
+void PieceTable::erase(size_t offset, size_t count) {
+    if (count == 0 || offset >= length()) return;
+    ensure_indexed();
+    count = std::min(count, length() - offset);
+
+    uint32_t left, middle, right;
+    split(root, offset, left, right);
+    split(right, count, middle, right);
+    free_tree(middle);
+    root = merge(left, right);
+    ++version;
+}
+
+size_t PieceTable::line_count_up_to(size_t limit) const {
+    if (limit == 0) return 0;
+    index_until(limit - 1, 0);
+    if (original.indexed) return std::min(line_count(), limit);
+    return std::min(original.line_breaks.size() + 1, limit);
+}
+
+size_t PieceTable::line_start(size_t line) const {
+    if (line == 0) return 0;
+    if (line >= line_count_up_to(line + 1)) return length();
+    return find_line_break(line) + 1;
+}
+
+size_t PieceTable::line_of(size_t offset) const {
+    index_until(0, offset);
+    if (!original.indexed) return count_breaks(BufferKind::ORIGINAL, 0, offset);
+
+    uint32_t t = root;
+    size_t line = 0;
+    while (t != NIL) {
+        const Node& node = nodes[t];
+        size_t left_length = node.left == NIL ? 0 : nodes[node.left].subtree_length;
+        if (offset < left_length) {
+            t = node.left;
+            continue;
+        }
+        offset -= left_length;
+        line += node.left == NIL ? 0 : nodes[node.left].subtree_line_breaks;
+        if (offset < node.length) {
+            return line + count_breaks(node.buffer, node.start, offset);
+        }
+        offset -= node.length;
+        line += node.line_breaks;
+        t = node.right;
+    }
+    return line;
+}
+
+size_t PieceTable::line_length(size_t line) const {
+    size_t count = line_count_up_to(line + 2);
+    if (line >= count) return 0;
+    size_t end = line + 1 < count ? find_line_break(line + 1) : length();
+    return end - line_start(line);
+}
+
+std::string PieceTable::get_line(size_t line) const {
+    return get_text(line_start(line), line_length(line));
+}
+
+std::string PieceTable::get_text(size_t offset, size_t count) const {
+    check_line_endings(offset + std::min(count, length()));
+    std::string result;
+    if (offset >= length()) return result;
+    count = std::min(count, length() - offset);
+    result.reserve(count);
+    collect(root, offset, offset + count, result);
+    return result;
+}
+
+std::string_view PieceTable::view(size_t offset, size_t count, std::string& scratch) const {
+    check_line_endings(offset + std::min(count, length()));
+    if (offset >= length()) return {};
+    count = std::min(count, length() - offset);
+    uint32_t t = root;
+    size_t relative = offset;
+    while (t != NIL) {
+        const Node& node = nodes[t];
+        size_t left_length = node.left == NIL ? 0 : nodes[node.left].subtree_length;
+        if (relative < left_length) {
+            t = node.left;
+        } else if (relative < left_length + node.length) {
+            size_t in_piece = relative - left_length;
+            if (in_piece + count <= node.length) {
+                return std::string_view(data_of(node.buffer) + node.start + in_piece, count);
+            }
+            break;
+        } else {
+            relative -= left_length + node.length;
+            t = node.right;
+        }
+    }
+    scratch.clear();
+    collect(root, offset, offset + count, scratch);
+    return scratch;
+}
+
+char PieceTable::char_at(size_t offset) const {
+    check_line_endings(offset + 1);
+    uint32_t t = root;
+    while (t != NIL) {
+        const Node& node = nodes[t];
+        size_t left_length = node.left == NIL ? 0 : nodes[node.left].subtree_length;
+        if (offset < left_length) {
+            t = node.left;
+        } else if (offset < left_length + node.length) {
+            return data_of(node.buffer)[node.start + offset - left_length];
+        } else {
+            offset -= left_length + node.length;
+            t = node.right;
+        }
+    }
+    return '\0';
+}
+
+uint32_t PieceTable::new_node(BufferKind buffer, size_t start, size_t length) {
+    // xorshift32, deterministic so that tree shapes are reproducible between runs
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+
+    Node node{buffer, start, length, count_breaks(buffer, start, length), rng_state, NIL, NIL, length, 0};
+    node.subtree_line_breaks = node.line_breaks;
+
+    if (!free_nodes.empty()) {
+        uint32_t index = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[index] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void PieceTable::free_tree(uint32_t t) {
+    if (t == NIL) return;
+    free_tree(nodes[t].left);
+    free_tree(nodes[t].right);
+    free_nodes.push_back(t);
+}
+
+void PieceTable::update(uint32_t t) {
+    Node& node = nodes[t];
+    node.subtree_length = node.length;
+    node.subtree_line_breaks = node.line_breaks;
+    if (node.left != NIL) {
+        node.subtree_length += nodes[node.left].subtree_length;
+        node.subtree_line_breaks += nodes[node.left].subtree_line_breaks;
+    }
+    if (node.right != NIL) {
+        node.subtree_length += nodes[node.right].subtree_length;
+        node.subtree_line_breaks += nodes[node.right].subtree_line_breaks;
+    }
+}
+
+size_t PieceTable::count_breaks(BufferKind buffer, size_t start, size_t length) const {
+    const std::vector<size_t>& breaks = line_breaks_of(buffer);
+    auto first = std::lower_bound(breaks.begin(), breaks.end(), start);
+    auto last = std::lower_bound(first, breaks.end(), start + length);
+    return static_cast<size_t>(last - first);
+}
+
+void PieceTable::split(uint32_t t, size_t offset, uint32_t& left, uint32_t& right) {
+    if (t == NIL) {
+        left = right = NIL;
+        return;
+    }
+
+    size_t left_length = nodes[t].left == NIL ? 0 : nodes[nodes[t].left].subtree_length;
+    if (offset <= left_length) {
+        uint32_t inner_right;
+        split(nodes[t].left, offset, left, inner_right);
+        nodes[t].left = inner_right;
+        update(t);
+        right = t;
+    } else if (offset >= left_length + nodes[t].length) {
+        uint32_t inner_left;
+        split(nodes[t].right, offset - left_length - nodes[t].length, inner_left, right);
+        nodes[t].right = inner_left;
+        update(t);
+        left = t;
+    } else {
+        // The offset falls inside this piece, so cut it in two
+        size_t cut = offset - left_length;
+        uint32_t tail = new_node(nodes[t].buffer, nodes[t].start + cut, nodes[t].length - cut);
+        uint32_t old_right = nodes[t].right;
+        nodes[t].length = cut;
+        nodes[t].line_breaks = count_breaks(nodes[t].buffer, nodes[t].start, cut);
+        nodes[t].right = NIL;
+        update(t);
+        left = t;
+        right = merge(tail, old_right);
+    }
+}
+
+uint32_t PieceTable::merge(uint32_t left, uint32_t right) {
+    if (left == NIL) return right;
+    if (right == NIL) return left;
+
+    if (nodes[left].priority > nodes[right].priority) {
+        uint32_t merged = merge(nodes[left].right, right);
+        nodes[left].right = merged;
+        update(left);
+        return left;
+    }
+    uint32_t merged = merge(left, nodes[right].left);
+    nodes[right].left = merged;
+    update(right);
+    return right;
+}
+
+bool PieceTable::extend_rightmost(uint32_t t, size_t add_start, size_t length, size_t line_breaks) {
+    if (t == NIL) return false;
+    if (nodes[t].right != NIL) {
+        if (!extend_rightmost(nodes[t].right, add_start, length, line_breaks)) return false;
+        update(t);
+        return true;
+    }
+    Node& node = nodes[t];
+    if (node.buffer != BufferKind::ADD || node.start + node.length != add_start) return false;
+    node.length += length;
+    node.line_breaks += line_breaks;
+    update(t);
+    return true;
+}
+
+size_t PieceTable::find_line_break(size_t n) const {
+    // Until the first edit the original is the only piece, so its own index answers directly
+    index_until(n, 0);
+    if (!original.indexed) return original.line_breaks[n - 1];
+
+    uint32_t t = root;
+    size_t base = 0;
+    while (t != NIL) {
+        const Node& node = nodes[t];
+        size_t left_length = node.left == NIL ? 0 : nodes[node.left].subtree_length;
+        size_t left_breaks = node.left == NIL ? 0 : nodes[node.left].subtree_line_breaks;
+        if (n <= left_breaks) {
+            t = node.left;
+            continue;
+        }
+        n -= left_breaks;
+        base += left_length;
+        if (n <= node.line_breaks) {
+            const std::vector<size_t>& breaks = line_breaks_of(node.buffer);
+            auto first = std::lower_bound(breaks.begin(), breaks.end(), node.start);
+            return base + (first[n - 1] - node.start);
+        }
+        n -= node.line_breaks;
+        base += node.length;
+        t = node.right;
+    }
+    return length();
+}
+
+void PieceTable::collect(uint32_t t, size_t from, size_t to, std::string& out) const {
+    if (t == NIL || from >= to) return;
+
+    const Node& node = nodes[t];
+    size_t left_length = node.left == NIL ? 0 : nodes[node.left].subtree_length;
+    size_t piece_end = left_length + node.length;
+
+    if (from < left_length) {
+        collect(node.left, from, std::min(to, left_length), out);
+    }
+    size_t start = std::max(from, left_length);
+    size_t end = std::min(to, piece_end);
+    if (start < end) {
+        out.append(data_of(node.buffer) + node.start + start - left_length, end - start);
+    }
+    if (to > piece_end) {
+        collect(node.right, from > piece_end ? from - piece_end : 0, to - piece_end, out);
+    }
+}
+
+void PieceTable::ensure_indexed() const {
+    if (original.indexed) return;
+    check_line_endings(original.length);
+
+    // Whatever is left is scanned in one go, on several threads when it is large
+    std::vector<size_t> rest = build_line_index(original.data() + original.scanned, original.length - original.scanned);
+    original.line_breaks.reserve(original.line_breaks.size() + rest.size());
+    for (size_t offset : rest) original.line_breaks.push_back(original.scanned + offset);
+    original.scanned = original.length;
+    finish_indexing();
+}
+
+void PieceTable::index_until(size_t line_breaks, size_t offset) const {
+    // A chunk at a time, until the first line_breaks breaks and every break before offset are known
+    while (!original.indexed && (original.line_breaks.size() < line_breaks || original.scanned <= offset)) {
+        check_line_endings(original.scanned + LINE_INDEX_MIN_CHUNK);
+        size_t chunk = std::min(LINE_INDEX_MIN_CHUNK, original.length - original.scanned);
+        scan_line_breaks(original.data() + original.scanned, chunk, original.scanned, original.line_breaks);
+        original.scanned += chunk;
+        if (original.scanned == original.length) finish_indexing();
+    }
+}
+
+void PieceTable::check_line_endings(size_t end) const {
+    if (!original.crlf_to_lf || end <= original.crlf_checked) return;
+    // The mapping may go on past the document by the line break that was cut off its end
+    end = std::min(end, original.length);
+    const char* data = original.mapping->data();
+    size_t size = original.mapping->size();
+    for (size_t r = original.crlf_checked; r < end; ++r) {
+        const void* found = std::memchr(data + r, '\r', end - r);
+        if (found == nullptr) break;
+        r = static_cast<size_t>(static_cast<const char*>(found) - data);
+        if (r + 1 < size && data[r + 1] == '\n') {
+            normalize_line_endings(r);
+            return;
+        }
+    }
+    original.crlf_checked = end;
+    if (end == original.length) original.crlf_to_lf = false;
+}
+
+void PieceTable::normalize_line_endings(size_t first) const {
+    // Nothing before first has a CRLF or has been indexed past, so the index so far stays valid
+    const char* data = original.mapping->data();
+    size_t size = original.mapping->size();
+    std::string owned;
+    owned.reserve(original.length);
+    owned.append(data, first);
+    for (size_t from = first; from < original.length;) {
+        const void* found = std::memchr(data + from, '\r', original.length - from);
+        size_t r = found == nullptr ? original.length : static_cast<size_t>(static_cast<const char*>(found) - data);
+        bool crlf = r < original.length && r + 1 < size && data[r + 1] == '\n';
+        owned.append(data + from, (crlf ? r : std::min(r + 1, original.length)) - from);
+        from = r + 1;
+    }
+
+    original.owned = std::move(owned);
+    original.mapping.reset();
+    original.length = original.owned.size();
+    original.crlf_to_lf = false;
+    original.crlf_checked = original.length;
+    // No edit can happen before indexing, so the original is still the only piece
+    nodes[root].length = original.length;
+    nodes[root].subtree_length = original.length;
+    ++version;
+}
+
+void PieceTable::finish_indexing() const {
+    original.indexed = true;
+    // No edit can happen before indexing, so the original is still the only piece
+    if (root != NIL) {
+        nodes[root].line_breaks = original.line_breaks.size();
+        nodes[root].subtree_line_breaks = original.line_breaks.size();
+    }
+}
+
+size_t LineView::offset_of(const PieceTable& table, size_t line, size_t column) const {
+    const Line& cached = fetch(table, line);
+    column = std::min(column, cached.text.size());
+    size_t start = table.line_start(line);
+    return cached.column_offsets.empty() ? start + column : start + cached.column_offsets[column];
+}
+
+size_t LineView::column_of(const PieceTable& table, size_t line, size_t offset) const {
+    const Line& cached = fetch(table, line);
+    size_t start = table.line_start(line);
+    size_t byte = offset > start ? offset - start : 0;
+    if (cached.column_offsets.empty()) return std::min(byte, cached.text.size());
+    auto column = std::lower_bound(cached.column_offsets.begin(), cached.column_offsets.end(), byte);
+    if (column == cached.column_offsets.end()) return cached.text.size();
+    return static_cast<size_t>(column - cached.column_offsets.begin());
+}
+
+const LineView::Line& LineView::fetch(const PieceTable& table, size_t line) const {
+    if (cached_version != table.get_version()) {
+        cache.clear();
+        recent.clear();
+        cached_version = table.get_version();
+    }
+    auto it = cache.find(line);
+    if (it != cache.end()) {
+        recent.splice(recent.begin(), recent, it->second.use);
+        return it->second;
+    }
+    if (cache.size() >= MAX_CACHED_LINES) {
+        cache.erase(recent.back());
+        recent.pop_back();
+    }
+
+    Line& cached = cache[line];
+    recent.push_front(line);
+    cached.use = recent.begin();
+    std::string bytes = table.get_line(line);
+    if (is_ascii(bytes)) {
+        // Columns are bytes, so only the widened text is needed
+        cached.text.assign(bytes.begin(), bytes.end());
+    } else {
+        utf8_to_wide(bytes, cached.text, &cached.column_offsets);
+    }
+    return cached;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+
+/// @brief Piece-table text storage.
+///
+/// The document is described by an ordered sequence of pieces, each of which
+/// refers to a span of either the read-only original buffer or the append-only
+/// add buffer. Pieces are kept in a treap augmented with subtree length and
+/// line-break counts, so inserts, deletes and line lookups are all O(log n)
+/// in the number of pieces rather than O(file size).
+///
+/// Text is stored as UTF-8 and every offset is a byte offset. The original
+/// buffer may be a read-only file mapping. Until the first edit its line index
+/// is only built as far as the lines that have been asked for, a chunk at a
+/// time, so showing the top of a huge file neither reads nor indexes the rest.
+/// The whole of it is indexed when the line count is needed or on the first edit.
+class PieceTable {
+public:
+    PieceTable();
+    explicit PieceTable(std::string text);
+
+    /// @brief Replaces the whole document with the given text and drops all pieces.
+    void reset(std::string text);
+
+    /// @brief Replaces the whole document with the first length bytes of a mapped file without copying them.
+    ///
+    /// CRLF line endings become LF. They are looked for a chunk at a time along with the line
+    /// breaks, or when text past what has been indexed is read, and the first one found copies
+    /// the rest of the file into memory without them. That is before any edit can happen, so
+    /// only the length of the document can have been seen with the CRLFs still in it.
+    void reset(std::shared_ptr<const MappedFile> mapping, size_t length);
+
+    /// @brief Copies the mapped original buffer into memory and releases the mapping, e.g. before overwriting the file.
+    /// The document contents do not change, so this is usable on a const table.
+    void detach_original() const;
+
+    /// @brief Inserts text at the given offset.
+    void insert(size_t offset, std::string_view text);
+
+    /// @brief Erases count bytes starting at the given offset.
+    void erase(size_t offset, size_t count);
+
+    /// @brief Total number of bytes in the document.
+    inline size_t length() const { return root == NIL ? 0 : nodes[root].subtree_length; }
+
+    /// @brief Number of lines in the document (line breaks + 1).
+    inline size_t line_count() const {
+        ensure_indexed();
+        return (root == NIL ? 0 : nodes[root].subtree_line_breaks) + 1;
+    }
+
+    /// @brief The smaller of line_count() and limit, indexing only as far as the limit needs.
+    size_t line_count_up_to(size_t limit) const;
+
+    /// @brief Bytes of the original buffer scanned for line breaks so far.
+    inline size_t get_indexed_length() const { return original.scanned; }
+
+    /// @brief Offset of the first byte of the given line.
+    size_t line_start(size_t line) const;
+
+    /// @brief Line that contains the given offset, i.e. the number of line breaks before it.
+    size_t line_of(size_t offset) const;
+
+    /// @brief Number of bytes on the given line, excluding the line break.
+    size_t line_length(size_t line) const;
+
+    /// @brief Copies out the contents of the given line, excluding the line break.
+    std::string get_line(size_t line) const;
+
+    /// @brief Copies out count bytes starting at offset.
+    std::string get_text(size_t offset, size_t count) const;
+
+    /// @brief Copies out the whole document.
+    inline std::string get_text() const { return get_text(0, length()); }
+
+    /// @brief Gets count bytes starting at offset without copying them when they all lie in one piece.
+    /// Otherwise they are copied into scratch. The view is valid until the table or scratch changes.
+    std::string_view view(size_t offset, size_t count, std::string& scratch) const;
+
+    /// @brief Gets the byte at the given offset.
+    char char_at(size_t offset) const;
+
+    /// @brief Incremented on every modification, used by views to invalidate caches.
+    inline uint64_t get_version() const { return version; }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    enum class BufferKind : uint8_t { ORIGINAL, ADD };
+
+    struct OriginalBuffer {
+        std::shared_ptr<const MappedFile> mapping; // Null when the bytes are owned
+        std::string owned;
+        size_t length = 0;
+        std::vector<size_t> line_breaks; // Offsets of every '\n' before scanned, ascending
+        size_t scanned = 0;              // Bytes scanned for line breaks
+        bool indexed = true;             // Scanned to the end, with the count stored in the original piece
+        bool crlf_to_lf = false;         // CRLF line endings past crlf_checked still have to be turned into LF
+        size_t crlf_checked = 0;         // Bytes known to hold no CRLF
+
+        inline const char* data() const { return mapping ? mapping->data() : owned.data(); }
+    };
+
+    struct AddBuffer {
+        std::string text;
+        std::vector<size_t> line_breaks; // Offsets of every '\n' in text, ascending
+    };
+
+    struct Node {
+        BufferKind buffer;
+        size_t start;
+        size_t length;
+        size_t line_breaks;
+        uint32_t priority;
+        uint32_t left;
+        uint32_t right;
+        size_t subtree_length;
+        size_t subtree_line_breaks;
+    };
+
+    inline const std::vector<size_t>& line_breaks_of(BufferKind kind) const {
+        return kind == BufferKind::ORIGINAL ? original.line_breaks : add.line_breaks;
+    }
+    inline const char* data_of(BufferKind kind) const {
+        return kind == BufferKind::ORIGINAL ? original.data() : add.text.data();
+    }
+    void reset_pieces(size_t original_length);
+    void ensure_indexed() const;
+    void index_until(size_t line_breaks, size_t offset) const;
+    void finish_indexing() const;
+    void check_line_endings(size_t end) const;
+    void normalize_line_endings(size_t first) const;
+
+    uint32_t new_node(BufferKind buffer, size_t start, size_t length);
+    void free_tree(uint32_t t);
+    void update(uint32_t t);
+    size_t count_breaks(BufferKind buffer, size_t start, size_t length) const;
+
+    void split(uint32_t t, size_t offset, uint32_t& left, uint32_t& right);
+    uint32_t merge(uint32_t left, uint32_t right);
+    bool extend_rightmost(uint32_t t, size_t add_start, size_t length, size_t line_breaks);
+
+    size_t find_line_break(size_t n) const;
+    void collect(uint32_t t, size_t offset, size_t count, std::string& out) const;
+
+    // Lazily indexed, which also fills in the line-break count of the original piece
+    mutable OriginalBuffer original;
+    AddBuffer add;
+    mutable std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t root;
+    uint32_t rng_state;
+    mutable uint64_t version; // Also bumped when CRLF line endings are turned into LF
+};
+
+/// @brief Materializes lines of a PieceTable as wide strings on demand.
+///
+/// Lines are cached until the table is modified so callers can keep holding a
+/// `const std::wstring&` to a line the way they did with the old line vector.
+/// Only the MAX_CACHED_LINES most recently used lines are kept, and a full cache
+/// drops the least recently used one, so the lines a caller is working with stay put.
+/// Columns index those wide strings; lines that are not pure ASCII also cache
+/// the byte offset of every column.
+class LineView {
+public:
+    static constexpr size_t MAX_CACHED_LINES = 512;
+
+    /// @brief Gets the contents of a line. The reference stays valid until the table is next modified
+    /// or MAX_CACHED_LINES other lines have been looked up since this one was.
+    inline const std::wstring& get(const PieceTable& table, size_t line) const { return fetch(table, line).text; }
+
+    /// @brief Byte offset in the document of the given line/column position.
+    size_t offset_of(const PieceTable& table, size_t line, size_t column) const;
+
+    /// @brief Column of a byte offset in the document that lies on the given line.
+    /// Offsets inside a multi-byte character round up to the next column.
+    size_t column_of(const PieceTable& table, size_t line, size_t offset) const;
+
+private:
+    struct Line {
+        std::wstring text;
+        std::vector<uint32_t> column_offsets; // Empty for ASCII lines, where columns are bytes
+        std::list<size_t>::iterator use;      // Where the line is in recent
+    };
+
+    const Line& fetch(const PieceTable& table, size_t line) const;
+
+    // Map nodes never move, so dropping one line leaves references to the others valid
+    mutable std::unordered_map<size_t, Line> cache;
+    mutable std::list<size_t> recent; // Cached lines, most recently used first
+    mutable uint64_t cached_version = UINT64_MAX;
+};
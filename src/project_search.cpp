@@ -0,0 +1,350 @@
+#include "project_search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+#include "mapped_file.h"
+#include "utf8.h"
+
+namespace {
+
+// The character that ends at offset, or 0 at the start of the text
+wchar_t character_before(std::string_view text, size_t offset) {
+    if (offset == 0) return 0;
+    size_t start = offset - 1;
+    while (start > 0 && offset - start < 4 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) --start;
+    std::wstring decoded = utf8_to_wide(text.substr(start, offset - start));
+    return decoded.empty() ? 0 : decoded.back();
+}
+
+// The character that starts at offset, or 0 at the end of the text
+wchar_t character_after(std::string_view text, size_t offset) {
+    if (offset >= text.size()) return 0;
+    std::wstring decoded = utf8_to_wide(text.substr(offset, 4));
+    return decoded.empty() ? 0 : decoded.front();
+}
+
+// Matches a [...] class at the start of pattern against c, setting length to the size of the class.
+// Returns false with length 0 when the class is not closed, so the '[' is taken literally.
+bool match_class(std::string_view pattern, char c, size_t& length) {
+    size_t i = 1;
+    bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negated) ++i;
+    bool matched = false;
+    for (size_t first = i; i < pattern.size() && (pattern[i] != ']' || i == first); ++i) {
+        char low = pattern[i];
+        char high = low;
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            high = pattern[i + 2];
+            i += 2;
+        }
+        if (c >= low && c <= high) matched = true;
+    }
+    if (i >= pattern.size()) {
+        length = 0;
+        return false;
+    }
+    length = i + 1;
+    return matched != negated && c != '/';
+}
+
+} // namespace
+
+bool glob_match(std::string_view pattern, std::string_view path) {
+    size_t p = 0;
+    size_t t = 0;
+    while (p < pattern.size()) {
+        char c = pattern[p];
+        if (c == '*' && p + 1 < pattern.size() && pattern[p + 1] == '*') {
+            std::string_view rest = pattern.substr(p + 2);
+            if (!rest.empty() && rest[0] == '/') {
+                // "**/" matches any number of whole directories, including none
+                rest.remove_prefix(1);
+                if (glob_match(rest, path.substr(t))) return true;
+                for (size_t i = t; i < path.size(); ++i) {
+                    if (path[i] == '/' && glob_match(rest, path.substr(i + 1))) return true;
+                }
+                return false;
+            }
+            for (size_t i = t; i <= path.size(); ++i) {
+                if (glob_match(rest, path.substr(i))) return true;
+            }
+            return false;
+        }
+        if (c == '*') {
+            std::string_view rest = pattern.substr(p + 1);
+            for (size_t i = t;; ++i) {
+                if (glob_match(rest, path.substr(i))) return true;
+                if (i == path.size() || path[i] == '/') return false;
+            }
+        }
+        if (t == path.size()) return false;
+        if (c == '?') {
+            if (path[t] == '/') return false;
+            ++p;
+            ++t;
+            continue;
+        }
+        if (c == '[') {
+            size_t length;
+            bool matched = match_class(pattern.substr(p), path[t], length);
+            if (length > 0) {
+                if (!matched) return false;
+                p += length;
+                ++t;
+                continue;
+            }
+        }
+        if (c == '\\' && p + 1 < pattern.size()) c = pattern[++p];
+        if (c != path[t]) return false;
+        ++p;
+        ++t;
+    }
+    return t == path.size();
+}
+
+IgnoreRules::IgnoreRules(std::shared_ptr<const IgnoreRules> parent, std::string base, std::string_view contents)
+    : parent(std::move(parent)), base(std::move(base)), patterns() {
+    while (!contents.empty()) {
+        size_t end = contents.find('\n');
+        std::string_view line = contents.substr(0, end);
+        contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        // Trailing spaces are dropped unless escaped
+        while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line[0] == '#') continue;
+
+        Pattern pattern{{}, false, false, false};
+        if (line[0] == '!') {
+            pattern.negated = true;
+            line.remove_prefix(1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            pattern.directory_only = true;
+            line.remove_suffix(1);
+        }
+        if (line.empty()) continue;
+        // A slash anywhere but at the end ties the pattern to this directory
+        pattern.anchored = line.find('/') != std::string_view::npos;
+        if (line[0] == '/') line.remove_prefix(1);
+        pattern.glob = line;
+        patterns.push_back(std::move(pattern));
+    }
+}
+
+int IgnoreRules::decide(std::string_view path, bool directory) const {
+    int result = parent ? parent->decide(path, directory) : 0;
+    if (path.substr(0, base.size()) != base) return result;
+
+    std::string_view relative = path.substr(base.size());
+    std::string_view name = relative.substr(relative.rfind('/') + 1);
+    for (const Pattern& pattern : patterns) {
+        if (pattern.directory_only && !directory) continue;
+        if (glob_match(pattern.glob, pattern.anchored ? relative : name)) {
+            result = pattern.negated ? -1 : 1;
+        }
+    }
+    return result;
+}
+
+bool IgnoreRules::is_ignored(std::string_view path, bool directory) const {
+    return decide(path, directory) > 0;
+}
+
+ProjectSearch::ProjectSearch(const std::string& root, std::string_view needle, FindOptions options,
+                             size_t max_results, unsigned max_threads)
+    : root(root), needle(needle), options(options), max_results(max_results), queues(), pending(0), queued(0),
+      cancelled(false), running(0), files_searched(0), result_count(0), idle_mutex(), idle(), results_mutex(),
+      results(), workers() {
+    if (this->needle.empty() || max_results == 0) return;
+    if (max_threads == 0) {
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < max_threads; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    push(0, Task{"", nullptr, true});
+    running.store(max_threads, std::memory_order_release);
+    for (unsigned i = 0; i < max_threads; ++i) {
+        workers.emplace_back(&ProjectSearch::work, this, i);
+    }
+}
+
+ProjectSearch::~ProjectSearch() {
+    cancel();
+    wait();
+}
+
+void ProjectSearch::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+    wake(true);
+}
+
+void ProjectSearch::wait() {
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void ProjectSearch::take_results(std::vector<SearchResult>& out) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    std::move(results.begin(), results.end(), std::back_inserter(out));
+    results.clear();
+}
+
+void ProjectSearch::work(size_t index) {
+    Task task;
+    while (!cancelled.load(std::memory_order_relaxed)) {
+        if (pop(index, task) || steal(index, task)) {
+            if (task.directory) {
+                walk(index, task);
+            } else {
+                search_file(task);
+            }
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                wake(true);
+            }
+        } else if (pending.load(std::memory_order_acquire) == 0) {
+            // Nothing queued and nobody working who could queue more
+            break;
+        } else {
+            // Someone is still listing a directory or searching a file, and may queue more
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle.wait(lock, [this] {
+                return queued.load(std::memory_order_acquire) > 0 || pending.load(std::memory_order_acquire) == 0
+                    || cancelled.load(std::memory_order_relaxed);
+            });
+        }
+    }
+    running.fetch_sub(1, std::memory_order_release);
+}
+
+void ProjectSearch::wake(bool all) {
+    // Taking the lock orders the change before any waiting worker's check of it, so no wakeup is lost
+    { std::lock_guard<std::mutex> lock(idle_mutex); }
+    if (all) {
+        idle.notify_all();
+    } else {
+        idle.notify_one();
+    }
+}
+
+void ProjectSearch::push(size_t index, Task task) {
+    pending.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+        queued.fetch_add(1, std::memory_order_acq_rel);
+    }
+    wake(false);
+}
+
+bool ProjectSearch::pop(size_t index, Task& task) {
+    // The newest task first, which keeps a thread's walk depth first and its directories warm
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    if (queues[index]->tasks.empty()) return false;
+    task = std::move(queues[index]->tasks.back());
+    queues[index]->tasks.pop_back();
+    queued.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+bool ProjectSearch::steal(size_t index, Task& task) {
+    // The oldest task of another thread, which is the one nearest the root and so the most work
+    for (size_t i = 1; i < queues.size(); ++i) {
+        WorkQueue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+    return false;
+}
+
+void ProjectSearch::walk(size_t index, const Task& task) {
+    namespace fs = std::filesystem;
+    fs::path directory = task.path.empty() ? fs::path(root) : fs::path(root) / task.path;
+    std::string prefix = task.path.empty() ? std::string() : task.path + "/";
+
+    std::shared_ptr<const IgnoreRules> rules = task.rules;
+    MappedFile gitignore((directory / ".gitignore").string());
+    if (gitignore.size() > 0) {
+        auto own = std::make_shared<const IgnoreRules>(rules, prefix, std::string_view(gitignore.data(), gitignore.size()));
+        if (!own->empty()) rules = std::move(own);
+    }
+
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (cancelled.load(std::memory_order_relaxed)) return;
+        // Symbolic links are not followed, which also keeps the walk from going round in circles
+        std::error_code status_error;
+        fs::file_status status = it->symlink_status(status_error);
+        if (status_error) continue;
+        bool is_directory = fs::is_directory(status);
+        if (!is_directory && !fs::is_regular_file(status)) continue;
+
+        std::string name = it->path().filename().string();
+        if (is_directory && name == ".git") continue;
+        std::string path = prefix + name;
+        if (rules && rules->is_ignored(path, is_directory)) continue;
+        push(index, Task{std::move(path), rules, is_directory});
+    }
+}
+
+void ProjectSearch::search_file(const Task& task) {
+    MappedFile file((std::filesystem::path(root) / task.path).string());
+    files_searched.fetch_add(1, std::memory_order_relaxed);
+    if (file.size() < needle.size()) return;
+
+    std::string_view text(file.data(), file.size());
+    if (std::memchr(text.data(), '\0', std::min(text.size(), SEARCH_BINARY_PROBE)) != nullptr) return;
+
+    std::vector<SearchResult> found;
+    size_t line = 0;
+    size_t line_start = 0;
+    size_t counted = 0; // Line breaks before this offset are counted in line
+    bool fold_case = !options.match_case;
+    for (size_t at = find_bytes(text, needle, 0, fold_case); at != std::string_view::npos;) {
+        if (cancelled.load(std::memory_order_relaxed) || found.size() >= max_results) break;
+        if (options.whole_word && (is_word_character(character_before(text, at))
+                                   || is_word_character(character_after(text, at + needle.size())))) {
+            at = find_bytes(text, needle, at + 1, fold_case);
+            continue;
+        }
+
+        // Only the text since the previous match is counted, so a file is read about once
+        size_t breaks = static_cast<size_t>(std::count(text.begin() + counted, text.begin() + at, '\n'));
+        if (breaks > 0) {
+            line += breaks;
+            line_start = at;
+            while (text[line_start - 1] != '\n') --line_start;
+        }
+        counted = at;
+
+        std::string_view rest = text.substr(line_start, SEARCH_LINE_LIMIT);
+        rest = rest.substr(0, rest.find('\n'));
+        // A line cut inside a character loses the rest of it, so the text stays valid UTF-8
+        for (size_t end = line_start + rest.size();
+             !rest.empty() && end < text.size() && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80; --end) {
+            rest.remove_suffix(1);
+        }
+        if (!rest.empty() && rest.back() == '\r') rest.remove_suffix(1);
+        found.push_back(SearchResult{task.path, line, at - line_start, std::string(rest)});
+        at = find_bytes(text, needle, at + needle.size(), fold_case);
+    }
+    if (found.empty()) return;
+
+    std::lock_guard<std::mutex> lock(results_mutex);
+    size_t total = result_count.load(std::memory_order_relaxed);
+    size_t take = std::min(found.size(), max_results - std::min(total, max_results));
+    std::move(found.begin(), found.begin() + static_cast<std::ptrdiff_t>(take), std::back_inserter(results));
+    result_count.store(total + take, std::memory_order_relaxed);
+    if (total + take >= max_results) cancel();
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "find.h"
+
+/// @brief Lines longer than this are cut off in search results, at the start of the character that crosses it.
+constexpr size_t SEARCH_LINE_LIMIT = 256;
+
+/// @brief Files with a zero byte in their first this many bytes are taken to be binary and skipped.
+constexpr size_t SEARCH_BINARY_PROBE = 8000;
+
+/// @brief Checks if a path matches a gitignore glob.
+///
+/// * and ? match anything but '/', [a-z] and [!a-z] match one character of a class,
+/// ** matches across directories, and a backslash makes the next character literal.
+bool glob_match(std::string_view pattern, std::string_view path);
+
+/// @brief The patterns of one .gitignore file, chained to those of the directories above it.
+///
+/// Patterns without a slash match a name at any depth below the file, others match
+/// the path relative to it. A trailing slash only matches directories and a leading
+/// ! includes again what an earlier pattern excluded. As in git, the last pattern that
+/// matches decides, and patterns of deeper files come after those of their parents.
+class IgnoreRules {
+public:
+    /// @brief Parses contents as a .gitignore in the directory base, relative to the searched root ("" or "a/b/").
+    IgnoreRules(std::shared_ptr<const IgnoreRules> parent, std::string base, std::string_view contents);
+
+    /// @brief Checks if a path relative to the searched root is excluded by these patterns or a parent's.
+    bool is_ignored(std::string_view path, bool directory) const;
+
+    inline bool empty() const { return patterns.empty(); }
+
+private:
+    struct Pattern {
+        std::string glob;
+        bool negated;
+        bool directory_only;
+        bool anchored;
+    };
+
+    // 1 if excluded, -1 if included again, 0 if no pattern matches
+    int decide(std::string_view path, bool directory) const;
+
+    std::shared_ptr<const IgnoreRules> parent;
+    std::string base;
+    std::vector<Pattern> patterns;
+};
+
+/// @brief One match of a project search.
+struct SearchResult {
+    std::string path;   // Relative to the searched directory, with '/' between names
+    size_t line;        // Counted from 0
+    size_t column;      // Byte offset of the match in its line
+    std::string text;   // The line the match is on, without its line break, cut to at most SEARCH_LINE_LIMIT bytes
+};
+
+/// @brief Searches every file below a directory for a needle, on a pool of threads.
+///
+/// Each thread owns a queue of directories and files to visit. It takes work from
+/// the back of its own queue and, when that runs dry, steals from the front of the
+/// others', so the walk spreads over all threads as soon as the first directory is
+/// listed. A thread that finds nothing to take sleeps until more is queued. Files
+/// are memory mapped and scanned with find_bytes, and each file's matches are
+/// published as soon as it is done, so take_results has something to show long
+/// before the walk is over. .git directories, symbolic links, files that look binary
+/// and whatever .gitignore files exclude are skipped. The search runs until it is done,
+/// cancelled, destroyed or has found max_results matches.
+class ProjectSearch {
+public:
+    ProjectSearch(const std::string& root, std::string_view needle, FindOptions options,
+                  size_t max_results = 10000, unsigned max_threads = 0);
+
+    ProjectSearch(const ProjectSearch&) = delete;
+    ProjectSearch& operator=(const ProjectSearch&) = delete;
+
+    /// @brief Cancels the search and waits for its threads.
+    ~ProjectSearch();
+
+    /// @brief Stops the search as soon as every thread has noticed, such as when the query changes.
+    void cancel();
+
+    /// @brief Moves the results found since the last call to the end of out.
+    void take_results(std::vector<SearchResult>& out);
+
+    /// @brief Checks if every thread has stopped. Results may still be waiting to be taken.
+    inline bool is_done() const { return running.load(std::memory_order_acquire) == 0; }
+
+    /// @brief Blocks until the search is done.
+    void wait();
+
+    inline size_t get_files_searched() const { return files_searched.load(std::memory_order_relaxed); }
+    inline size_t get_result_count() const { return result_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Task {
+        std::string path; // Relative to root
+        std::shared_ptr<const IgnoreRules> rules;
+        bool directory;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void work(size_t index);
+    /// @brief Wakes idle workers after queued, pending or cancelled changed.
+    void wake(bool all);
+    void push(size_t index, Task task);
+    bool pop(size_t index, Task& task);
+    bool steal(size_t index, Task& task);
+    void walk(size_t index, const Task& task);
+    void search_file(const Task& task);
+
+    std::string root;
+    std::string needle;
+    FindOptions options;
+    size_t max_results;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::atomic<size_t> pending; // Tasks queued or being worked on
+    std::atomic<size_t> queued;  // Tasks queued and not taken yet
+    std::atomic<bool> cancelled;
+    std::atomic<unsigned> running;
+    std::atomic<size_t> files_searched;
+    std::atomic<size_t> result_count;
+
+    // Workers with nothing to take sleep here until there is work again or the search is over
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+
+    std::mutex results_mutex;
+    std::vector<SearchResult> results;
+
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,58 @@
+#include "recording_renderer.h"
+
+RecordingRenderer::RecordingRenderer() : counts(), layouts() {}
+
+void RecordingRenderer::BeginDraw() {}
+
+void RecordingRenderer::EndDraw() { ++counts.frames; }
+
+void RecordingRenderer::SetColor(const Color&) {}
+
+void RecordingRenderer::ClearScreen(const Color&) {
+    ++counts.draw_calls;
+    ++counts.clears;
+}
+
+void RecordingRenderer::PushClip(float, float, float, float) {}
+
+void RecordingRenderer::PopClip() {}
+
+void RecordingRenderer::DrawLine(const float, const float, const float, const float, const float) {
+    ++counts.draw_calls;
+    ++counts.lines;
+}
+
+void RecordingRenderer::DrawRect(float, float, float, float, float) {
+    ++counts.draw_calls;
+}
+
+void RecordingRenderer::FillRect(float, float, float, float) {
+    ++counts.draw_calls;
+    ++counts.fill_rects;
+}
+
+void RecordingRenderer::DrawString(const wchar_t*, int str_len, float, float, float, float) {
+    ++counts.draw_calls;
+    counts.glyphs += static_cast<size_t>(str_len);
+}
+
+void RecordingRenderer::DrawFormattedString(const wchar_t* string, int str_len, float, float, float width, float height,
+                                            const std::vector<FormatRange>& formatting) {
+    ++counts.draw_calls;
+    counts.glyphs += static_cast<size_t>(str_len);
+    layouts.get(*this, std::wstring_view(string, str_len), formatting, {L"", 0.0f, width, height});
+
+    // Highlights are filled over the text, as Graphics does
+    for (const FormatRange& range : formatting) {
+        if (range.type == FormatType::HIGHLIGHT && range.start_char < str_len) {
+            ++counts.draw_calls;
+            ++counts.fill_rects;
+        }
+    }
+}
+
+std::unique_ptr<TextLayout> RecordingRenderer::shape(std::wstring_view text, const std::vector<FormatRange>&,
+                                                     const LayoutStyle&) {
+    counts.shaped_glyphs += text.length();
+    return std::make_unique<TextLayout>();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "layout_cache.h"
+#include "renderer.h"
+
+/// @brief Headless renderer that draws nothing and counts what would have been drawn.
+///
+/// Formatted strings go through a LayoutCache like they do in Graphics, so
+/// the counts include how many glyphs each frame had to shape. Counters add
+/// up until reset is called.
+class RecordingRenderer : public Renderer, public TextShaper {
+public:
+    /// @brief What was drawn since the last reset.
+    struct Counts {
+        size_t frames = 0;
+        size_t draw_calls = 0;    // Every call that puts something on screen, clears included
+        size_t glyphs = 0;        // Characters drawn by string calls
+        size_t shaped_glyphs = 0; // Characters that missed the layout cache and had to be shaped
+        size_t fill_rects = 0;
+        size_t lines = 0;
+        size_t clears = 0;
+    };
+
+    RecordingRenderer();
+
+    void BeginDraw() override;
+    void EndDraw() override;
+
+    void SetColor(const Color& color) override;
+    void ClearScreen(const Color& color) override;
+    void PushClip(float x1, float y1, float x2, float y2) override;
+    void PopClip() override;
+    void DrawLine(const float x1, const float y1, const float x2, const float y2, const float stroke_width) override;
+    void DrawRect(float x, float y, float width, float height, float stroke_width = 1.0f) override;
+    void FillRect(float x1, float y1, float x2, float y2) override;
+    void DrawString(const wchar_t* string, int str_len, float x, float y, float width, float height) override;
+    void DrawFormattedString(const wchar_t* string, int str_len, float x, float y, float width, float height,
+                             const std::vector<FormatRange>& formatting) override;
+
+    std::unique_ptr<TextLayout> shape(std::wstring_view text, const std::vector<FormatRange>& formatting,
+                                      const LayoutStyle& style) override;
+
+    inline const Counts& get_counts() const { return counts; }
+    inline void reset() { counts = Counts(); }
+
+private:
+    Counts counts;
+    LayoutCache layouts;
+};
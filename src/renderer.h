@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "color.h"
+#include "formatting.h"
+
+/// @brief What the editor draws with, independent of the graphics API behind it.
+///
+/// Graphics implements it with Direct2D and DirectWrite for the window, and
+/// RecordingRenderer implements it headlessly so that drawing can be tested
+/// and measured without a GPU or Windows.
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+
+    virtual void BeginDraw() = 0;
+    virtual void EndDraw() = 0;
+
+    virtual void SetColor(const Color& color) = 0;
+    virtual void ClearScreen(const Color& color) = 0;
+
+    /// @brief Restricts drawing, including ClearScreen, to a rectangle until PopClip is called.
+    virtual void PushClip(float x1, float y1, float x2, float y2) = 0;
+    virtual void PopClip() = 0;
+
+    virtual void DrawLine(const float x1, const float y1, const float x2, const float y2, const float stroke_width) = 0;
+    virtual void DrawRect(float x, float y, float width, float height, float stroke_width = 1.0f) = 0;
+    virtual void FillRect(float x1, float y1, float x2, float y2) = 0;
+    virtual void DrawString(const wchar_t* string, int str_len, float x, float y, float width, float height) = 0;
+    virtual void DrawFormattedString(const wchar_t* string, int str_len, float x, float y, float width, float height,
+                                     const std::vector<FormatRange>& formatting) = 0;
+};
@@ -0,0 +1,163 @@
+#include "replace.h"
+
+#include <regex>
+
+namespace {
+
+// Characters that are not literal text in an ECMAScript pattern
+bool is_special(char c) {
+    switch (c) {
+        case '\\': case '^': case '$': case '.': case '|': case '?': case '*': case '+':
+        case '(': case ')': case '[': case ']': case '{': case '}':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Whether the pattern has an alternative at the top level, outside of groups and classes
+bool has_top_level_alternative(std::string_view pattern) {
+    int depth = 0;
+    bool in_class = false;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '\\') {
+            ++i;
+        } else if (in_class) {
+            in_class = c != ']';
+        } else if (c == '[') {
+            in_class = true;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (c == '|' && depth == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A run of literal text in a replacement format, followed by a group of the match, if any
+struct FormatPart {
+    std::string literal;
+    int group; // -1 for none, 0 for the whole match
+};
+
+// Splits a replacement format up front, since std::match_results::format looks up the locale on every call
+std::vector<FormatPart> parse_format(std::string_view format, size_t group_count) {
+    std::vector<FormatPart> parts(1, FormatPart{{}, -1});
+    for (size_t i = 0; i < format.size(); ++i) {
+        char next = i + 1 < format.size() ? format[i + 1] : '\0';
+        int group = -1;
+        if (format[i] == '$' && next == '$') {
+            parts.back().literal.push_back('$');
+            ++i;
+            continue;
+        } else if (format[i] == '$' && next == '&') {
+            group = 0;
+            ++i;
+        } else if (format[i] == '$' && next >= '0' && next <= '9') {
+            // Two digits when they name a group, as in ECMAScript
+            group = next - '0';
+            ++i;
+            char second = i + 1 < format.size() ? format[i + 1] : '\0';
+            if (second >= '0' && second <= '9' && static_cast<size_t>(group * 10 + (second - '0')) <= group_count) {
+                group = group * 10 + (second - '0');
+                ++i;
+            }
+            // $0 and groups the pattern does not have are left as they are
+            if (group == 0 || static_cast<size_t>(group) > group_count) {
+                parts.back().literal.append(format.substr(i - 1, 2));
+                continue;
+            }
+        } else {
+            parts.back().literal.push_back(format[i]);
+            continue;
+        }
+        parts.back().group = group;
+        parts.push_back(FormatPart{{}, -1});
+    }
+    return parts;
+}
+
+} // namespace
+
+std::string literal_prefix(std::string_view pattern) {
+    if (has_top_level_alternative(pattern)) return {};
+
+    size_t i = pattern.size() > 0 && pattern[0] == '^' ? 1 : 0;
+    std::string prefix;
+    for (; i < pattern.size() && !is_special(pattern[i]); ++i) {
+        prefix.push_back(pattern[i]);
+    }
+    // A quantifier that allows zero repetitions makes the last character optional
+    if (!prefix.empty() && i < pattern.size() && (pattern[i] == '?' || pattern[i] == '*' || pattern[i] == '{')) {
+        prefix.pop_back();
+    }
+    return prefix;
+}
+
+bool find_replacements(std::string_view text, std::string_view pattern, std::string_view format, FindOptions options,
+                       Replacements& out, std::string& error) {
+    std::regex regex;
+    auto syntax = std::regex::ECMAScript | std::regex::multiline;
+    if (!options.match_case) syntax |= std::regex::icase;
+    try {
+        regex.assign(options.whole_word ? "\\b(?:" + std::string(pattern) + ")\\b" : std::string(pattern), syntax);
+    } catch (const std::regex_error& e) {
+        error = e.what();
+        return false;
+    }
+
+    std::vector<FormatPart> format_parts = parse_format(format, regex.mark_count());
+    std::string prefix = literal_prefix(pattern);
+    // Plain text needs no regular expression at all, only the prefix search
+    bool literal = prefix.size() == pattern.size() && !options.whole_word;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    std::cmatch match;
+    size_t position = 0;
+    size_t last_end = std::string_view::npos;
+    while (position <= text.size()) {
+        // With a literal prefix the expression only has to be tried where the prefix occurs
+        size_t start = position;
+        auto flags = std::regex_constants::match_default;
+        if (!prefix.empty()) {
+            start = find_bytes(text, prefix, position, !options.match_case);
+            if (start == std::string_view::npos) break;
+            flags |= std::regex_constants::match_continuous;
+        }
+        if (start > 0) flags |= std::regex_constants::match_prev_avail;
+        if (!literal && !std::regex_search(begin + start, end, match, regex, flags)) {
+            if (prefix.empty()) break;
+            position = start + 1;
+            continue;
+        }
+
+        size_t match_start = literal ? start : static_cast<size_t>(match[0].first - begin);
+        size_t match_length = literal ? prefix.size() : static_cast<size_t>(match.length(0));
+        // Like JavaScript, an empty match right where the previous match ended does not count
+        if (match_length > 0 || match_start != last_end) {
+            size_t inserted_before = out.inserted.size();
+            for (const FormatPart& part : format_parts) {
+                out.inserted.append(part.literal);
+                if (part.group == 0) {
+                    out.inserted.append(text.substr(match_start, match_length));
+                } else if (part.group > 0 && match[part.group].matched) {
+                    out.inserted.append(match[part.group].first, match[part.group].second);
+                }
+            }
+            out.spans.push_back({match_start, match_length, out.inserted.size() - inserted_before});
+            out.removed.append(text.substr(match_start, match_length));
+        }
+
+        position = last_end = match_start + match_length;
+        if (match_length == 0) {
+            // Step over the whole character so that no match starts inside it
+            ++position;
+            while (position < text.size() && (static_cast<unsigned char>(text[position]) & 0xC0) == 0x80) ++position;
+        }
+    }
+    return true;
+}
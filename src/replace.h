@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "edit.h"
+#include "find.h"
+
+/// @brief Every match of a regular expression in a text, and what each is replaced with.
+struct Replacements {
+    std::vector<Replacement> spans; // In document order, positions in the text that was searched
+    std::string removed;            // The text of every match, in order
+    std::string inserted;           // The replacement of every match, in order
+};
+
+/// @brief Finds every match of an ECMAScript regular expression in text, in one pass, and formats its replacement.
+///
+/// ^ and $ match at line breaks. In format, $& stands for the match and $1 to $99 for its groups.
+/// The search skips ahead with find_bytes to the literal text the pattern starts with, when it
+/// starts with any, and only runs the regular expression there; a pattern that is nothing but
+/// literal text never runs it at all. options.match_case makes ASCII
+/// letters match only their own case, and options.whole_word requires a word boundary (\b) at
+/// both ends of a match. Empty matches are replaced too, but never inside a UTF-8 sequence.
+/// Returns false and describes the problem in error if the pattern does not compile.
+bool find_replacements(std::string_view text, std::string_view pattern, std::string_view format, FindOptions options,
+                       Replacements& out, std::string& error);
+
+/// @brief Gets the literal text every match of a pattern starts with, or an empty string if it cannot tell.
+std::string literal_prefix(std::string_view pattern);
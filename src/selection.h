@@ -1,47 +1,56 @@
 #pragma once
 
-#include <windows.h>
+#include <cstddef>
+
+#include "anchor_set.h"
 
 /// @brief Manages text selection state within a document
+///
+/// Both ends are anchors, given as byte offsets in the document, so the
+/// selection keeps covering the same text when edits happen before it.
 class Selection {
 public:
     Selection();
     
-    /// @brief Starts a new selection at the given position
-    void start_selection(int line, int character);
+    /// @brief Starts a new selection at the given offset
+    void start_selection(size_t offset);
     
     /// @brief Updates the selection end position
-    void update_selection(int line, int character);
+    void update_selection(size_t offset);
     
     /// @brief Clears the current selection
     void clear_selection();
     
     /// @brief Checks if there is an active selection
     inline bool has_selection() const { return is_active; }
+
+    /// @brief Whether the selection is a rectangle covering the same columns on every line from start to end,
+    /// rather than all the text between them. Clearing the selection turns this off.
+    inline bool is_block() const { return block; }
+    inline void set_block(bool is_block) { block = is_block; }
     
-    /// @brief Gets the start line of the selection
-    inline int get_start_line() const { return start_line; }
-    
-    /// @brief Gets the start character of the selection
-    inline int get_start_char() const { return start_char; }
-    
-    /// @brief Gets the end line of the selection
-    inline int get_end_line() const { return end_line; }
+    /// @brief Gets the offset where the selection was started
+    inline size_t get_start() const { return anchors.get(start_anchor); }
     
-    /// @brief Gets the end character of the selection
-    inline int get_end_char() const { return end_char; }
+    /// @brief Gets the offset the selection was extended to
+    inline size_t get_end() const { return anchors.get(end_anchor); }
     
-    /// @brief Gets the normalized start position (ensures start comes before end)
-    void get_normalized_range(int& norm_start_line, int& norm_start_char, 
-                             int& norm_end_line, int& norm_end_char) const;
+    /// @brief Gets the normalized range (ensures start comes before end)
+    void get_normalized_range(size_t& norm_start, size_t& norm_end) const;
     
-    /// @brief Checks if a position is within the selection range
-    bool is_position_selected(int line, int character) const;
+    /// @brief Checks if an offset is within the selection range
+    bool is_position_selected(size_t offset) const;
+
+    /// @brief Moves the selection for length bytes inserted at offset
+    inline void on_insert(size_t offset, size_t length) { anchors.on_insert(offset, length); }
+
+    /// @brief Moves the selection for length bytes erased at offset
+    inline void on_erase(size_t offset, size_t length) { anchors.on_erase(offset, length); }
     
 private:
     bool is_active;
-    int start_line;
-    int start_char;
-    int end_line;
-    int end_char;
-};
\ No newline at end of file
+    bool block;
+    AnchorSet anchors;
+    AnchorId start_anchor;
+    AnchorId end_anchor;
+};
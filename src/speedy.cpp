@@ -16,6 +16,9 @@ int client_height;
 
 bool show_cursor;
 
+// Whether the last key press ran a command or continued a key sequence, so its character must not be typed
+bool key_consumed = false;
+
 // Global variables for mouse tracking
 bool is_mouse_selecting = false;
 POINT last_mouse_pos = {0, 0};
@@ -27,15 +30,17 @@ void MouseToTextPosition(int mouse_x, int mouse_y, int& line, int& character) {
     const float char_width = font_size * 0.6f;
     const float offset_x = Config::get_instance()->get_left_margin() + Config::get_instance()->get_explorer_width();
     
+    OpenedFile& file = Client::get_instance()->get_working_file();
+    const Viewport& viewport = file.get_viewport();
+    
     // Calculate line
-    line = mouse_y / line_height;
+    line = viewport.get_first_line() + mouse_y / line_height;
     
     // Calculate character position
     float relative_x = mouse_x - offset_x;
-    character = static_cast<int>(relative_x / char_width);
+    character = viewport.get_first_column() + static_cast<int>(relative_x / char_width);
     
     // Clamp to valid ranges
-    OpenedFile& file = Client::get_instance()->get_working_file();
     if (line < 0) line = 0;
     if (line >= file.get_num_lines()) line = file.get_num_lines() - 1;
     if (character < 0) character = 0;
@@ -140,6 +145,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		client_width = *(short*)&lParam;
 		client_height = *((short*)&lParam + 1);
 		g->Resize(client_width, client_height);
+		// Resizing loses the retained frame
+		InvalidateRect(hWnd, NULL, FALSE);
 		return 0;
 	case WM_SETFOCUS:
 		InvalidateRect(hWnd, NULL, TRUE);
@@ -154,12 +161,17 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		PostQuitMessage(0);
 		return 0;
 	case WM_CHAR:
+		if (key_consumed) {
+			key_consumed = false;
+			return 0;
+		}
 		Client::get_instance()->process_character(static_cast<char>(wParam));
-		InvalidateRect(hWnd, NULL, TRUE);
+		Client::get_instance()->invalidate(hWnd);
 		return 0;
 	case WM_KEYDOWN:
-		if (CommandController::get_instance()->run_commands()) {
-			InvalidateRect(hWnd, NULL, TRUE);
+		key_consumed = CommandController::get_instance()->run_commands();
+		if (key_consumed) {
+			Client::get_instance()->invalidate(hWnd);
 			return 0;
 		} 
 		return DefWindowProcW(hWnd, uMsg, wParam, lParam);
@@ -174,6 +186,14 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		MouseToTextPosition(mouse_x, mouse_y, line, character);
 		
 		OpenedFile& file = Client::get_instance()->get_working_file();
+
+		// Ctrl+click adds a cursor, any other click leaves just the main one
+		if (GetKeyState(VK_CONTROL) & 0x8000) {
+			file.add_cursor(line, character);
+			Client::get_instance()->invalidate(hWnd);
+			return 0;
+		}
+		file.clear_cursors();
 		file.set_current_line(line);
 		file.set_current_character(character);
 		
@@ -186,15 +206,24 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		} else {
 			file.clear_selection();
 			file.start_selection();
+			// Alt+drag selects a block of columns
+			if (GetKeyState(VK_MENU) & 0x8000) {
+				file.set_block_selection(true);
+			}
 		}
 		
 		is_mouse_selecting = true;
 		last_mouse_pos.x = mouse_x;
 		last_mouse_pos.y = mouse_y;
 		SetCapture(hWnd);
-		InvalidateRect(hWnd, NULL, TRUE);
+		Client::get_instance()->invalidate(hWnd);
 		return 0;
 	}
+	case WM_MOUSEWHEEL:
+		// Three lines per notch, scrolling down when the wheel is rotated towards the user
+		Client::get_instance()->scroll(-GET_WHEEL_DELTA_WPARAM(wParam) * 3 / WHEEL_DELTA);
+		Client::get_instance()->invalidate(hWnd);
+		return 0;
 	case WM_LBUTTONUP:
 	{
 		if (is_mouse_selecting) {
@@ -217,7 +246,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 			file.set_current_character(character);
 			file.update_selection();
 			
-			InvalidateRect(hWnd, NULL, TRUE);
+			Client::get_instance()->invalidate(hWnd);
 		}
 		return 0;
 	}
@@ -257,15 +286,24 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		file.set_current_character(word_end);
 		file.update_selection();
 		
-		InvalidateRect(hWnd, NULL, TRUE);
+		Client::get_instance()->invalidate(hWnd);
 		return 0;
 	}
 	case WM_PAINT:
+	{
+		// Only the invalidated part of the window is cleared and drawn, the rest keeps the last frame
+		PAINTSTRUCT ps;
+		BeginPaint(hWnd, &ps);
+		const RECT& region = ps.rcPaint;
 		g->BeginDraw();
+		g->PushClip(static_cast<float>(region.left), static_cast<float>(region.top), static_cast<float>(region.right), static_cast<float>(region.bottom));
 		g->ClearScreen(Config::get_instance()->get_background_color());
-		Client::get_instance()->draw(g);
+		Client::get_instance()->draw(g, static_cast<float>(region.top), static_cast<float>(region.bottom));
+		g->PopClip();
 		g->EndDraw();
-		return DefWindowProc(hWnd, uMsg, wParam, lParam);
+		EndPaint(hWnd, &ps);
+		return 0;
+	}
 	default:
 		return DefWindowProcW(hWnd, uMsg, wParam, lParam);
 	}
@@ -0,0 +1,129 @@
+#include "utf8.h"
+
+#include <cstring>
+
+namespace {
+
+// Length of a valid sequence starting at text[i] or 0 if it is not valid UTF-8
+size_t sequence_length(std::string_view text, size_t i, char32_t& code_point) {
+    unsigned char lead = static_cast<unsigned char>(text[i]);
+    size_t length;
+    char32_t minimum;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        code_point = lead & 0x1F;
+        minimum = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        code_point = lead & 0x0F;
+        minimum = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        code_point = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        return 0;
+    }
+    if (i + length > text.size()) return 0;
+
+    for (size_t k = 1; k < length; ++k) {
+        unsigned char next = static_cast<unsigned char>(text[i + k]);
+        if ((next & 0xC0) != 0x80) return 0;
+        code_point = (code_point << 6) | (next & 0x3F);
+    }
+    if (code_point < minimum || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) return 0;
+    return length;
+}
+
+void append_utf8(std::string& out, char32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+} // namespace
+
+bool is_ascii(std::string_view text) {
+    const char* data = text.data();
+    size_t i = 0;
+    // Eight bytes at a time, checking all of their high bits at once
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t block;
+        std::memcpy(&block, data + i, sizeof(block));
+        if (block & 0x8080808080808080ull) return false;
+    }
+    for (; i < text.size(); ++i) {
+        if (static_cast<unsigned char>(data[i]) & 0x80) return false;
+    }
+    return true;
+}
+
+void utf8_to_wide(std::string_view text, std::wstring& out, std::vector<uint32_t>* column_offsets) {
+    out.clear();
+    out.reserve(text.size());
+    if (column_offsets) {
+        column_offsets->clear();
+        column_offsets->reserve(text.size() + 1);
+    }
+
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char byte = static_cast<unsigned char>(text[i]);
+        char32_t code_point = byte;
+        size_t length = byte < 0x80 ? 1 : sequence_length(text, i, code_point);
+        if (length == 0) {
+            // Invalid byte, keep it as a character of its own
+            code_point = byte;
+            length = 1;
+        }
+
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (code_point >= 0x10000) {
+                char32_t v = code_point - 0x10000;
+                out.push_back(static_cast<wchar_t>(0xD800 + (v >> 10)));
+                out.push_back(static_cast<wchar_t>(0xDC00 + (v & 0x3FF)));
+                if (column_offsets) {
+                    column_offsets->push_back(static_cast<uint32_t>(i));
+                    column_offsets->push_back(static_cast<uint32_t>(i));
+                }
+                i += length;
+                continue;
+            }
+        }
+        out.push_back(static_cast<wchar_t>(code_point));
+        if (column_offsets) column_offsets->push_back(static_cast<uint32_t>(i));
+        i += length;
+    }
+    if (column_offsets) column_offsets->push_back(static_cast<uint32_t>(text.size()));
+}
+
+std::string wide_to_utf8(std::wstring_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        char32_t code_point = static_cast<char32_t>(text[i]);
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (code_point >= 0xD800 && code_point <= 0xDBFF && i + 1 < text.size()) {
+                char32_t low = static_cast<char32_t>(text[i + 1]);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+        }
+        append_utf8(out, code_point);
+    }
+    return out;
+}
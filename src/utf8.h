@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Checks if every byte of text is 7-bit ASCII.
+bool is_ascii(std::string_view text);
+
+/// @brief Decodes UTF-8 into wide characters (UTF-16 on Windows, UTF-32 elsewhere).
+///
+/// Bytes that are not valid UTF-8 decode to one character each with the value
+/// of the byte, so every column always maps back to a byte offset.
+/// When column_offsets is given it receives the byte offset of every column,
+/// plus a final entry holding text.size().
+void utf8_to_wide(std::string_view text, std::wstring& out, std::vector<uint32_t>* column_offsets = nullptr);
+
+inline std::wstring utf8_to_wide(std::string_view text) {
+    std::wstring out;
+    utf8_to_wide(text, out);
+    return out;
+}
+
+/// @brief Encodes wide characters as UTF-8.
+std::string wide_to_utf8(std::wstring_view text);
@@ -0,0 +1,37 @@
+#include "viewport.h"
+
+#include <algorithm>
+
+Viewport::Viewport()
+    : first_line(0), first_column(0), visible_lines(1), visible_columns(1), followed_line(-1), followed_column(-1) {}
+
+void Viewport::resize(int lines, int columns) {
+    visible_lines = std::max(1, lines);
+    visible_columns = std::max(1, columns);
+}
+
+void Viewport::scroll_to(int line, int column) {
+    if (line < first_line) {
+        first_line = line;
+    } else if (line >= first_line + visible_lines) {
+        first_line = line - visible_lines + 1;
+    }
+    if (column < first_column) {
+        first_column = column;
+    } else if (column >= first_column + visible_columns) {
+        first_column = column - visible_columns + 1;
+    }
+    first_line = std::max(0, first_line);
+    first_column = std::max(0, first_column);
+}
+
+void Viewport::scroll_by(int lines, int total_lines) {
+    first_line = std::clamp(first_line + lines, 0, std::max(0, total_lines - 1));
+}
+
+void Viewport::follow_cursor(int line, int column) {
+    if (line == followed_line && column == followed_column) return;
+    followed_line = line;
+    followed_column = column;
+    scroll_to(line, column);
+}
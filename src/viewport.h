@@ -0,0 +1,41 @@
+#pragma once
+
+/// @brief The window onto a file: which lines and columns are currently visible.
+///
+/// Drawing only ever visits the lines inside the viewport, so the cost of a
+/// frame depends on the window size and not on the file size or on how far
+/// down the cursor is.
+class Viewport {
+public:
+    Viewport();
+
+    /// @brief Sets how many lines and columns fit in the window.
+    void resize(int lines, int columns);
+
+    /// @brief Scrolls just far enough that the given position is visible.
+    void scroll_to(int line, int column);
+
+    /// @brief Scrolls by a number of lines, staying within a file of total_lines lines.
+    void scroll_by(int lines, int total_lines);
+
+    /// @brief Keeps the cursor in view, but only once it has moved so that scrolling away from it sticks.
+    void follow_cursor(int line, int column);
+
+    inline int get_first_line() const { return first_line; }
+    inline int get_first_column() const { return first_column; }
+    inline int get_visible_lines() const { return visible_lines; }
+    inline int get_visible_columns() const { return visible_columns; }
+
+    /// @brief One past the last line that fits in the window.
+    inline int get_end_line() const { return first_line + visible_lines; }
+
+    inline bool is_line_visible(int line) const { return line >= first_line && line < get_end_line(); }
+
+private:
+    int first_line;
+    int first_column;
+    int visible_lines;
+    int visible_columns;
+    int followed_line;
+    int followed_column;
+};
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/action.h"
+
+
+void test_compile();
+void test_errors();
+void test_names();
+
+int main() {
+    test_compile();
+    test_errors();
+    test_names();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_compile() {
+    std::vector<Action> program;
+    std::vector<std::string> errors;
+    assert_equals(true, compile_actions("SELECT_ALL COPY\tDEL -1 4 TRUE  SAVE 2 DELETE", program, errors));
+    assert_equals<size_t>(0, errors.size());
+    assert_equals<size_t>(5, program.size());
+    assert_equals(true, program[0].code == ActionCode::SELECT_ALL);
+    assert_equals(true, program[2].code == ActionCode::DEL);
+    assert_equals(-1, program[2].arguments[0]);
+    assert_equals(4, program[2].arguments[1]);
+    assert_equals(1, program[2].arguments[2]);
+    assert_equals(2, program[3].arguments[0]);
+    assert_equals(true, program[4].code == ActionCode::DELETE_FORWARD);
+
+    assert_equals(true, compile_actions("", program, errors));
+    assert_equals<size_t>(0, program.size());
+}
+
+void test_errors() {
+    std::vector<Action> program;
+    std::vector<std::string> errors;
+
+    // Every problem is reported, and the valid actions around them still compile
+    assert_equals(false, compile_actions("UNDO FLY SAVE x DEL 1 2 MAYBE REDO CLOSE_FILE", program, errors));
+    assert_equals<size_t>(4, errors.size());
+    assert_equals(std::string("Unknown action FLY"), errors[0]);
+    assert_equals(std::string("Invalid argument x to SAVE"), errors[1]);
+    assert_equals(std::string("Invalid argument MAYBE to DEL"), errors[2]);
+    assert_equals(std::string("CLOSE_FILE expects 1 arguments"), errors[3]);
+    assert_equals<size_t>(2, program.size());
+    assert_equals(true, program[1].code == ActionCode::REDO);
+
+    // Names are case sensitive, and numbers can't have trailing junk
+    errors.clear();
+    assert_equals(false, compile_actions("undo SAVE 1x", program, errors));
+    assert_equals<size_t>(2, errors.size());
+}
+
+void test_names() {
+    // Names round trip through the compiler, so the table is in ActionCode order
+    for (int i = 0; i <= static_cast<int>(ActionCode::CLEAR_FIND); ++i) {
+        ActionCode code = static_cast<ActionCode>(i);
+        std::string source = action_name(code);
+        if (code == ActionCode::SAVE || code == ActionCode::CLOSE_FILE
+            || code == ActionCode::TYPE || code == ActionCode::REPLAY_MACRO) source += " 0";
+        if (code == ActionCode::DEL) source += " 0 0 FALSE";
+
+        std::vector<Action> program;
+        std::vector<std::string> errors;
+        compile_actions(source, program, errors);
+        assert_equals<size_t>(1, program.size());
+        assert_equals(i, static_cast<int>(program[0].code));
+    }
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/anchor_set.h"
+
+
+void test_gravity();
+void test_against_naive();
+
+int main() {
+    test_gravity();
+    test_against_naive();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_gravity() {
+    AnchorSet anchors;
+    AnchorId stays = anchors.create(5, Gravity::LEFT);
+    AnchorId moves = anchors.create(5, Gravity::RIGHT);
+    AnchorId after = anchors.create(8, Gravity::LEFT);
+
+    anchors.on_insert(5, 3);
+    assert_equals<size_t>(5, anchors.get(stays));
+    assert_equals<size_t>(8, anchors.get(moves));
+    assert_equals<size_t>(11, anchors.get(after));
+
+    // Anchors inside an erased span collapse onto its start
+    anchors.on_erase(4, 5);
+    assert_equals<size_t>(4, anchors.get(stays));
+    assert_equals<size_t>(4, anchors.get(moves));
+    assert_equals<size_t>(6, anchors.get(after));
+
+    anchors.set(stays, 20);
+    assert_equals<size_t>(20, anchors.get(stays));
+    anchors.remove(moves);
+    assert_equals<size_t>(2, anchors.size());
+    anchors.on_insert(0, 1);
+    assert_equals<size_t>(21, anchors.get(stays));
+    assert_equals<size_t>(7, anchors.get(after));
+}
+
+struct NaiveAnchor {
+    size_t offset;
+    Gravity gravity;
+    bool alive;
+};
+
+void test_against_naive() {
+    AnchorSet anchors;
+    std::vector<NaiveAnchor> naive;
+    std::mt19937 rng(11);
+    size_t document = 1000;
+
+    for (int step = 0; step < 20000; ++step) {
+        unsigned op = rng() % 10;
+        if (op < 3) {
+            size_t offset = rng() % (document + 1);
+            Gravity gravity = rng() % 2 ? Gravity::LEFT : Gravity::RIGHT;
+            AnchorId id = anchors.create(offset, gravity);
+            if (id >= naive.size()) naive.resize(id + 1);
+            naive[id] = {offset, gravity, true};
+        } else if (op < 4 && anchors.size() > 0) {
+            AnchorId id = rng() % naive.size();
+            if (naive[id].alive) {
+                anchors.remove(id);
+                naive[id].alive = false;
+            }
+        } else if (op < 7) {
+            size_t offset = rng() % (document + 1);
+            size_t length = 1 + rng() % 20;
+            anchors.on_insert(offset, length);
+            for (NaiveAnchor& a : naive) {
+                if (a.offset > offset || (a.offset == offset && a.gravity == Gravity::RIGHT)) a.offset += length;
+            }
+            document += length;
+        } else {
+            size_t offset = rng() % (document + 1);
+            size_t length = std::min<size_t>(rng() % 20, document - offset);
+            anchors.on_erase(offset, length);
+            for (NaiveAnchor& a : naive) {
+                if (a.offset >= offset + length) a.offset -= length;
+                else if (a.offset > offset) a.offset = offset;
+            }
+            document -= length;
+        }
+
+        if (step % 100 == 0) {
+            for (size_t id = 0; id < naive.size(); ++id) {
+                if (naive[id].alive) assert_equals(naive[id].offset, anchors.get(static_cast<AnchorId>(id)));
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#include <iostream>
+#include <string>
+
+#include "test.h"
+
+#include "../src/block_text.h"
+
+
+void test_extract();
+void test_replace();
+void test_large();
+
+int main() {
+    test_extract();
+    test_replace();
+    test_large();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_extract() {
+    assert_equals(std::string("bc\nef\n\njk"), extract_columns("abcd\ndef\n\nijkl", 1, 3));
+    assert_equals(std::string("cd"), extract_columns("abcd", 2, 10));
+
+    // Columns are characters, not bytes
+    assert_equals(std::string("\xc3\xa9\xc3\xa8z\nbcd"), extract_columns("a\xc3\xa9\xc3\xa8z\nabcd", 1, 4));
+}
+
+void test_replace() {
+    assert_equals(std::string("aXd\ndX\n\niXl"), replace_columns("abcd\ndef\n\nijkl", 1, 3, "X"));
+
+    // Zero width inserts, and lines that end before the block are left alone
+    assert_equals(std::string("ab|cd\na\nab|"), replace_columns("abcd\na\nab", 2, 2, "|"));
+    assert_equals(std::string("a-z\na-c"), replace_columns("a\xc3\xa9\xc3\xa8z\nabbc", 1, 3, "-"));
+}
+
+void test_large() {
+    // Dropping the middle column of a CSV
+    std::string csv;
+    std::string expected;
+    for (int i = 0; i < 100000; ++i) {
+        if (i > 0) {
+            csv += '\n';
+            expected += '\n';
+        }
+        csv += "12345,abcde,xyz";
+        expected += "12345,xyz";
+    }
+    assert_equals(expected, replace_columns(csv, 6, 12, ""));
+    assert_equals<size_t>(100000 * 7 - 1, extract_columns(csv, 6, 12).size());
+}
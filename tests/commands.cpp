@@ -37,9 +37,21 @@ void test_delete(Client& c) {
 void test_undo(Client& c) {
     OpenedFile& of = c.get_working_file();
 
+    // Typing without a pause is one undo step
     of.insert_character('A');
     of.insert_character('B');
     of.insert_character('C');
+    assert_equals(std::wstring(L"ABC"), of.get_current_line_contents());
+    of.undo();
+    assert_equals(0, of.get_current_character_index());
+    assert_equals(std::wstring(), of.get_current_line_contents());
+
+    // Closing the group after every keystroke, as moving the cursor does, undoes them one at a time
+    of.insert_character('A');
+    of.close_undo_group();
+    of.insert_character('B');
+    of.close_undo_group();
+    of.insert_character('C');
     
     assert_equals(3, of.get_current_character_index());
     assert_equals(std::wstring(L"ABC"), of.get_current_line_contents());
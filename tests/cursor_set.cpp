@@ -0,0 +1,56 @@
+#include <iostream>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/cursor_set.h"
+
+
+void test_sorted();
+void test_edits();
+
+int main() {
+    test_sorted();
+    test_edits();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_sorted() {
+    CursorSet cursors;
+    assert_equals(true, cursors.empty());
+    cursors.add(30, 20);
+    cursors.add(5, 5);
+    cursors.add(10, 15);
+    assert_equals<size_t>(3, cursors.size());
+
+    // Ordered by start, whichever end the head is at
+    std::vector<CursorSet::Cursor> sorted = cursors.get_sorted();
+    assert_equals<size_t>(5, sorted[0].start());
+    assert_equals<size_t>(10, sorted[1].start());
+    assert_equals<size_t>(20, sorted[2].start());
+    assert_equals<size_t>(30, sorted[2].end());
+    assert_equals<size_t>(20, sorted[2].head);
+
+    cursors.clear();
+    assert_equals<size_t>(0, cursors.get_sorted().size());
+}
+
+void test_edits() {
+    CursorSet cursors;
+    cursors.add(5, 5);
+    cursors.add(10, 15);
+
+    // Text typed at a cursor goes before it
+    cursors.on_insert(5, 3);
+    assert_equals<size_t>(8, cursors.get(0).head);
+    assert_equals<size_t>(13, cursors.get(1).anchor);
+    assert_equals<size_t>(18, cursors.get(1).head);
+
+    // Erasing across a selection's start clips it
+    cursors.on_erase(11, 4);
+    assert_equals<size_t>(11, cursors.get(1).anchor);
+    assert_equals<size_t>(14, cursors.get(1).head);
+    assert_equals<size_t>(8, cursors.get(0).head);
+}
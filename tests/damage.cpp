@@ -0,0 +1,36 @@
+#include <iostream>
+
+#include "test.h"
+
+#include "../src/damage.h"
+
+
+void test_ranges();
+
+int main() {
+    test_ranges();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_ranges() {
+    Damage damage;
+    assert_equals(true, damage.is_empty());
+
+    // Separate lines grow one range covering both
+    damage.add(7);
+    damage.add(3);
+    assert_equals(false, damage.is_empty());
+    assert_equals(3, damage.get_first_line());
+    assert_equals(7, damage.get_last_line());
+
+    damage.add_from(5);
+    assert_equals(3, damage.get_first_line());
+    assert_equals(Damage::TO_END, damage.get_last_line());
+
+    damage.clear();
+    assert_equals(true, damage.is_empty());
+    damage.add_all();
+    assert_equals(0, damage.get_first_line());
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/diff_match_patch.h"
+
+
+void test_diff_main();
+void test_cleanup_merge();
+void test_cleanup_semantic();
+void test_cleanup_efficiency();
+void test_round_trip();
+void test_large_similar();
+
+int main() {
+    test_diff_main();
+    test_cleanup_merge();
+    test_cleanup_semantic();
+    test_cleanup_efficiency();
+    test_round_trip();
+    test_large_similar();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+using Op = Diff::Operation;
+
+void test_diff_main() {
+    diff_match_patch dmp;
+    assert_equals(true, dmp.diff_main("", "", false).empty());
+    assert_equals(true, dmp.diff_main("abc", "ab123c", false)
+        == std::vector<Diff>{Diff(Op::EQUAL, "ab"), Diff(Op::INSERT, "123"), Diff(Op::EQUAL, "c")});
+    assert_equals(true, dmp.diff_main("a123b456c", "abc", false)
+        == std::vector<Diff>{Diff(Op::EQUAL, "a"), Diff(Op::DEL, "123"), Diff(Op::EQUAL, "b"), Diff(Op::DEL, "456"), Diff(Op::EQUAL, "c")});
+
+    // Needs the middle snake rather than only a common prefix and suffix
+    assert_equals(true, dmp.diff_main("cat", "map", false)
+        == std::vector<Diff>{Diff(Op::DEL, "c"), Diff(Op::INSERT, "m"), Diff(Op::EQUAL, "a"), Diff(Op::DEL, "t"), Diff(Op::INSERT, "p")});
+    assert_equals(true, dmp.diff_main("ax\t", "ڀxy", false)
+        == std::vector<Diff>{Diff(Op::DEL, "a"), Diff(Op::INSERT, "ڀ"), Diff(Op::EQUAL, "x"), Diff(Op::DEL, "\t"), Diff(Op::INSERT, "y")});
+
+    // Out of time, the middle is simply replaced
+    std::string a = "`Twas brillig, and the slithy toves\nDid gyre and gimble in the wabe:\nAll mimsy were the borogoves,\nAnd the mome raths outgrabe.\n";
+    std::string b = "I am the very model of a modern major general,\nI've information vegetable, animal, and mineral,\nI know the kings of England, and I quote the fights historical,\nFrom Marathon to Waterloo, in order categorical.\n";
+    for (int i = 0; i < 10; ++i) {
+        a += a;
+        b += b;
+    }
+    dmp.set_diff_timeout(0.0001f);
+    std::vector<Diff> diffs = dmp.diff_main(a, b, false);
+    assert_equals(a, dmp.diff_text1(diffs));
+    assert_equals(b, dmp.diff_text2(diffs));
+}
+
+void test_cleanup_merge() {
+    diff_match_patch dmp;
+    std::vector<Diff> diffs = {Diff(Op::DEL, "a"), Diff(Op::INSERT, "b"), Diff(Op::DEL, "c"), Diff(Op::INSERT, "d"), Diff(Op::EQUAL, "e"), Diff(Op::EQUAL, "f")};
+    dmp.diff_cleanup_merge(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "ac"), Diff(Op::INSERT, "bd"), Diff(Op::EQUAL, "ef")});
+
+    diffs = {Diff(Op::EQUAL, "x"), Diff(Op::DEL, "a"), Diff(Op::INSERT, "abc"), Diff(Op::DEL, "dc"), Diff(Op::EQUAL, "y")};
+    dmp.diff_cleanup_merge(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::EQUAL, "xa"), Diff(Op::DEL, "d"), Diff(Op::INSERT, "b"), Diff(Op::EQUAL, "cy")});
+
+    // Sliding an edit over the equality next to it
+    diffs = {Diff(Op::EQUAL, "a"), Diff(Op::INSERT, "ba"), Diff(Op::EQUAL, "c")};
+    dmp.diff_cleanup_merge(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::INSERT, "ab"), Diff(Op::EQUAL, "ac")});
+    diffs = {Diff(Op::EQUAL, "a"), Diff(Op::DEL, "b"), Diff(Op::EQUAL, "c"), Diff(Op::DEL, "ac"), Diff(Op::EQUAL, "x")};
+    dmp.diff_cleanup_merge(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "abc"), Diff(Op::EQUAL, "acx")});
+}
+
+void test_cleanup_semantic() {
+    diff_match_patch dmp;
+    std::vector<Diff> diffs = {Diff(Op::DEL, "a"), Diff(Op::INSERT, "b"), Diff(Op::EQUAL, "cd"), Diff(Op::DEL, "e")};
+    dmp.diff_cleanup_semantic(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "a"), Diff(Op::INSERT, "b"), Diff(Op::EQUAL, "cd"), Diff(Op::DEL, "e")});
+
+    diffs = {Diff(Op::DEL, "a"), Diff(Op::EQUAL, "b"), Diff(Op::DEL, "c")};
+    dmp.diff_cleanup_semantic(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "abc"), Diff(Op::INSERT, "b")});
+
+    // Edits slide to word boundaries
+    diffs = {Diff(Op::EQUAL, "The c"), Diff(Op::INSERT, "ow and the c"), Diff(Op::EQUAL, "at.")};
+    dmp.diff_cleanup_semantic(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::EQUAL, "The "), Diff(Op::INSERT, "cow and the "), Diff(Op::EQUAL, "cat.")});
+
+    // Overlaps between a deletion and an insertion
+    diffs = {Diff(Op::DEL, "abcxxx"), Diff(Op::INSERT, "xxxdef")};
+    dmp.diff_cleanup_semantic(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "abc"), Diff(Op::EQUAL, "xxx"), Diff(Op::INSERT, "def")});
+    diffs = {Diff(Op::DEL, "xxxabc"), Diff(Op::INSERT, "defxxx")};
+    dmp.diff_cleanup_semantic(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::INSERT, "def"), Diff(Op::EQUAL, "xxx"), Diff(Op::DEL, "abc")});
+}
+
+void test_cleanup_efficiency() {
+    diff_match_patch dmp;
+    std::vector<Diff> diffs = {Diff(Op::DEL, "ab"), Diff(Op::INSERT, "12"), Diff(Op::EQUAL, "wxyz"), Diff(Op::DEL, "cd"), Diff(Op::INSERT, "34")};
+    dmp.diff_cleanup_efficiency(diffs);
+    assert_equals<size_t>(5, diffs.size());
+
+    diffs = {Diff(Op::DEL, "ab"), Diff(Op::INSERT, "12"), Diff(Op::EQUAL, "xyz"), Diff(Op::DEL, "cd"), Diff(Op::INSERT, "34")};
+    dmp.diff_cleanup_efficiency(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "abxyzcd"), Diff(Op::INSERT, "12xyz34")});
+
+    diffs = {Diff(Op::INSERT, "12"), Diff(Op::EQUAL, "x"), Diff(Op::DEL, "cd"), Diff(Op::INSERT, "34")};
+    dmp.diff_cleanup_efficiency(diffs);
+    assert_equals(true, diffs == std::vector<Diff>{Diff(Op::DEL, "xcd"), Diff(Op::INSERT, "12x34")});
+}
+
+void test_round_trip() {
+    // Random edits of random texts, diffed both character by character and line by line
+    diff_match_patch dmp;
+    std::mt19937 random(7);
+    for (int i = 0; i < 300; ++i) {
+        std::string a;
+        size_t length = random() % 400;
+        for (size_t j = 0; j < length; ++j) a += "ab\n c"[random() % 5];
+        std::string b = a;
+        for (int edit = random() % 6; edit > 0 && !b.empty(); --edit) {
+            size_t at = random() % b.size();
+            if (random() % 2) {
+                b.erase(at, random() % 10);
+            } else {
+                b.insert(at, std::string(random() % 10, "xy\n"[random() % 3]));
+            }
+        }
+        std::vector<Diff> diffs = dmp.diff_main(a, b, i % 2 == 0);
+        assert_equals(a, dmp.diff_text1(diffs));
+        assert_equals(b, dmp.diff_text2(diffs));
+    }
+}
+
+void test_large_similar() {
+    // Small edits at both ends of a large text make a small diff
+    std::string a;
+    for (int i = 0; i < 100000; ++i) a += "line " + std::to_string(i) + "\n";
+    std::string b = a;
+    b.replace(b.find("line 10\n"), 8, "line ten\n");
+    b.replace(b.find("line 99990\n"), 11, "");
+    b.replace(b.find("line 50000\n"), 0, "new line\n");
+
+    diff_match_patch dmp;
+    for (bool checklines : {true, false}) {
+        std::vector<Diff> diffs = dmp.diff_main(a, b, checklines);
+        size_t changed = 0;
+        for (const Diff& diff : diffs) {
+            if (diff.operation != Op::EQUAL) changed += diff.text.size();
+        }
+        assert_equals(true, changed < 40);
+        assert_equals(b, dmp.diff_text2(diffs));
+    }
+}
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <string>
+
+#include "test.h"
+
+#include "../src/edit.h"
+
+
+void test_undo_redo();
+void test_spill();
+void test_spill_redo();
+void test_extend();
+void test_joined();
+
+int main() {
+    test_undo_redo();
+    test_spill();
+    test_spill_redo();
+    test_extend();
+    test_joined();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+Edit make_edit(EditType type, uint64_t position) {
+    return {type, true, false, position, 0, 0, 0, 0, 0, 0};
+}
+
+void test_undo_redo() {
+    EditLog log;
+    assert_equals(false, log.can_undo());
+    assert_equals(false, log.can_redo());
+
+    log.push(make_edit(EditType::INSERT, 0), "abc");
+    log.push(make_edit(EditType::ERASE, 1), "b");
+    assert_equals<size_t>(2, log.size());
+
+    const Edit* erased = log.undo();
+    assert_equals(std::string("b"), std::string(log.text_of(*erased)));
+    assert_equals(true, log.can_redo());
+    const Edit* redone = log.redo();
+    assert_equals<uint64_t>(1, redone->position);
+    assert_equals(false, log.can_redo());
+
+    // A new edit after undoing drops the redo tail
+    log.undo();
+    log.push(make_edit(EditType::INSERT, 3), "xyz");
+    assert_equals(false, log.can_redo());
+    assert_equals(std::string("xyz"), std::string(log.text_of(*log.undo())));
+    assert_equals(std::string("abc"), std::string(log.text_of(*log.undo())));
+    assert_equals(false, log.can_undo());
+}
+
+void test_spill() {
+    EditLog log;
+    log.set_memory_limit(4 * sizeof(Edit) + 64);
+    for (int i = 0; i < 1000; ++i) {
+        log.push(make_edit(EditType::INSERT, i), std::to_string(i));
+        assert_equals(true, log.memory_usage() <= 4 * sizeof(Edit) + 64);
+    }
+    assert_equals<size_t>(1000, log.size());
+
+    // Undoing all the way back pages every entry in from the journal in order
+    for (int i = 999; i >= 0; --i) {
+        const Edit* edit = log.undo();
+        assert_equals<uint64_t>(i, edit->position);
+        assert_equals(std::to_string(i), std::string(log.text_of(*edit)));
+    }
+    assert_equals(false, log.can_undo());
+    assert_equals(true, log.undo() == nullptr);
+
+    // Copies have journals of their own
+    for (int i = 0; i < 50; ++i) {
+        log.push(make_edit(EditType::ERASE, i), std::string(i, 'x'));
+    }
+    EditLog copy(log);
+    assert_equals(std::string(49, 'x'), std::string(log.text_of(*log.undo())));
+    for (int i = 49; i >= 0; --i) {
+        assert_equals(std::string(i, 'x'), std::string(copy.text_of(*copy.undo())));
+    }
+    assert_equals(false, copy.can_undo());
+}
+
+void test_spill_redo() {
+    EditLog log;
+    const size_t limit = 4 * sizeof(Edit) + 64;
+    log.set_memory_limit(limit);
+    for (int i = 0; i < 1000; ++i) {
+        log.push(make_edit(EditType::INSERT, i), std::to_string(i));
+    }
+
+    // Undoing far back spills what it leaves behind, so memory stays bounded both ways
+    for (int i = 999; i >= 0; --i) {
+        assert_equals<uint64_t>(i, log.undo()->position);
+        assert_equals(true, log.memory_usage() <= limit);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        assert_equals(true, log.can_redo());
+        const Edit* edit = log.redo();
+        assert_equals<uint64_t>(i, edit->position);
+        assert_equals(std::to_string(i), std::string(log.text_of(*edit)));
+        assert_equals(true, log.memory_usage() <= limit);
+    }
+    assert_equals(false, log.can_redo());
+    assert_equals(true, log.redo() == nullptr);
+
+    // Going back and forth across blocks, and a copy taken halfway, agree on every entry
+    for (int i = 999; i >= 300; --i) log.undo();
+    EditLog copy(log);
+    for (int i = 300; i < 700; ++i) assert_equals<uint64_t>(i, log.redo()->position);
+    for (int i = 699; i >= 500; --i) assert_equals<uint64_t>(i, log.undo()->position);
+    for (int i = 500; i < 1000; ++i) assert_equals<uint64_t>(i, log.redo()->position);
+    for (int i = 300; i < 1000; ++i) assert_equals<uint64_t>(i, copy.redo()->position);
+
+    // A new edit drops the spilled undone entries along with the rest of the redo tail
+    for (int i = 999; i >= 10; --i) log.undo();
+    log.push(make_edit(EditType::ERASE, 5), "x");
+    assert_equals(false, log.can_redo());
+    assert_equals(std::string("x"), std::string(log.text_of(*log.undo())));
+    assert_equals<uint64_t>(5, log.redo()->position);
+    assert_equals(false, log.can_redo());
+}
+
+Edit make_typing_edit(EditType type, uint64_t position, int32_t before, int32_t after) {
+    return {type, true, false, position, 0, 0, 0, before, 0, after};
+}
+
+void test_extend() {
+    EditLog log;
+    assert_equals(false, log.extend(make_typing_edit(EditType::INSERT, 0, 0, 1), "a"));
+
+    // Typing forwards appends to the newest entry
+    log.push(make_typing_edit(EditType::INSERT, 0, 0, 1), "a");
+    assert_equals(true, log.extend(make_typing_edit(EditType::INSERT, 1, 1, 2), "b"));
+    assert_equals(true, log.extend(make_typing_edit(EditType::INSERT, 2, 2, 3), "c"));
+    assert_equals<size_t>(1, log.size());
+
+    // A gap or a cursor jump starts a new entry
+    assert_equals(false, log.extend(make_typing_edit(EditType::INSERT, 5, 3, 4), "d"));
+    assert_equals(false, log.extend(make_typing_edit(EditType::INSERT, 3, 1, 2), "d"));
+
+    // Backspacing prepends
+    log.push(make_typing_edit(EditType::ERASE, 2, 3, 2), "c");
+    assert_equals(true, log.extend(make_typing_edit(EditType::ERASE, 1, 2, 1), "b"));
+    const Edit* erased = log.undo();
+    assert_equals<uint64_t>(1, erased->position);
+    assert_equals(std::string("bc"), std::string(log.text_of(*erased)));
+    assert_equals(3, erased->character_before);
+    assert_equals(1, erased->character_after);
+
+    // Nothing can be merged into an entry that has been undone
+    assert_equals(false, log.extend(make_typing_edit(EditType::INSERT, 3, 3, 4), "d"));
+    assert_equals(std::string("abc"), std::string(log.text_of(*log.undo())));
+}
+
+void test_joined() {
+    EditLog log;
+    log.set_memory_limit(8 * sizeof(Edit) + 64);
+    Edit edit = make_edit(EditType::INSERT, 0);
+    log.push(edit, "a");
+    edit.joins_previous = true;
+    for (int i = 0; i < 100; ++i) {
+        log.push(edit, "b");
+    }
+
+    // The flag survives a trip through the journal
+    int undone = 0;
+    for (const Edit* entry = log.undo(); entry != nullptr && entry->joins_previous; entry = log.undo()) {
+        ++undone;
+    }
+    assert_equals(100, undone);
+    assert_equals(false, log.can_undo());
+
+    assert_equals(false, log.redo()->joins_previous);
+    int redone = 0;
+    while (log.redo_joins_previous()) {
+        log.redo();
+        ++redone;
+    }
+    assert_equals(100, redone);
+    assert_equals(false, log.can_redo());
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/find.h"
+
+
+void test_find_bytes();
+void test_fold_case();
+void test_whole_word();
+void test_finder_against_scan();
+void test_matches_follow_edits();
+
+int main() {
+    test_find_bytes();
+    test_fold_case();
+    test_whole_word();
+    test_finder_against_scan();
+    test_matches_follow_edits();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_find_bytes() {
+    std::mt19937 rng(11);
+    // Small alphabets so that the first and last bytes line up often and the tails of the blocks get used
+    for (int round = 0; round < 300; ++round) {
+        std::string text;
+        size_t length = rng() % 200;
+        for (size_t i = 0; i < length; ++i) text.push_back(static_cast<char>('a' + rng() % 3));
+        std::string needle;
+        size_t needle_length = 1 + rng() % 5;
+        for (size_t i = 0; i < needle_length; ++i) needle.push_back(static_cast<char>('a' + rng() % 3));
+
+        size_t from = rng() % (length + 2);
+        size_t expected = from <= text.size() ? text.find(needle, from) : std::string::npos;
+        if (find_bytes(text, needle, from) != expected) {
+            assert_equals(expected, find_bytes(text, needle, from));
+        }
+    }
+    assert_equals(std::string_view::npos, find_bytes("abc", ""));
+    assert_equals(std::string_view::npos, find_bytes("abc", "abcd"));
+    assert_equals<size_t>(64, find_bytes(std::string(64, 'x') + "needle", "needle"));
+}
+
+void test_fold_case() {
+    std::string text = std::string(40, '.') + "Hello WORLD hello";
+    assert_equals<size_t>(40, find_bytes(text, "hello", 0, true));
+    assert_equals<size_t>(52, find_bytes(text, "hello", 41, true));
+    assert_equals<size_t>(52, find_bytes(text, "hello", 0, false));
+    assert_equals<size_t>(46, find_bytes(text, "world", 0, true));
+
+    PieceTable table(text);
+    assert_equals<size_t>(2, Finder("HELLO", FindOptions{false, false}).find_all(table).size());
+    assert_equals<size_t>(1, Finder("Hello", FindOptions{true, false}).find_all(table).size());
+}
+
+void test_whole_word() {
+    PieceTable table("cat concat cat_x cat. 2cat cat");
+    Finder finder("cat", FindOptions{true, true});
+    std::vector<size_t> found = finder.find_all(table);
+    // Neither the one inside concat, the one before an underscore nor the one after a digit
+    assert_equals<size_t>(3, found.size());
+    assert_equals<size_t>(0, found[0]);
+    assert_equals<size_t>(17, found[1]);
+    assert_equals<size_t>(27, found[2]);
+
+    assert_equals<size_t>(17, finder.find_next(table, 1));
+    assert_equals<size_t>(17, finder.find_previous(table, 27));
+    assert_equals(Finder::NONE, finder.find_previous(table, 0));
+}
+
+void test_finder_against_scan() {
+    std::mt19937 rng(5);
+    // Over a few windows, edited into many pieces so that matches cross both piece and window edges
+    std::string text;
+    while (text.size() < (3u << 20)) {
+        text.append(rng() % 2 ? "needle " : "noodle ");
+        text.append(rng() % 50, 'x');
+    }
+    PieceTable table(text);
+    for (int i = 0; i < 2000; ++i) {
+        size_t offset = rng() % table.length();
+        table.insert(offset, rng() % 4 ? "ne" : "edle");
+    }
+    std::string contents = table.get_text();
+
+    Finder finder("needle", FindOptions{true, false});
+    std::vector<size_t> expected;
+    for (size_t found = contents.find("needle"); found != std::string::npos; found = contents.find("needle", found + 6)) {
+        expected.push_back(found);
+    }
+    std::vector<size_t> found = finder.find_all(table);
+    assert_equals(expected.size(), found.size());
+    assert_equals(true, expected == found);
+
+    for (int i = 0; i < 50; ++i) {
+        size_t offset = rng() % contents.size();
+        size_t next = contents.find("needle", offset);
+        assert_equals(next == std::string::npos ? Finder::NONE : next, finder.find_next(table, offset));
+        size_t previous = offset == 0 ? std::string::npos : contents.rfind("needle", offset - 1);
+        assert_equals(previous == std::string::npos ? Finder::NONE : previous, finder.find_previous(table, offset));
+    }
+}
+
+void test_matches_follow_edits() {
+    MatchSet matches;
+    matches.add(10, 15);
+    matches.add(20, 25);
+    matches.add(40, 45);
+
+    // Typing at the edge of a match leaves it as it was, typing before it moves it
+    matches.on_insert(15, 3);
+    matches.on_insert(0, 2);
+    std::vector<std::pair<size_t, size_t>> found = matches.get_in(0, 100);
+    assert_equals<size_t>(3, found.size());
+    assert_equals<size_t>(12, found[0].first);
+    assert_equals<size_t>(17, found[0].second);
+    assert_equals<size_t>(25, found[1].first);
+
+    // Erased matches are left out, and only the ones overlapping the span are returned
+    matches.on_erase(24, 8);
+    found = matches.get_in(16, 60);
+    assert_equals<size_t>(2, found.size());
+    assert_equals<size_t>(12, found[0].first);
+    assert_equals<size_t>(37, found[1].first);
+    assert_equals<size_t>(0, matches.get_in(18, 37).size());
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/formatting.h"
+
+
+void test_add_remove();
+void test_edits();
+void test_erased_ranges();
+void test_queries_against_scan();
+
+int main() {
+    test_add_remove();
+    test_edits();
+    test_erased_ranges();
+    test_queries_against_scan();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_add_remove() {
+    FormattingManager manager;
+    manager.add_formatting(2, 5, FormatType::BOLD);
+    manager.add_formatting(2, 5, FormatType::BOLD);
+    manager.add_formatting(2, 5, FormatType::ITALIC);
+    assert_equals<size_t>(2, manager.size());
+
+    assert_equals<size_t>(0, manager.get_formatting_at(1).size());
+    assert_equals<size_t>(2, manager.get_formatting_at(2).size());
+    assert_equals<size_t>(0, manager.get_formatting_at(5).size());
+
+    manager.remove_formatting(2, 5, FormatType::BOLD);
+    std::vector<FormatSpan> left = manager.get_formatting_at(3);
+    assert_equals<size_t>(1, left.size());
+    assert_equals(true, left[0].type == FormatType::ITALIC);
+
+    manager.clear_formatting();
+    assert_equals<size_t>(0, manager.get_all_ranges().size());
+}
+
+void test_edits() {
+    FormattingManager manager;
+    manager.add_formatting(10, 20, FormatType::BOLD);
+
+    // Text typed at either edge stays outside the range
+    manager.on_insert(10, 3);
+    manager.on_insert(23, 2);
+    std::vector<FormatSpan> spans = manager.get_all_ranges();
+    assert_equals<size_t>(13, spans[0].start);
+    assert_equals<size_t>(23, spans[0].end);
+
+    // Text typed inside grows it, and erasing across the start clips it
+    manager.on_insert(15, 5);
+    manager.on_erase(11, 4);
+    spans = manager.get_all_ranges();
+    assert_equals<size_t>(11, spans[0].start);
+    assert_equals<size_t>(24, spans[0].end);
+
+    manager.remove_formatting(11, 24, FormatType::BOLD);
+    assert_equals<size_t>(0, manager.size());
+}
+
+void test_erased_ranges() {
+    FormattingManager manager;
+    manager.add_formatting(2, 4, FormatType::BOLD);
+    manager.add_formatting(3, 4, FormatType::ITALIC);
+    manager.add_formatting(3, 8, FormatType::UNDERLINE);
+    manager.add_formatting(8, 9, FormatType::HIGHLIGHT);
+
+    // Erasing all of a range removes it, erasing part of one clips it
+    manager.on_erase(2, 3);
+    std::vector<FormatSpan> spans = manager.get_all_ranges();
+    assert_equals<size_t>(2, manager.size());
+    assert_equals<size_t>(2, spans.size());
+    assert_equals(true, spans[0].type == FormatType::UNDERLINE);
+    assert_equals<size_t>(2, spans[0].start);
+    assert_equals<size_t>(5, spans[0].end);
+
+    // Text inserted where a range was erased is not formatted, and nothing ends before it starts
+    manager.on_erase(0, 5);
+    manager.on_insert(0, 3);
+    spans = manager.get_all_ranges();
+    assert_equals<size_t>(0, manager.get_formatting_at(0).size());
+    assert_equals<size_t>(1, spans.size());
+    assert_equals(true, spans[0].type == FormatType::HIGHLIGHT);
+    assert_equals<size_t>(3, spans[0].start);
+    assert_equals<size_t>(4, spans[0].end);
+
+    // Erasing everything leaves nothing behind, and the manager still works afterwards
+    manager.on_erase(0, 4);
+    assert_equals<size_t>(0, manager.size());
+    assert_equals<size_t>(0, manager.get_all_ranges().size());
+    manager.on_insert(0, 5);
+    assert_equals<size_t>(0, manager.get_formatting_at(0).size());
+    manager.add_formatting(1, 3, FormatType::BOLD);
+    assert_equals<size_t>(1, manager.get_formatting_at(2).size());
+}
+
+void test_queries_against_scan() {
+    FormattingManager manager;
+    std::mt19937 rng(7);
+
+    for (int i = 0; i < 2000; ++i) {
+        size_t start = rng() % 5000;
+        size_t end = start + 1 + rng() % 200;
+        manager.add_formatting(start, end, static_cast<FormatType>(rng() % 4));
+    }
+    // Shift everything around; the naive copy below is taken afterwards
+    for (int i = 0; i < 500; ++i) {
+        size_t offset = rng() % 5000;
+        if (rng() % 2) {
+            manager.on_insert(offset, 1 + rng() % 30);
+        } else {
+            manager.on_erase(offset, 1 + rng() % 30);
+        }
+    }
+
+    // Remove every third range again
+    std::vector<FormatSpan> all = manager.get_all_ranges();
+    std::vector<FormatSpan> remaining;
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (i % 3 == 0) {
+            manager.remove_formatting(all[i].start, all[i].end, all[i].type);
+        } else {
+            remaining.push_back(all[i]);
+        }
+    }
+    assert_equals(remaining.size(), manager.get_all_ranges().size());
+
+    for (size_t offset = 0; offset < 6000; offset += 37) {
+        size_t expected_at = 0;
+        size_t expected_in = 0;
+        for (const FormatSpan& span : remaining) {
+            if (span.start <= offset && offset < span.end) ++expected_at;
+            if (span.start <= offset + 50 && span.end > offset) ++expected_in;
+        }
+        assert_equals(expected_at, manager.get_formatting_at(offset).size());
+        assert_equals(expected_in, manager.get_formatting_in(offset, offset + 50).size());
+    }
+}
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/key_dispatch.h"
+
+
+void test_first_binding_wins();
+void test_sequences();
+void test_many_bindings();
+
+int main() {
+    test_first_binding_wins();
+    test_sequences();
+    test_many_bindings();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+using Clock = std::chrono::steady_clock;
+
+KeyState chord(const std::string& text) {
+    KeyState result;
+    parse_chord(text, result);
+    return result;
+}
+
+std::vector<KeyState> sequence(const std::string& text) {
+    std::vector<KeyState> result;
+    parse_key_sequence(text, chord("Ctrl+Space"), result);
+    return result;
+}
+
+void test_first_binding_wins() {
+    std::vector<Command> commands;
+    commands.emplace_back("Undo", "", "UNDO", std::vector<char>{Key::CONTROL, 'Z'}, std::vector<Action>{{ActionCode::UNDO, {}}});
+    commands.emplace_back("Also Undo", "", "REDO", std::vector<char>{'Z', Key::CONTROL}, std::vector<Action>{{ActionCode::REDO, {}}});
+    commands.emplace_back("Redo", "", "REDO", std::vector<char>{Key::CONTROL, 'Y'}, std::vector<Action>{{ActionCode::REDO, {}}});
+
+    KeyDispatcher dispatcher;
+    dispatcher.build(commands);
+    assert_equals<size_t>(2, dispatcher.size());
+
+    size_t found = dispatcher.press(chord("Ctrl+Z"), Clock::now());
+    assert_equals<size_t>(0, found);
+    assert_equals(true, commands[found].get_program()[0].code == ActionCode::UNDO);
+
+    // Extra keys held down make a different chord
+    assert_equals(KeyDispatcher::NONE, dispatcher.press(chord("Ctrl+Shift+Z"), Clock::now()));
+    assert_equals(false, dispatcher.is_pending());
+}
+
+void test_sequences() {
+    std::vector<Command> commands;
+    commands.emplace_back("Comment", "", "", sequence("Ctrl+K Ctrl+C"), std::vector<Action>());
+    commands.emplace_back("Uncomment", "", "", sequence("Ctrl+K Ctrl+U"), std::vector<Action>());
+    commands.emplace_back("Find", "", "", sequence("Leader F"), std::vector<Action>());
+    commands.emplace_back("Copy", "", "", sequence("Ctrl+C"), std::vector<Action>());
+
+    KeyDispatcher dispatcher;
+    dispatcher.set_timeout(std::chrono::milliseconds(500));
+    dispatcher.build(commands);
+    Clock::time_point now = Clock::now();
+
+    assert_equals(KeyDispatcher::NONE, dispatcher.press(chord("Ctrl+K"), now));
+    assert_equals(true, dispatcher.is_pending());
+    // Releasing and pressing control again keeps the sequence going
+    assert_equals(KeyDispatcher::NONE, dispatcher.press(chord("Ctrl"), now));
+    assert_equals<size_t>(1, dispatcher.press(chord("Ctrl+U"), now));
+    assert_equals(false, dispatcher.is_pending());
+
+    assert_equals(KeyDispatcher::NONE, dispatcher.press(chord("Ctrl+Space"), now));
+    assert_equals<size_t>(2, dispatcher.press(chord("F"), now));
+
+    // Sequences time out, after which the chord is matched on its own
+    dispatcher.press(chord("Ctrl+K"), now);
+    assert_equals<size_t>(0, dispatcher.press(chord("Ctrl+C"), now + std::chrono::milliseconds(400)));
+    dispatcher.press(chord("Ctrl+K"), now);
+    assert_equals<size_t>(3, dispatcher.press(chord("Ctrl+C"), now + std::chrono::milliseconds(600)));
+
+    // So is a chord that breaks a sequence
+    dispatcher.press(chord("Ctrl+K"), now);
+    assert_equals(KeyDispatcher::NONE, dispatcher.press(chord("Ctrl+X"), now));
+    assert_equals(false, dispatcher.is_pending());
+}
+
+void test_many_bindings() {
+    // Every pair of letters after control, the way a heavily customized setup might look
+    std::vector<Command> commands;
+    for (char a = 'A'; a <= 'Z'; ++a) {
+        for (char b = 'A'; b <= 'Z'; ++b) {
+            commands.emplace_back(std::string{a, b}, "", "", sequence(std::string("Ctrl+") + a + " " + b), std::vector<Action>());
+        }
+    }
+    KeyDispatcher dispatcher;
+    dispatcher.build(commands);
+    assert_equals(commands.size(), dispatcher.size());
+
+    for (size_t i = 0; i < commands.size(); i += 17) {
+        const std::vector<KeyState>& keys = commands[i].get_key_sequence();
+        assert_equals(KeyDispatcher::NONE, dispatcher.press(keys[0], Clock::now()));
+        assert_equals(i, dispatcher.press(keys[1], Clock::now()));
+    }
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/keys.h"
+
+
+void test_normalize_modifiers();
+void test_chords();
+void test_sequences();
+
+int main() {
+    test_normalize_modifiers();
+    test_chords();
+    test_sequences();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_normalize_modifiers() {
+    KeyState down{};
+    down[Key::RCONTROL] = true;
+    down[Key::LSHIFT] = true;
+    down['Z'] = true;
+    normalize_modifiers(down);
+
+    KeyState expected{};
+    expected[Key::CONTROL] = true;
+    expected[Key::SHIFT] = true;
+    expected['Z'] = true;
+    assert_equals(true, down == expected);
+    assert_equals(false, is_modifier_only(down));
+    down.reset('Z');
+    assert_equals(true, is_modifier_only(down));
+}
+
+void test_chords() {
+    KeyState chord;
+    assert_equals(true, parse_chord("shift+ctrl+h", chord));
+    assert_equals(std::string("Ctrl+Shift+H"), chord_string(chord));
+
+    assert_equals(true, parse_chord("Alt+F12", chord));
+    assert_equals(std::string("Alt+F12"), chord_string(chord));
+    assert_equals(true, parse_chord("Ctrl+0xBA", chord));
+    assert_equals(std::string("Ctrl+0xBA"), chord_string(chord));
+
+    assert_equals(false, parse_chord("Ctrl+Banana", chord));
+    assert_equals(false, parse_chord("", chord));
+}
+
+void test_sequences() {
+    KeyState leader;
+    parse_chord("Ctrl+Space", leader);
+
+    std::vector<KeyState> sequence;
+    assert_equals(true, parse_key_sequence("Ctrl+K  Ctrl+C", leader, sequence));
+    assert_equals<size_t>(2, sequence.size());
+    assert_equals(std::string("Ctrl+K Ctrl+C"), key_sequence_string(sequence, leader));
+
+    assert_equals(true, parse_key_sequence("leader f", leader, sequence));
+    assert_equals(true, sequence[0] == leader);
+    assert_equals(std::string("Leader F"), key_sequence_string(sequence, leader));
+
+    assert_equals(false, parse_key_sequence("   ", leader, sequence));
+
+    // The old format is still read
+    std::string old(256, '0');
+    old[Key::CONTROL] = '1';
+    old['S'] = '1';
+    assert_equals(true, is_key_string(old));
+    assert_equals(std::string("Ctrl+S"), chord_string(parse_key_string(old)));
+}
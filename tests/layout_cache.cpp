@@ -0,0 +1,106 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/layout_cache.h"
+
+
+/// @brief Headless shaper that only records what it was asked to shape.
+class CountingShaper : public TextShaper {
+public:
+    struct Layout : TextLayout {
+        std::wstring text;
+    };
+
+    std::unique_ptr<TextLayout> shape(std::wstring_view text, const std::vector<FormatRange>&,
+                                      const LayoutStyle&) override {
+        ++shaped;
+        auto layout = std::make_unique<Layout>();
+        layout->text = text;
+        return layout;
+    }
+
+    size_t shaped = 0;
+};
+
+void test_reuse();
+void test_typing_reshapes_one_line();
+void test_eviction();
+
+int main() {
+    test_reuse();
+    test_typing_reshapes_one_line();
+    test_eviction();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+const LayoutStyle STYLE{L"Consolas", 14.0f, 800.0f, 20.0f};
+
+void test_reuse() {
+    CountingShaper shaper;
+    LayoutCache cache;
+    std::vector<FormatRange> none;
+    std::vector<FormatRange> bold{FormatRange(0, 0, 0, 3, FormatType::BOLD)};
+
+    cache.get(shaper, L"hello", none, STYLE);
+    cache.get(shaper, L"hello", none, STYLE);
+    assert_equals<size_t>(1, shaper.shaped);
+
+    // Formatting and style are part of the key
+    cache.get(shaper, L"hello", bold, STYLE);
+    cache.get(shaper, L"hello", none, {L"Consolas", 16.0f, 800.0f, 20.0f});
+    assert_equals<size_t>(3, shaper.shaped);
+
+    const TextLayout& layout = cache.get(shaper, L"hello", bold, STYLE);
+    assert_equals(std::wstring(L"hello"), static_cast<const CountingShaper::Layout&>(layout).text);
+    assert_equals<size_t>(3, shaper.shaped);
+    assert_equals<size_t>(2, cache.get_hits());
+}
+
+void test_typing_reshapes_one_line() {
+    CountingShaper shaper;
+    LayoutCache cache;
+    std::vector<FormatRange> none;
+    std::vector<std::wstring> lines;
+    for (int i = 0; i < 50; ++i) lines.push_back(L"line " + std::to_wstring(i));
+
+    auto draw_frame = [&]() {
+        for (const std::wstring& line : lines) cache.get(shaper, line, none, STYLE);
+    };
+    draw_frame();
+    assert_equals<size_t>(50, shaper.shaped);
+
+    // Each keystroke changes one line, so each frame shapes one line
+    for (wchar_t c : std::wstring(L"typed")) {
+        lines[20] += c;
+        draw_frame();
+    }
+    assert_equals<size_t>(55, shaper.shaped);
+}
+
+void test_eviction() {
+    CountingShaper shaper;
+    LayoutCache cache(3);
+    std::vector<FormatRange> none;
+
+    cache.get(shaper, L"a", none, STYLE);
+    cache.get(shaper, L"b", none, STYLE);
+    cache.get(shaper, L"c", none, STYLE);
+    cache.get(shaper, L"a", none, STYLE); // b is now the least recently used
+    cache.get(shaper, L"d", none, STYLE);
+    assert_equals<size_t>(3, cache.size());
+    assert_equals<size_t>(4, shaper.shaped);
+
+    cache.get(shaper, L"a", none, STYLE);
+    assert_equals<size_t>(4, shaper.shaped);
+    cache.get(shaper, L"b", none, STYLE);
+    assert_equals<size_t>(5, shaper.shaped);
+
+    cache.clear();
+    assert_equals<size_t>(0, cache.size());
+}
@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/line_index.h"
+
+
+void test_scan();
+void test_parallel();
+
+int main() {
+    test_scan();
+    test_parallel();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+std::vector<size_t> naive_line_breaks(const std::string& text) {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\n') result.push_back(i);
+    }
+    return result;
+}
+
+void test_scan() {
+    // Breaks on both sides of every SIMD block boundary
+    std::string text(200, 'a');
+    for (size_t i : {0, 15, 16, 31, 32, 63, 64, 65, 127, 199}) {
+        text[i] = '\n';
+    }
+    std::vector<size_t> breaks;
+    scan_line_breaks(text.data(), text.size(), 0, breaks);
+    assert_equals(naive_line_breaks(text).size(), breaks.size());
+    assert_equals(true, naive_line_breaks(text) == breaks);
+
+    // Unaligned start and a base offset
+    breaks.clear();
+    scan_line_breaks(text.data() + 1, text.size() - 1, 1, breaks);
+    assert_equals(static_cast<size_t>(15), breaks.front());
+    assert_equals(static_cast<size_t>(9), breaks.size());
+}
+
+void test_parallel() {
+    std::string text;
+    while (text.size() < 3 * LINE_INDEX_MIN_CHUNK) {
+        text.append(text.size() % 97, 'b');
+        text += (text.size() % 2) ? "\r\n" : "\n";
+    }
+    assert_equals(true, naive_line_breaks(text) == build_line_index(text.data(), text.size(), 4));
+    assert_equals(true, naive_line_breaks(text) == build_line_index(text.data(), text.size(), 1));
+}
@@ -0,0 +1,375 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "test.h"
+
+#include "../src/config.h"
+#include "../src/line_index.h"
+#include "../src/opened_file.h"
+#include "../src/recording_renderer.h"
+
+
+void test_mixed_line_endings();
+void test_first_paint();
+void test_typing_groups();
+void test_paste();
+void test_gutter_damage();
+void test_macro_replay();
+void test_multiple_cursors();
+void test_block_edits();
+void test_word_rules();
+
+int main() {
+    Config::create();
+    test_mixed_line_endings();
+    test_first_paint();
+    test_typing_groups();
+    test_paste();
+    test_gutter_damage();
+    test_macro_replay();
+    test_multiple_cursors();
+    test_block_edits();
+    test_word_rules();
+    Config::destroy();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+std::string write_temp(const std::string& name, const std::string& contents) {
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream(path, std::ios::binary) << contents;
+    return path;
+}
+
+void test_mixed_line_endings() {
+    // Only later lines end in CRLF, which the mapped open has to notice as well
+    std::string path = write_temp("speedy_opened_file_crlf.txt", "first\nsecond\r\nthird\r\n");
+    OpenedFile file(path);
+    assert_equals(std::wstring(L"second"), file.get_line_contents(1));
+    assert_equals(std::string("first\nsecond\nthird"), file.get_contents());
+
+    // A lone carriage return is text and keeps the file mapped as it is
+    std::string lone = write_temp("speedy_opened_file_cr.txt", "a\rb\nc\n");
+    OpenedFile mapped(lone);
+    assert_equals(std::string("a\rb\nc"), mapped.get_contents());
+    assert_equals(true, mapped.has_contents("a\rb\nc\n"));
+    assert_equals(false, mapped.has_contents("a\rb\nd\n"));
+    std::filesystem::remove(path);
+    std::filesystem::remove(lone);
+}
+
+void test_first_paint() {
+    std::string contents;
+    while (contents.size() < 4 * LINE_INDEX_MIN_CHUNK) contents += "line " + std::to_string(contents.size()) + "\n";
+    std::string path = write_temp("speedy_opened_file_paint.txt", contents);
+
+    // Drawing the top of a mapped file, and moving the cursor there, only indexes the first chunk of it
+    {
+        OpenedFile file(path);
+        file.get_viewport().resize(40, 80);
+        RecordingRenderer renderer;
+        renderer.BeginDraw();
+        file.draw(&renderer);
+        renderer.EndDraw();
+        assert_equals(true, file.has_line(1));
+        file.set_current_line(5);
+        assert_equals(LINE_INDEX_MIN_CHUNK, file.get_text().get_indexed_length());
+    }
+    std::filesystem::remove(path);
+}
+
+void type(OpenedFile& file, const std::string& characters) {
+    for (char c : characters) file.insert_character(c);
+}
+
+void test_typing_groups() {
+    std::string path = write_temp("speedy_opened_file_typing.txt", "\n");
+    Config::get_instance()->set_undo_group_timeout(1000);
+
+    // A word and the space after it undo together, the next word starts a new step
+    OpenedFile file(path);
+    type(file, "hello world");
+    file.undo();
+    assert_equals(std::string("hello "), file.get_contents());
+    file.undo();
+    assert_equals(std::string(""), file.get_contents());
+
+    // Backspacing goes the other way: a word and the space before it, then the next word
+    file.redo();
+    file.redo();
+    file.set_current_character(11);
+    for (int i = 0; i < 7; ++i) file.delete_character();
+    assert_equals(std::string("hell"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("hello"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("hello world"), file.get_contents());
+
+    // Moving the cursor closes the group, even inside a word
+    file.set_current_character(5);
+    type(file, "ab");
+    file.set_current_character(7);
+    type(file, "c");
+    file.undo();
+    assert_equals(std::string("helloab world"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("hello world"), file.get_contents());
+
+    // So does a pause longer than the timeout
+    Config::get_instance()->set_undo_group_timeout(20);
+    file.set_current_character(0);
+    type(file, "x");
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    type(file, "y");
+    file.undo();
+    assert_equals(std::string("xhello world"), file.get_contents());
+    Config::get_instance()->set_undo_group_timeout(1000);
+    std::filesystem::remove(path);
+}
+
+void test_paste() {
+    std::string path = write_temp("speedy_opened_file_paste.txt", "ab\ncd\n");
+
+    // Several lines with CRLF and a tab, undone in one step back to where the cursor was
+    OpenedFile file(path);
+    file.set_current_character(1);
+    file.insert_text(L"x\r\ny\n\tz");
+    assert_equals(std::string("ax\ny\n    zb\ncd"), file.get_contents());
+    assert_equals(2, file.get_current_line());
+    assert_equals(5, file.get_current_character_index());
+    file.undo();
+    assert_equals(std::string("ab\ncd"), file.get_contents());
+    assert_equals(0, file.get_current_line());
+    assert_equals(1, file.get_current_character_index());
+
+    // Over a selection, the selection and the paste are one step
+    file.set_current_character(1);
+    file.start_selection();
+    file.set_current_line(1);
+    file.set_current_character(1);
+    file.update_selection();
+    file.insert_text(L"Q");
+    assert_equals(std::string("aQd"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("ab\ncd"), file.get_contents());
+    file.redo();
+    assert_equals(std::string("aQd"), file.get_contents());
+    std::filesystem::remove(path);
+}
+
+void test_gutter_damage() {
+    std::string contents;
+    for (int i = 1; i <= 9999; ++i) contents += std::to_string(i) + "\n";
+    std::string path = write_temp("speedy_opened_file_gutter.txt", contents);
+
+    // The end of a file of 9999 lines, whose numbers fit in the gutter's 4 digits, with room below it
+    OpenedFile file(path);
+    file.get_viewport().resize(40, 80);
+    file.get_viewport().scroll_to(10018, 0);
+    file.set_current_line(9998);
+    file.clear_damage();
+
+    // Typing only damages the line typed on
+    file.set_current_character(2);
+    file.insert_text(L"x");
+    assert_equals(9998, file.get_damage().get_first_line());
+    file.clear_damage();
+
+    // Line 10000 needs a fifth digit, which moves the text of every line on screen
+    file.insert_text(L"\n");
+    assert_equals(0, file.get_damage().get_first_line());
+    file.clear_damage();
+    file.undo();
+    assert_equals(0, file.get_damage().get_first_line());
+    std::filesystem::remove(path);
+}
+
+void test_macro_replay() {
+    std::string path = write_temp("speedy_opened_file_macro.txt", "a\nb\nc\nd\n");
+    // What a recorded macro does: type, then add a line
+    auto macro = [](OpenedFile& file) {
+        type(file, "x");
+        file.insert_text(L"\n");
+    };
+
+    // Replaying it several times in a batch is undone in one step
+    OpenedFile file(path);
+    file.begin_batch();
+    for (int i = 0; i < 3; ++i) macro(file);
+    file.end_batch();
+    assert_equals(std::string("x\nx\nx\na\nb\nc\nd"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("a\nb\nc\nd"), file.get_contents());
+    assert_equals(0, file.get_current_line());
+    assert_equals(0, file.get_current_character_index());
+
+    // On the selected lines, the lines the macro adds are stepped over
+    file.start_selection();
+    file.set_current_line(2);
+    file.set_current_character(1);
+    file.update_selection();
+    file.for_each_selected_line([&] { macro(file); });
+    assert_equals(std::string("x\na\nx\nb\nx\nc\nd"), file.get_contents());
+    assert_equals(false, file.get_selection().has_selection());
+    file.undo();
+    assert_equals(std::string("a\nb\nc\nd"), file.get_contents());
+    file.redo();
+    assert_equals(std::string("x\na\nx\nb\nx\nc\nd"), file.get_contents());
+
+    // Up to the last line, and a macro that only types leaves the line count alone
+    file.set_current_line(0);
+    file.set_current_character(0);
+    file.start_selection();
+    file.set_current_line(6);
+    file.set_current_character(1);
+    file.update_selection();
+    file.for_each_selected_line([&] { type(file, "> "); });
+    assert_equals(std::string("> x\n> a\n> x\n> b\n> x\n> c\n> d"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("x\na\nx\nb\nx\nc\nd"), file.get_contents());
+    std::filesystem::remove(path);
+}
+
+void test_multiple_cursors() {
+    std::string path = write_temp("speedy_opened_file_cursors.txt", "abc\nabc\nabc\n");
+
+    // Typing at three cursors puts the text after each of them, and one undo takes it all back
+    OpenedFile file(path);
+    file.set_current_character(1);
+    file.add_cursor(1, 1);
+    file.add_cursor(2, 1);
+    file.insert_at_cursors("X");
+    assert_equals(std::string("aXbc\naXbc\naXbc"), file.get_contents());
+    assert_equals(2, file.get_current_character_index());
+    std::vector<CursorSet::Cursor> cursors = file.get_cursors().get_sorted();
+    assert_equals<size_t>(2, cursors.size());
+    assert_equals<size_t>(7, cursors[0].head);
+    assert_equals<size_t>(12, cursors[1].head);
+    file.insert_at_cursors("Y");
+    assert_equals(std::string("aXYbc\naXYbc\naXYbc"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("aXbc\naXbc\naXbc"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("abc\nabc\nabc"), file.get_contents());
+    assert_equals(0, file.get_current_line());
+    assert_equals(1, file.get_current_character_index());
+    file.redo();
+    assert_equals(std::string("aXbc\naXbc\naXbc"), file.get_contents());
+
+    // Backspace stays within each line and never erases a character twice for cursors next to each other
+    file.clear_cursors();
+    file.set_current_line(0);
+    file.set_current_character(2);
+    file.add_cursor(0, 1);
+    file.add_cursor(1, 0);
+    file.backspace_at_cursors();
+    assert_equals(std::string("bc\naXbc\naXbc"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("aXbc\naXbc\naXbc"), file.get_contents());
+
+    // A cursor inside another's selection is merged with it, so the selected text is erased once
+    file.clear_cursors();
+    file.set_current_line(0);
+    file.set_current_character(0);
+    file.start_selection();
+    file.set_current_character(3);
+    file.update_selection();
+    file.add_cursor(0, 2);
+    file.add_cursor(1, 4);
+    file.backspace_at_cursors();
+    assert_equals(std::string("c\naXb\naXbc"), file.get_contents());
+    assert_equals(0, file.get_current_character_index());
+    assert_equals<size_t>(1, file.get_cursors().size());
+    file.undo();
+    assert_equals(std::string("aXbc\naXbc\naXbc"), file.get_contents());
+    assert_equals(3, file.get_current_character_index());
+    std::filesystem::remove(path);
+}
+
+void select_block(OpenedFile& file, int first_line, int first_column, int last_line, int last_column) {
+    file.set_current_line(first_line);
+    file.set_current_character(first_column);
+    file.start_selection();
+    file.set_current_line(last_line);
+    file.set_current_character(last_column);
+    file.update_selection();
+    file.set_block_selection(true);
+}
+
+void test_block_edits() {
+    std::string path = write_temp("speedy_opened_file_block.txt", "abcd\nab\nabcd\n");
+
+    // Typing into a zero width block types on every line, and the block stays after the text
+    OpenedFile file(path);
+    select_block(file, 0, 2, 2, 2);
+    file.insert_at_cursors("X");
+    file.insert_at_cursors("Y");
+    assert_equals(std::string("abXYcd\nabXY\nabXYcd"), file.get_contents());
+    assert_equals(true, file.has_block_selection());
+    int first_line, last_line, first_column, last_column;
+    file.get_block_range(first_line, last_line, first_column, last_column);
+    assert_equals(0, first_line);
+    assert_equals(2, last_line);
+    assert_equals(4, first_column);
+    assert_equals(4, last_column);
+
+    // Each keystroke is one step, which puts the cursor back where it was
+    file.undo();
+    assert_equals(std::string("abXcd\nabX\nabXcd"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("abcd\nab\nabcd"), file.get_contents());
+    assert_equals(2, file.get_current_line());
+    assert_equals(2, file.get_current_character_index());
+
+    // Deleting a column leaves lines that end before it alone and shortens those that end inside it
+    file.clear_selection();
+    select_block(file, 0, 1, 2, 3);
+    file.backspace_at_cursors();
+    assert_equals(std::string("ad\na\nad"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("abcd\nab\nabcd"), file.get_contents());
+
+    // Backspace in a zero width block erases the column before it, skipping lines too short for it
+    file.clear_selection();
+    select_block(file, 0, 3, 2, 3);
+    file.backspace_at_cursors();
+    assert_equals(std::string("abd\nab\nabd"), file.get_contents());
+    file.undo();
+    assert_equals(std::string("abcd\nab\nabcd"), file.get_contents());
+    file.redo();
+    assert_equals(std::string("abd\nab\nabd"), file.get_contents());
+    std::filesystem::remove(path);
+}
+
+void test_word_rules() {
+    // Curly quotes, an em dash and a no-break space around and between the words
+    std::string path = write_temp("speedy_opened_file_words.txt",
+                                  "say \xE2\x80\x9Cword\xE2\x80\x9D\xE2\x80\x94word\xC2\xA0" "again\n");
+
+    // Finding the word at the cursor leaves out the punctuation around it
+    OpenedFile file(path);
+    file.set_current_character(6);
+    assert_equals<size_t>(2, file.find_selection(FindOptions{true, true}));
+    assert_equals(std::wstring(L"word"), file.get_selected_text());
+    file.clear_selection();
+    file.set_current_character(17);
+    assert_equals<size_t>(1, file.find_selection(FindOptions{true, true}));
+    assert_equals(std::wstring(L"again"), file.get_selected_text());
+    file.clear_selection();
+
+    // A word typed after a guillemet is its own undo step, as it would be after a space
+    file.set_current_line(0);
+    file.set_current_character(0);
+    type(file, "\xAB");
+    type(file, "ab");
+    file.undo();
+    assert_equals(std::wstring(L"\u00ABsay \u201Cword\u201D\u2014word\u00A0again"), file.get_line_contents(0));
+    file.undo();
+    assert_equals(std::wstring(L"say \u201Cword\u201D\u2014word\u00A0again"), file.get_line_contents(0));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/line_index.h"
+#include "../src/piece_table.h"
+
+
+void test_insert_erase();
+void test_lines();
+void test_many_edits();
+void test_mapped();
+void test_line_view();
+void test_lazy_index();
+void test_mapped_crlf();
+
+int main() {
+    test_insert_erase();
+    test_lines();
+    test_many_edits();
+    test_mapped();
+    test_line_view();
+    test_lazy_index();
+    test_mapped_crlf();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_insert_erase() {
+    PieceTable table("Hello world");
+
+    table.insert(5, ",");
+    assert_equals(std::string("Hello, world"), table.get_text());
+    table.insert(table.length(), "!");
+    assert_equals(std::string("Hello, world!"), table.get_text());
+    table.erase(0, 7);
+    assert_equals(std::string("world!"), table.get_text());
+    table.insert(0, "big ");
+    assert_equals(std::string("big world!"), table.get_text());
+    assert_equals(std::string(1, 'w'), std::string(1, table.char_at(4)));
+    table.erase(3, 100);
+    assert_equals(std::string("big"), table.get_text());
+}
+
+void test_lines() {
+    PieceTable table("first\nsecond\nthird");
+
+    assert_equals(static_cast<size_t>(3), table.line_count());
+    assert_equals(std::string("second"), table.get_line(1));
+    assert_equals(static_cast<size_t>(13), table.line_start(2));
+
+    // Split the middle line
+    table.insert(table.line_start(1) + 3, "\n");
+    assert_equals(static_cast<size_t>(4), table.line_count());
+    assert_equals(std::string("sec"), table.get_line(1));
+    assert_equals(std::string("ond"), table.get_line(2));
+
+    // Join it back together along with the next line
+    table.erase(table.line_start(1) + 3, 1);
+    table.erase(table.line_start(1) + 6, 1);
+    assert_equals(static_cast<size_t>(2), table.line_count());
+    assert_equals(std::string("secondthird"), table.get_line(1));
+    assert_equals(static_cast<size_t>(11), table.line_length(1));
+
+    PieceTable empty;
+    assert_equals(static_cast<size_t>(1), empty.line_count());
+    assert_equals(std::string(), empty.get_line(0));
+}
+
+void test_many_edits() {
+    PieceTable table;
+    std::string expected;
+
+    // Scatter edits so the tree holds many pieces
+    for (int i = 0; i < 2000; ++i) {
+        size_t offset = (static_cast<size_t>(i) * 7919) % (expected.size() + 1);
+        std::string text = (i % 5 == 0) ? "\n" : std::string(1, static_cast<char>('a' + i % 26));
+        table.insert(offset, text);
+        expected.insert(offset, text);
+        if (i % 3 == 0 && expected.size() > 10) {
+            size_t erase_at = (static_cast<size_t>(i) * 31) % (expected.size() - 5);
+            table.erase(erase_at, 3);
+            expected.erase(erase_at, 3);
+        }
+    }
+    assert_equals(expected, table.get_text());
+
+    size_t line = 0;
+    size_t line_start = 0;
+    for (size_t i = 0; i <= expected.size(); ++i) {
+        if (i == expected.size() || expected[i] == '\n') {
+            assert_equals(expected.substr(line_start, i - line_start), table.get_line(line));
+            ++line;
+            line_start = i + 1;
+        }
+    }
+    assert_equals(line, table.line_count());
+}
+
+void test_mapped() {
+    const std::string path = "piece_table_mapped.txt";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "alpha\nbeta\ngamma";
+    }
+
+    PieceTable table;
+    auto mapping = std::make_shared<MappedFile>(path);
+    assert_equals(true, mapping->is_open());
+    table.reset(mapping, mapping->size());
+    assert_equals(static_cast<size_t>(16), table.length());
+    assert_equals(static_cast<size_t>(3), table.line_count());
+    assert_equals(std::string("beta"), table.get_line(1));
+
+    table.insert(table.line_start(1) + 4, "!");
+    table.detach_original();
+    mapping.reset();
+    std::remove(path.c_str());
+    assert_equals(std::string("alpha\nbeta!\ngamma"), table.get_text());
+}
+
+void test_line_view() {
+    // "na\u00efve" on the first line, ASCII on the second
+    PieceTable table("na\xC3\xAFve caf\xC3\xA9\nplain");
+    LineView view;
+
+    assert_equals(std::wstring(L"na\u00efve caf\u00e9"), view.get(table, 0));
+    assert_equals(static_cast<size_t>(4), view.offset_of(table, 0, 3));
+    assert_equals(static_cast<size_t>(12), view.offset_of(table, 0, 10));
+    assert_equals(std::wstring(L"plain"), view.get(table, 1));
+    assert_equals(static_cast<size_t>(15), view.offset_of(table, 1, 2));
+
+    // And back from offsets to lines and columns
+    assert_equals(static_cast<size_t>(0), table.line_of(12));
+    assert_equals(static_cast<size_t>(1), table.line_of(15));
+    assert_equals(static_cast<size_t>(10), view.column_of(table, 0, 12));
+    assert_equals(static_cast<size_t>(3), view.column_of(table, 0, 4));
+    assert_equals(static_cast<size_t>(2), view.column_of(table, 1, 15));
+
+    // Edits invalidate the cached lines
+    table.erase(view.offset_of(table, 0, 2), 2);
+    assert_equals(std::wstring(L"nave caf\u00e9"), view.get(table, 0));
+
+    // A line that is still being used is not dropped when the cache fills up
+    std::string many;
+    for (size_t i = 0; i < 2 * LineView::MAX_CACHED_LINES; ++i) many += std::to_string(i) + "\n";
+    PieceTable numbers(many);
+    LineView numbers_view;
+    const std::wstring& first = numbers_view.get(numbers, 0);
+    for (size_t i = 1; i < 2 * LineView::MAX_CACHED_LINES; ++i) {
+        // Using it again keeps it among the most recent
+        if (i % 100 == 0) assert_equals(std::wstring(L"0"), numbers_view.get(numbers, 0));
+        assert_equals(std::to_wstring(i), numbers_view.get(numbers, i));
+    }
+    assert_equals(std::wstring(L"0"), first);
+}
+
+void test_lazy_index() {
+    std::string text;
+    std::vector<size_t> starts;
+    for (int i = 0; text.size() < 4 * LINE_INDEX_MIN_CHUNK; ++i) {
+        starts.push_back(text.size());
+        text += "line " + std::to_string(i) + "\n";
+    }
+    PieceTable table(text);
+
+    // Lines near the top only index the first chunk
+    assert_equals(std::string("line 3"), table.get_line(3));
+    assert_equals<size_t>(starts[10], table.line_start(10));
+    assert_equals<size_t>(10, table.line_count_up_to(10));
+    assert_equals(LINE_INDEX_MIN_CHUNK, table.get_indexed_length());
+
+    // Further lines extend the index as far as they need
+    size_t deep = starts.size() / 2;
+    assert_equals<size_t>(deep, table.line_of(starts[deep] + 2));
+    assert_equals(true, table.get_indexed_length() < text.size());
+    assert_equals<size_t>(starts[deep + 1] - starts[deep] - 1, table.line_length(deep));
+
+    // The line count needs all of it, and edits work on top of a partial index
+    PieceTable edited(text);
+    edited.get_line(1);
+    edited.insert(starts[deep], "new\n");
+    assert_equals(std::string("new"), edited.get_line(deep));
+    assert_equals(starts.size() + 2, edited.line_count());
+    assert_equals(starts.size() + 1, table.line_count());
+    assert_equals(text.size(), table.get_indexed_length());
+}
+
+void test_mapped_crlf() {
+    // LF line endings for the first few chunks, then CRLF, and a CRLF cut off the end as OpenedFile does
+    std::string lf;
+    while (lf.size() < 3 * LINE_INDEX_MIN_CHUNK) lf += "line " + std::to_string(lf.size()) + "\n";
+    const std::string path = "piece_table_crlf.txt";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << lf << "crlf\r\nlone\rcr\r\nlast\r\n";
+    }
+    std::string expected = lf + "crlf\nlone\rcr\nlast";
+    size_t lf_lines = static_cast<size_t>(std::count(lf.begin(), lf.end(), '\n'));
+
+    // The top of the file is read in place, without looking at the rest of it
+    auto mapping = std::make_shared<MappedFile>(path);
+    PieceTable table;
+    table.reset(mapping, mapping->size() - 1);
+    assert_equals(std::string("line 0"), table.get_line(0));
+    assert_equals(LINE_INDEX_MIN_CHUNK, table.get_indexed_length());
+    assert_equals(mapping->size() - 1, table.length());
+
+    // The chunk with the first CRLF turns every one after it into LF
+    assert_equals(std::string("crlf"), table.get_line(lf_lines));
+    assert_equals(std::string("lone\rcr"), table.get_line(lf_lines + 1));
+    assert_equals(expected.size(), table.length());
+    assert_equals(lf_lines + 3, table.line_count());
+    assert_equals(expected, table.get_text());
+
+    // Reading all of it before indexing it does the same, and so does detaching it
+    PieceTable read;
+    read.reset(mapping, mapping->size() - 1);
+    assert_equals(expected, read.get_text());
+    assert_equals(std::string("last"), read.get_line(lf_lines + 2));
+    PieceTable detached;
+    detached.reset(mapping, mapping->size() - 1);
+    detached.detach_original();
+    mapping.reset();
+    std::remove(path.c_str());
+    assert_equals(expected, detached.get_text());
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/project_search.h"
+
+
+void test_glob_match();
+void test_ignore_rules();
+void test_search();
+void test_cancel();
+
+int main() {
+    test_glob_match();
+    test_ignore_rules();
+    test_search();
+    test_cancel();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void write_file(const std::filesystem::path& path, const std::string& contents) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+void test_glob_match() {
+    assert_equals(true, glob_match("*.o", "main.o"));
+    assert_equals(false, glob_match("*.o", "build/main.o"));
+    assert_equals(true, glob_match("**/*.o", "build/main.o"));
+    assert_equals(true, glob_match("**/*.o", "main.o"));
+    assert_equals(true, glob_match("build/**", "build/a/b.txt"));
+    assert_equals(true, glob_match("a/**/b", "a/b"));
+    assert_equals(true, glob_match("a/**/b", "a/x/y/b"));
+    assert_equals(true, glob_match("file?.[ch]", "file1.h"));
+    assert_equals(false, glob_match("file?.[!ch]", "file1.h"));
+    assert_equals(true, glob_match("\\*literal", "*literal"));
+    assert_equals(false, glob_match("\\*literal", "xliteral"));
+    assert_equals(true, glob_match("[abc", "[abc"));
+}
+
+void test_ignore_rules() {
+    auto root = std::make_shared<const IgnoreRules>(nullptr, "", "# comment\n*.log\n!keep.log\nbuild/\n/top.txt\r\n");
+    assert_equals(true, root->is_ignored("a/b/debug.log", false));
+    assert_equals(false, root->is_ignored("a/keep.log", false));
+    assert_equals(true, root->is_ignored("src/build", true));
+    assert_equals(false, root->is_ignored("src/build", false));
+    assert_equals(true, root->is_ignored("top.txt", false));
+    assert_equals(false, root->is_ignored("a/top.txt", false));
+
+    // A deeper file comes after its parent and can override it
+    IgnoreRules nested(root, "src/", "!*.log\ngen/*.cpp\n");
+    assert_equals(false, nested.is_ignored("src/debug.log", false));
+    assert_equals(true, nested.is_ignored("other/debug.log", false));
+    assert_equals(true, nested.is_ignored("src/gen/a.cpp", false));
+    assert_equals(false, nested.is_ignored("src/x/gen/a.cpp", false));
+}
+
+void test_search() {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "speedy_project_search_test";
+    std::filesystem::remove_all(root);
+    write_file(root / "a.txt", "one Needle\nneedles\r\nthird needle here\n");
+    write_file(root / "src" / "b.cpp", "int needle = 0;\n");
+    write_file(root / "src" / "gen" / "c.cpp", "needle\n");
+    write_file(root / "src" / ".gitignore", "gen/\n");
+    write_file(root / "debug.log", "needle\n");
+    write_file(root / ".gitignore", "*.log\n");
+    write_file(root / ".git" / "HEAD", "needle\n");
+    write_file(root / "binary.bin", std::string("needle\0", 7));
+
+    ProjectSearch search(root.string(), "needle", FindOptions{false, false}, 100, 3);
+    search.wait();
+    std::vector<SearchResult> results;
+    search.take_results(results);
+    std::sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) {
+        return a.path != b.path ? a.path < b.path : a.column + a.line * 1000 < b.column + b.line * 1000;
+    });
+    assert_equals<size_t>(4, results.size());
+    assert_equals(std::string("a.txt"), results[0].path);
+    assert_equals<size_t>(0, results[0].line);
+    assert_equals<size_t>(4, results[0].column);
+    assert_equals(std::string("needles"), results[1].text);
+    assert_equals<size_t>(2, results[2].line);
+    assert_equals<size_t>(6, results[2].column);
+    assert_equals(std::string("third needle here"), results[2].text);
+    assert_equals(std::string("src/b.cpp"), results[3].path);
+    assert_equals(true, search.is_done());
+
+    // Whole words and exact case
+    ProjectSearch whole(root.string(), "needle", FindOptions{true, true});
+    whole.wait();
+    results.clear();
+    whole.take_results(results);
+    assert_equals<size_t>(2, results.size());
+
+    // A long line is cut before a character that crosses the limit, not inside it
+    std::string euros;
+    while (euros.size() < SEARCH_LINE_LIMIT + 10) euros += "\xE2\x82\xAC";
+    write_file(root / "long.txt", "needle x " + euros + "\n");
+    ProjectSearch cut(root.string(), "needle", FindOptions{true, true});
+    cut.wait();
+    results.clear();
+    cut.take_results(results);
+    auto long_line = std::find_if(results.begin(), results.end(), [](const SearchResult& r) { return r.path == "long.txt"; });
+    assert_equals(true, long_line != results.end());
+    assert_equals(SEARCH_LINE_LIMIT - 1, long_line->text.size());
+    assert_equals(("needle x " + euros).substr(0, SEARCH_LINE_LIMIT - 1), long_line->text);
+    std::filesystem::remove_all(root);
+}
+
+void test_cancel() {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "speedy_project_search_cancel";
+    std::filesystem::remove_all(root);
+    for (int i = 0; i < 200; ++i) {
+        write_file(root / std::to_string(i % 10) / (std::to_string(i) + ".txt"), "match\nmatch\n");
+    }
+
+    // Stops at the limit, with exactly that many results
+    ProjectSearch limited(root.string(), "match", FindOptions{}, 25);
+    limited.wait();
+    std::vector<SearchResult> results;
+    limited.take_results(results);
+    assert_equals<size_t>(25, results.size());
+
+    ProjectSearch cancelled(root.string(), "match", FindOptions{});
+    cancelled.cancel();
+    cancelled.wait();
+    assert_equals(true, cancelled.is_done());
+    std::filesystem::remove_all(root);
+}
@@ -0,0 +1,90 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "test.h"
+
+#include "../src/config.h"
+#include "../src/opened_file.h"
+#include "../src/recording_renderer.h"
+
+
+void test_full_frame();
+void test_damaged_band();
+
+int main() {
+    Config::create();
+    test_full_frame();
+    test_damaged_band();
+    Config::destroy();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+std::string write_lines(int count) {
+    std::string path = (std::filesystem::temp_directory_path() / "speedy_recording_renderer_test.txt").string();
+    std::ofstream out(path, std::ios::binary);
+    for (int i = 0; i < count; ++i) out << "line " << i << '\n';
+    return path;
+}
+
+void test_full_frame() {
+    Config::get_instance()->set_show_line_numbers(false);
+    std::string path = write_lines(30);
+    OpenedFile file(path);
+    file.get_viewport().resize(10, 80);
+
+    RecordingRenderer renderer;
+    renderer.BeginDraw();
+    file.draw(&renderer);
+    renderer.EndDraw();
+
+    // Ten lines of text and the cursor
+    const RecordingRenderer::Counts& counts = renderer.get_counts();
+    assert_equals<size_t>(1, counts.frames);
+    assert_equals<size_t>(11, counts.draw_calls);
+    assert_equals<size_t>(60, counts.glyphs);
+    assert_equals<size_t>(1, counts.lines);
+    assert_equals(counts.glyphs, counts.shaped_glyphs);
+
+    // Nothing changed, so the next frame shapes nothing
+    renderer.reset();
+    file.draw(&renderer);
+    assert_equals<size_t>(0, renderer.get_counts().shaped_glyphs);
+
+    // A selection across two lines fills one rectangle on each
+    file.start_selection();
+    file.set_current_line(1);
+    file.set_current_character(3);
+    file.update_selection();
+    renderer.reset();
+    file.draw(&renderer);
+    assert_equals<size_t>(2, renderer.get_counts().fill_rects);
+
+    std::filesystem::remove(path);
+}
+
+void test_damaged_band() {
+    Config::get_instance()->set_show_line_numbers(false);
+    std::string path = write_lines(30);
+    OpenedFile file(path);
+    file.get_viewport().resize(10, 80);
+    file.set_current_line(4);
+    file.clear_damage();
+
+    file.insert_character('x');
+    const Damage& damage = file.get_damage();
+    assert_equals(4, damage.get_first_line());
+    assert_equals(4, damage.get_last_line());
+
+    // Drawing just the band of the damaged line redraws one line and the cursor
+    float line_height = static_cast<float>(static_cast<int>(Config::get_instance()->get_font_size() * 1.25f));
+    RecordingRenderer renderer;
+    file.draw(&renderer, 4 * line_height, 5 * line_height);
+    assert_equals<size_t>(2, renderer.get_counts().draw_calls);
+    assert_equals<size_t>(7, renderer.get_counts().glyphs);
+
+    std::filesystem::remove(path);
+}
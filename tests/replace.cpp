@@ -0,0 +1,123 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/config.h"
+#include "../src/opened_file.h"
+#include "../src/replace.h"
+
+
+void test_literal_prefix();
+void test_find_replacements();
+void test_pack();
+void test_replace_all_undo();
+
+int main() {
+    Config::create();
+    test_literal_prefix();
+    test_find_replacements();
+    test_pack();
+    test_replace_all_undo();
+    Config::destroy();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_literal_prefix() {
+    assert_equals(std::string("value_"), literal_prefix("value_(\\d+)"));
+    assert_equals(std::string("foo"), literal_prefix("^foo.*"));
+    assert_equals(std::string("ab"), literal_prefix("abc?d"));
+    assert_equals(std::string("abc"), literal_prefix("abc+"));
+    assert_equals(std::string(""), literal_prefix("foo|bar"));
+    assert_equals(std::string("x"), literal_prefix("x(a|b)"));
+    assert_equals(std::string(""), literal_prefix("[a|b]"));
+}
+
+void test_find_replacements() {
+    Replacements out;
+    std::string error;
+    assert_equals(true, find_replacements("a1 b22 c333", "([a-z])(\\d+)", "$2$1", FindOptions{true, false}, out, error));
+    assert_equals<size_t>(3, out.spans.size());
+    assert_equals(std::string("a1b22c333"), out.removed);
+    assert_equals(std::string("1a22b333c"), out.inserted);
+    assert_equals<uint64_t>(3, out.spans[1].position);
+    assert_equals<uint64_t>(3, out.spans[1].removed_length);
+
+    // The literal prefix only narrows down where to look, case folding and word boundaries still apply
+    out = Replacements();
+    assert_equals(true, find_replacements("Foo food foo\nfoo", "^foo", "x", FindOptions{false, true}, out, error));
+    assert_equals<size_t>(2, out.spans.size());
+    assert_equals<uint64_t>(0, out.spans[0].position);
+    assert_equals<uint64_t>(13, out.spans[1].position);
+
+    // Plain text is matched without the regular expression, and $& keeps the case it was found in
+    out = Replacements();
+    assert_equals(true, find_replacements("a.b A.B", "a.b", "<$&>", FindOptions{false, false}, out, error));
+    assert_equals(std::string("<a.b><A.B>"), out.inserted);
+
+    // Empty matches, but not right after a match nor inside a multi-byte character
+    out = Replacements();
+    assert_equals(true, find_replacements("xx\xc3\xa9", "x*", "-", FindOptions{true, false}, out, error));
+    assert_equals<size_t>(2, out.spans.size());
+    assert_equals<uint64_t>(4, out.spans[1].position);
+
+    // Groups past the ninth, and references to groups that do not exist
+    out = Replacements();
+    assert_equals(true, find_replacements("abcdefghijk", "(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)(k)", "$11$1$$$0$12$&", FindOptions{true, false}, out, error));
+    assert_equals(std::string("ka$$0a2abcdefghijk"), out.inserted);
+
+    assert_equals(false, find_replacements("abc", "(", "", FindOptions{}, out, error));
+    assert_equals(false, error.empty());
+}
+
+void test_pack() {
+    std::vector<Replacement> spans = {{2, 3, 1}, {10, 0, 2}};
+    std::string packed = pack_replacements(spans, "abc", "xyz");
+    std::vector<Replacement> unpacked;
+    std::string_view removed, inserted;
+    unpack_replacements(packed, unpacked, removed, inserted);
+    assert_equals<size_t>(2, unpacked.size());
+    assert_equals<uint64_t>(10, unpacked[1].position);
+    assert_equals<uint64_t>(2, unpacked[1].inserted_length);
+    assert_equals(std::string("abc"), std::string(removed));
+    assert_equals(std::string("xyz"), std::string(inserted));
+}
+
+void test_replace_all_undo() {
+    std::string path = (std::filesystem::temp_directory_path() / "speedy_replace_test.txt").string();
+    std::string contents;
+    for (int i = 0; i < 1000; ++i) contents += "value_" + std::to_string(i) + " = compute(x);\n";
+    std::ofstream(path, std::ios::binary) << contents;
+    contents.pop_back();
+
+    OpenedFile file(path);
+    file.set_current_line(500);
+    file.set_current_character(8);
+    file.insert_character('!');
+    file.set_current_character(3);
+    std::string error;
+    assert_equals<size_t>(1000, file.replace_all("value_(\\d+)", "v[$1]", FindOptions{true, false}, error));
+    assert_equals(std::wstring(L"v[0] = compute(x);"), file.get_line_contents(0));
+    // The cursor was inside a match and ends up after its replacement
+    assert_equals(std::wstring(L"v[50]!0 = compute(x);"), file.get_line_contents(500));
+    assert_equals(5, file.get_current_character_index());
+
+    // One step back to where it was, and one step forward again
+    file.undo();
+    assert_equals(std::wstring(L"value_50!0 = compute(x);"), file.get_line_contents(500));
+    assert_equals(3, file.get_current_character_index());
+    file.undo();
+    assert_equals(true, file.get_contents() == contents);
+    file.redo();
+    file.redo();
+    assert_equals(std::wstring(L"v[999] = compute(x);"), file.get_line_contents(999));
+
+    assert_equals<size_t>(0, file.replace_all("(", "", FindOptions{}, error));
+    assert_equals(false, error.empty());
+    std::filesystem::remove(path);
+}
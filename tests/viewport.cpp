@@ -0,0 +1,56 @@
+#include <iostream>
+
+#include "test.h"
+
+#include "../src/viewport.h"
+
+
+void test_scroll_to();
+void test_follow_cursor();
+
+int main() {
+    test_scroll_to();
+    test_follow_cursor();
+
+    std::cout << "All " << test_no << " test cases passed\n";
+    return 0;
+}
+
+void test_scroll_to() {
+    Viewport viewport;
+    viewport.resize(10, 40);
+
+    // Positions already in view do not scroll
+    viewport.scroll_to(9, 39);
+    assert_equals(0, viewport.get_first_line());
+    assert_equals(0, viewport.get_first_column());
+
+    // Otherwise just far enough to bring them to the nearest edge
+    viewport.scroll_to(25, 50);
+    assert_equals(16, viewport.get_first_line());
+    assert_equals(11, viewport.get_first_column());
+    viewport.scroll_to(3, 0);
+    assert_equals(3, viewport.get_first_line());
+    assert_equals(0, viewport.get_first_column());
+    assert_equals(13, viewport.get_end_line());
+}
+
+void test_follow_cursor() {
+    Viewport viewport;
+    viewport.resize(10, 40);
+    viewport.follow_cursor(100, 0);
+    assert_equals(91, viewport.get_first_line());
+
+    // Scrolling away from a cursor that has not moved sticks
+    viewport.scroll_by(-50, 200);
+    viewport.follow_cursor(100, 0);
+    assert_equals(41, viewport.get_first_line());
+    assert_equals(false, viewport.is_line_visible(100));
+
+    // Until the cursor moves again
+    viewport.follow_cursor(101, 0);
+    assert_equals(92, viewport.get_first_line());
+
+    viewport.scroll_by(1000, 200);
+    assert_equals(199, viewport.get_first_line());
+}